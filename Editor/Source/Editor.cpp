@@ -12,11 +12,20 @@
 
 #include <stb_image/stb_image.h>
 
+#include <chrono>
+#include <random>
+#include <filesystem>
+
 #include <GLFW/glfw3.h>		
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>	
 
 
+// Compute passes baking the IBL cubemaps
+static const char* s_EquirectangularToCubemapShader = "Assets/Shaders/EquirectangularToCubemap.compute.glsl";
+static const char* s_EnvironmentFilteringShader = "Assets/Shaders/EnvironmentFiltering.compute.glsl";
+static const char* s_EnvironmentIrradianceShader = "Assets/Shaders/EnvironmentIrradiance.compute.glsl";
+
 static std::string OpenFileDialog(const char* filter)
 {
 	OPENFILENAMEA ofn;				// common dialog box structure
@@ -67,6 +76,153 @@ static std::string SaveFileDialog(const char* filter)
 	return std::string("");
 }
 
+struct RayKernelBenchmark
+{
+	static constexpr u32 TriangleCount = 4096;
+	static constexpr u32 RayCount = 1024;
+
+	float reference = 0.0f;			// ms, RayIntersectsTriangle one triangle at a time
+	float single[4] = {};			// ms per SIMDLevel, one ray at a time against the batch
+	float packet[4] = {};			// ms per SIMDLevel, all rays as packets
+	bool valid = false;
+};
+
+struct TextureUploadBenchmark
+{
+	u32 textureCount = 0;
+	u64 bytes = 0;
+	float decode = 0.0f;			// ms, all images decoded in parallel
+	float direct = 0.0f;			// ms, uploads straight from client memory until the GPU is done
+	float staged = 0.0f;			// ms, uploads through the staging buffer until the GPU is done
+	bool valid = false;
+};
+
+static TextureUploadBenchmark BenchmarkTextureUploads(const std::string& directory)
+{
+	using Clock = std::chrono::high_resolution_clock;
+	auto Milliseconds = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+	TextureUploadBenchmark result;
+
+	std::vector<std::string> filepaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::string extension = entry.path().extension().string();
+		if (extension == ".tga" || extension == ".png" || extension == ".jpg")
+			filepaths.push_back(entry.path().string());
+	}
+	if (filepaths.empty())
+		return result;
+
+	// Plain RGBA8 images without mips, so only the upload itself is measured
+	std::vector<Engine::TextureImage> images(filepaths.size());
+	auto start = Clock::now();
+	Engine::JobSystem::ParallelFor(static_cast<u32>(images.size()), 1, [&](u32 begin, u32 end)
+		{
+			for (u32 i = begin; i < end; i++)
+				images[i] = Engine::Texture::Decode(filepaths[i]);
+		});
+	result.decode = Milliseconds(start);
+
+	for (const auto& image : images)
+		result.bytes += image.pixels.size();
+	result.textureCount = static_cast<u32>(images.size());
+
+	const bool staging = Engine::Texture::IsUploadStaging();
+	for (bool staged : { false, true })
+	{
+		Engine::Texture::SetUploadStaging(staged);
+
+		std::vector<Engine::Texture> textures(images.size());
+		glFinish();
+
+		start = Clock::now();
+		for (std::size_t i = 0; i < images.size(); i++)
+			textures[i].Upload(images[i]);
+		glFinish();
+
+		(staged ? result.staged : result.direct) = Milliseconds(start);
+	}
+	Engine::Texture::SetUploadStaging(staging);
+
+	result.valid = true;
+	return result;
+}
+
+static RayKernelBenchmark BenchmarkRayKernels()
+{
+	using Clock = std::chrono::high_resolution_clock;
+	auto Milliseconds = [](Clock::time_point start) { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+	RayKernelBenchmark result;
+
+	std::mt19937 random(1337);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f), offset(-1.0f, 1.0f);
+
+	std::vector<glm::vec3> vertices;
+	Engine::TriangleBatch batch;
+	for (u32 i = 0; i < RayKernelBenchmark::TriangleCount; i++)
+	{
+		glm::vec3 center = { position(random), position(random), position(random) };
+		glm::vec3 v0 = center + glm::vec3(offset(random), offset(random), offset(random));
+		glm::vec3 v1 = center + glm::vec3(offset(random), offset(random), offset(random));
+		glm::vec3 v2 = center + glm::vec3(offset(random), offset(random), offset(random));
+
+		vertices.insert(vertices.end(), { v0, v1, v2 });
+		batch.Add(v0, v1, v2);
+	}
+
+	std::vector<Engine::Ray> rays(RayKernelBenchmark::RayCount);
+	for (auto& ray : rays)
+		ray = { { position(random), position(random), -20.0f }, { offset(random) * 0.25f, offset(random) * 0.25f, 1.0f } };
+
+	u32 hits = 0;
+
+	auto start = Clock::now();
+	for (const auto& ray : rays)
+	{
+		float closest = std::numeric_limits<float>::max();
+		for (u32 i = 0; i < RayKernelBenchmark::TriangleCount; i++)
+		{
+			float t;
+			if (Engine::Math::RayIntersectsTriangle(ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], t) && t < closest)
+				closest = t;
+		}
+		hits += closest < std::numeric_limits<float>::max();
+	}
+	result.reference = Milliseconds(start);
+
+	Engine::SIMDLevel previousLevel = Engine::Math::GetSIMDLevel();
+	std::vector<Engine::TriangleHit> packetHits(rays.size());
+
+	for (int level = 0; level <= static_cast<int>(Engine::Math::GetSupportedSIMDLevel()); level++)
+	{
+		Engine::Math::SetSIMDLevel(static_cast<Engine::SIMDLevel>(level));
+
+		start = Clock::now();
+		for (const auto& ray : rays)
+		{
+			Engine::TriangleHit hit;
+			hits += Engine::Math::IntersectTriangles(ray, batch, hit);
+		}
+		result.single[level] = Milliseconds(start);
+
+		std::fill(packetHits.begin(), packetHits.end(), Engine::TriangleHit());
+		start = Clock::now();
+		hits += Engine::Math::IntersectTriangles(rays.data(), static_cast<u32>(rays.size()), batch, packetHits.data());
+		result.packet[level] = Milliseconds(start);
+	}
+
+	Engine::Math::SetSIMDLevel(previousLevel);
+
+	// Keeps the loops from being optimized away
+	ME_TRACE("Ray kernel benchmark: %u hits", hits);
+
+	result.valid = true;
+	return result;
+}
+
 Editor::Editor(): 
 	m_Camera(Engine::CameraType::Orbit)
 {
@@ -195,6 +351,7 @@ void Editor::OnUpdate(float delta)
 
 	// Render
 	{
+		Engine::Renderer::ResetStatistics();
 		Engine::Renderer::SetClearColor(glm::vec4{ 0.7f, 0.7f, 0.7f, 1.0f });
 		Engine::Renderer::Clear();
 
@@ -229,35 +386,9 @@ void Editor::OnEvent(Engine::Event &event)
 
 		auto mouseRay = CastRay();
 
-		auto view = m_EditorScene->GetRegistry().view<Engine::TransformComponent, Engine::MeshComponent>();
-		view.each([&](const entt::entity ent, const Engine::TransformComponent& tc, const Engine::MeshComponent& mc)
-			{
-				auto entity = Engine::Entity(ent, m_EditorScene.get());
-				auto& subMeshes = mc.mesh->GetSubMeshes();
-
-				for (u32 i = 0; i < subMeshes.size(); i++)
-				{
-					auto& subMesh = subMeshes[i];
-					glm::mat4 transform = tc.transform.GetTransform();
-
-					Engine::Ray ray = {
-						glm::inverse(transform * subMesh.transform) * glm::vec4(mouseRay.origin, 1.0f),
-						glm::inverse(glm::mat3(transform) * glm::mat3(subMesh.transform)) * mouseRay.direction
-					};
-
-					bool intersection = false;
-					const auto& triangleMesh = mc.mesh->GetTriangleRepresentation();
-
-					for (auto& triangle : triangleMesh)
-					{
-						float distance; 
-						if (Engine::Math::RayIntersectsTriangle(ray, triangle, distance))
-						{
-							m_SelectedEntity = Engine::Entity(ent, m_EditorScene.get());
-						}
-					}
-				}
-			});
+		Engine::RaycastHit hit;
+		if (m_EditorScene->Raycast(mouseRay, hit))
+			m_SelectedEntity = Engine::Entity(hit.entity, m_EditorScene.get());
 	}
 }
 
@@ -344,24 +475,7 @@ void Editor::MainRenderPass()
 	auto& scene = m_SceneState == SceneState::Playing ? m_RuntimeScene : m_EditorScene;
 	// Render Scene
 	{
-		auto& shader = Engine::Renderer::GetShader("PBR");
-		shader->Bind();
-		shader->SetUniformMatrix4("u_ProjectionView", m_Camera.GetProjectionViewMatrix());
-		shader->SetUniformFloat3("u_CameraPosition", m_Camera.GetPosition());
-
-		auto &directionalLight = scene->environment.directionalLight;
-		shader->SetUniformInt("u_DirectionalLights[0].Active", directionalLight.active);
-		shader->SetUniformFloat3("u_DirectionalLights[0].Direction", directionalLight.direction);
-		shader->SetUniformFloat3("u_DirectionalLights[0].Radiance", directionalLight.radiance);
-		shader->SetUniformFloat("u_DirectionalLights[0].Multiplier", directionalLight.intensity);
-
-		shader->SetUniformInt("u_BRDFLUTTexture", 5);
-		shader->SetUniformInt("u_EnvRadianceTex", 6);
-		shader->SetUniformInt("u_EnvIrradianceTex", 7);
-
-		scene->environment.brdflutTexture->Bind(5);
-		scene->environment.radianceMap->Bind(6);
-		scene->environment.irradianceMap->Bind(7);
+		Engine::Renderer::BeginScene(m_Camera.GetProjectionViewMatrix(), m_Camera.GetPosition(), scene->environment);
 
 		auto view = scene->GetRegistry().view<Engine::TransformComponent, Engine::MeshComponent>();
 		view.each([=](const entt::entity ent, const Engine::TransformComponent& tc, const Engine::MeshComponent& mc)
@@ -369,6 +483,8 @@ void Editor::MainRenderPass()
 				if (mc.mesh->IsLoaded() && m_SelectedEntity.GetEntity() != ent)
 					Engine::Renderer::SubmitMesh(mc.mesh, tc.transform.GetTransform());
 			});
+
+		Engine::Renderer::EndScene();
 	}
 
 	// Render Skybox
@@ -400,35 +516,16 @@ void Editor::MainRenderPass()
 
 		if (selectedMesh.mesh->IsLoaded())
 		{
-			auto& shader = Engine::Renderer::GetShader("PBR");
-			shader->Bind();
-			shader->SetUniformMatrix4("u_ProjectionView", m_Camera.GetProjectionViewMatrix());
-			shader->SetUniformFloat3("u_CameraPosition", m_Camera.GetPosition());
-
-			shader->SetUniformFloat3("u_AlbedoColor", glm::vec3(0.8f, 0.1f, 0.15f));
-
-			shader->SetUniformInt("u_EnableAlbedoTexture", 0);
-			shader->SetUniformInt("u_EnableNormalMapTexture", 0);
-			shader->SetUniformInt("u_EnableMetalnessTexture", 0);
-			shader->SetUniformInt("u_EnableRoughnessTexture", 0);
-
-			shader->SetUniformInt("u_DirectionalLights[0].Active", 1);
-			shader->SetUniformFloat3("u_DirectionalLights[0].Direction", glm::vec3(glm::radians(30.0f), glm::radians(20.0f), 0.0f));
-			shader->SetUniformFloat3("u_DirectionalLights[0].Radiance", glm::vec3(1.0f));
-			shader->SetUniformFloat("u_DirectionalLights[0].Multiplier", 1.0f);
-
-			shader->SetUniformInt("u_DirectionalLights[1].Active", 0);
-			shader->SetUniformInt("u_DirectionalLights[2].Active", 0);
-			shader->SetUniformInt("u_DirectionalLights[3].Active", 0);
-
-			shader->SetUniformInt("u_BRDFLUTTexture", 5);
-			shader->SetUniformInt("u_EnvRadianceTex", 6);
-			shader->SetUniformInt("u_EnvIrradianceTex", 7);
-
-			scene->environment.brdflutTexture->Bind(5);
-			scene->environment.radianceMap->Bind(6);
-			scene->environment.irradianceMap->Bind(7);
+			// Selected mesh is lit by a fixed highlight light instead of the scene light
+			Engine::Environment highlightEnvironment = scene->environment;
+			highlightEnvironment.directionalLight.active = true;
+			highlightEnvironment.directionalLight.direction = glm::vec3(glm::radians(30.0f), glm::radians(20.0f), 0.0f);
+			highlightEnvironment.directionalLight.radiance = glm::vec3(1.0f);
+			highlightEnvironment.directionalLight.intensity = 1.0f;
+
+			Engine::Renderer::BeginScene(m_Camera.GetProjectionViewMatrix(), m_Camera.GetPosition(), highlightEnvironment);
 			Engine::Renderer::SubmitMesh(selectedMesh.mesh, transform.transform.GetTransform());
+			Engine::Renderer::EndScene();
 
 			glStencilFunc(GL_NOTEQUAL, 1, 0xff);
 			glStencilMask(0x00);
@@ -438,8 +535,6 @@ void Editor::MainRenderPass()
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 			auto& outlineShader = Engine::Renderer::GetShader("Outline");
-			outlineShader->Bind();
-			outlineShader->SetUniformMatrix4("u_ProjectionView", m_Camera.GetProjectionViewMatrix());
 			Engine::Renderer::SubmitMeshWithShader(selectedMesh.mesh, transform.transform.GetTransform() * glm::scale(glm::mat4(1.0f), glm::vec3(1.015f)), outlineShader);
 
 			glPointSize(10);
@@ -483,10 +578,49 @@ Engine::Environment Editor::CreateEnvironment(const std::string& filepath)
 	constexpr uint32_t cubemapSize = 1024;
 	constexpr uint32_t irradianceMapSize = 32;
 
-	SharedPtr<Engine::ComputeShader> EquirectangularToCubemapShader = MakeShared<Engine::ComputeShader>("Assets/Shaders/EquirectangularToCubemap.compute.glsl");
+	SharedPtr<Engine::TextureCube> filteredEnvironmentTextureCube = MakeShared<Engine::TextureCube>(cubemapSize, cubemapSize);
+	SharedPtr<Engine::TextureCube> irradianceMap = MakeShared<Engine::TextureCube>(irradianceMapSize, irradianceMapSize);
+
+	// The filtered cubemaps only change with the HDR image and the compute shaders, bake them once
+	const u64 sourceHash = Engine::EnvironmentSerializer::CalculateSourceHash(filepath, cubemapSize, irradianceMapSize,
+		{ s_EquirectangularToCubemapShader, s_EnvironmentFilteringShader, s_EnvironmentIrradianceShader });
+	const std::string cachePath = Engine::EnvironmentSerializer::GetCachePath(sourceHash);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto Milliseconds = [&start]() { return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count(); };
+
+	if (sourceHash && Engine::EnvironmentSerializer::Deserialize(*filteredEnvironmentTextureCube, *irradianceMap, cachePath, sourceHash))
+	{
+		ME_INFO("Loaded Environment from cache: %s (%.2f ms)", cachePath.c_str(), Milliseconds());
+	}
+	else
+	{
+		BakeEnvironment(filepath, *filteredEnvironmentTextureCube, *irradianceMap);
+		ME_INFO("Baked Environment: %s (%.2f ms)", filepath.c_str(), Milliseconds());
+
+		if (sourceHash && Engine::EnvironmentSerializer::Serialize(*filteredEnvironmentTextureCube, *irradianceMap, cachePath, sourceHash))
+			ME_INFO("Wrote Environment cache: %s", cachePath.c_str());
+	}
+
+	environment.radianceMap = filteredEnvironmentTextureCube;
+	environment.irradianceMap = irradianceMap;
+	environment.brdflutTexture = Engine::TextureLibrary::Load("Assets/Textures/BRDF.tga");
+	environment.exposure = 1.0f;
+	environment.textureLod = 0.0f;
+
+	environment.directionalLight.active = true;
+
+	return environment;
+}
+
+void Editor::BakeEnvironment(const std::string& filepath, Engine::TextureCube& radianceMap, Engine::TextureCube& irradianceMap)
+{
+	const uint32_t cubemapSize = radianceMap.GetWidth();
+
+	SharedPtr<Engine::ComputeShader> EquirectangularToCubemapShader = MakeShared<Engine::ComputeShader>(s_EquirectangularToCubemapShader);
 
 	SharedPtr<Engine::TextureCube> environmentTextureCube = MakeShared<Engine::TextureCube>(cubemapSize, cubemapSize);
-	SharedPtr<Engine::Texture> HDRTexture = MakeShared<Engine::Texture>(filepath.c_str());
+	SharedPtr<Engine::Texture> HDRTexture = Engine::TextureLibrary::Load(filepath);
 
 	EquirectangularToCubemapShader->Bind();
 
@@ -501,25 +635,23 @@ Engine::Environment Editor::CreateEnvironment(const std::string& filepath)
 
 	ME_INFO("Computation finished");
 
-	// TODO: Filter environment map and create irradiance map for ibl
-	SharedPtr<Engine::ComputeShader> environmentFilteringShader = MakeShared<Engine::ComputeShader>("Assets/Shaders/EnvironmentFiltering.compute.glsl");
-	SharedPtr<Engine::TextureCube> filteredEnvironmentTextureCube = MakeShared<Engine::TextureCube>(cubemapSize, cubemapSize);
+	SharedPtr<Engine::ComputeShader> environmentFilteringShader = MakeShared<Engine::ComputeShader>(s_EnvironmentFilteringShader);
 
 	glCopyImageSubData(environmentTextureCube->GetRendererID(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
-		filteredEnvironmentTextureCube->GetRendererID(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
-		filteredEnvironmentTextureCube->GetWidth(), filteredEnvironmentTextureCube->GetHeight(), 6);
+		radianceMap.GetRendererID(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+		radianceMap.GetWidth(), radianceMap.GetHeight(), 6);
 
 	environmentFilteringShader->Bind();
 	environmentTextureCube->Bind(1);
 
-	const float deltaRoughness = 1.0f / glm::max(float(filteredEnvironmentTextureCube->GetMipLevelCount()) - 1.0f, 1.0f);
-	for (uint32_t level = 1, size = cubemapSize / 2; level < filteredEnvironmentTextureCube->GetMipLevelCount(); level++, size /= 2) // <= ?
+	const float deltaRoughness = 1.0f / glm::max(float(radianceMap.GetMipLevelCount()) - 1.0f, 1.0f);
+	for (uint32_t level = 1, size = cubemapSize / 2; level < radianceMap.GetMipLevelCount(); level++, size /= 2) // <= ?
 	{
-		glBindImageTexture(0, filteredEnvironmentTextureCube->GetRendererID(), level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+		glBindImageTexture(0, radianceMap.GetRendererID(), level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
 
-		const GLint roughnessUniformLocation = glGetUniformLocation(environmentFilteringShader->GetRendererID(), "u_Roughness");
+		const int roughnessUniformLocation = environmentFilteringShader->GetUniformLocation("u_Roughness");
 		ME_ASSERT(roughnessUniformLocation != -1);
-		glUniform1f(roughnessUniformLocation, (float)level * deltaRoughness);
+		environmentFilteringShader->SetUniformFloat(roughnessUniformLocation, (float)level * deltaRoughness);
 
 		const GLuint numGroups = glm::max(1u, size / 32);
 		glDispatchCompute(numGroups, numGroups, 6);
@@ -527,27 +659,16 @@ Engine::Environment Editor::CreateEnvironment(const std::string& filepath)
 	}
 
 
-	SharedPtr<Engine::ComputeShader> envIrradianceShader = MakeShared<Engine::ComputeShader>("Assets/Shaders/EnvironmentIrradiance.compute.glsl");
+	SharedPtr<Engine::ComputeShader> envIrradianceShader = MakeShared<Engine::ComputeShader>(s_EnvironmentIrradianceShader);
 
-	SharedPtr<Engine::TextureCube> irradianceMap = MakeShared<Engine::TextureCube>(irradianceMapSize, irradianceMapSize);
 	envIrradianceShader->Bind();
-	filteredEnvironmentTextureCube->Bind(1);
+	radianceMap.Bind(1);
 
-	glBindImageTexture(0, irradianceMap->GetRendererID(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glBindImageTexture(0, irradianceMap.GetRendererID(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
 
-	glDispatchCompute(irradianceMap->GetWidth() / 32, irradianceMap->GetHeight() / 32, 6);
+	glDispatchCompute(irradianceMap.GetWidth() / 32, irradianceMap.GetHeight() / 32, 6);
 	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-	glGenerateTextureMipmap(irradianceMap->GetRendererID());
-
-	environment.radianceMap = filteredEnvironmentTextureCube;
-	environment.irradianceMap = irradianceMap;
-	environment.brdflutTexture = MakeShared<Engine::Texture>("Assets/Textures/BRDF.tga");
-	environment.exposure = 1.0f;
-	environment.textureLod = 0.0f;
-
-	environment.directionalLight.active = true;
-
-	return environment;
+	glGenerateTextureMipmap(irradianceMap.GetRendererID());
 }
 
 void Editor::BeginDockspace()
@@ -731,11 +852,22 @@ void Editor::DrawInspector()
 		if (ImGui::CollapsingHeader("Mesh Settings"))
 		{
 			ImGui::TextWrapped("Filepath: %s", mc.mesh->GetFilepath().c_str());
+			if (mc.mesh->IsLoading())
+				ImGui::Text("Loading ...");
+
+			static bool compactVertices = false;
 			if (ImGui::Button("Load"))
 			{
 				std::string filepath = OpenFileDialog("");
-				mc.mesh.reset(new Engine::Mesh(filepath));
+				if (filepath != "")
+				{
+					Engine::MeshImportSettings settings;
+					settings.compactVertices = compactVertices;
+					mc.mesh = Engine::MeshLibrary::LoadAsync(filepath, settings);
+				}
 			}
+			ImGui::SameLine();
+			ImGui::Checkbox("Compact Vertices", &compactVertices);
 
 			static bool showMaterials = false;
 			if (ImGui::Button("Open Material Settings"))
@@ -771,19 +903,25 @@ void Editor::DrawInspector()
 						ImGui::ColorEdit3("Albedo Color", &params.albedo[0]);
 						ImGui::SliderFloat("Metalness", &params.metalness, 0.0f, 1.0f);
 						ImGui::SliderFloat("Roughness", &params.roughness, 0.0f, 1.0f);
+						ImGui::SliderFloat("Opacity", &params.opacity, 0.0f, 1.0f);
+
+						bool transparent = subMaterials[selected].HasFlag(Engine::MaterialFlag::Transparent);
+						if (ImGui::Checkbox("Transparent", &transparent))
+							subMaterials[selected].SetFlag(Engine::MaterialFlag::Transparent, transparent);
 						ImGui::EndTabItem();
 					}
 					if (ImGui::BeginTabItem("Textures"))
 					{
 						auto& textures = subMaterials[selected].GetTextures();
 
-						auto CheckForClickAndSetTexture = [](SharedPtr<Engine::Texture>& texture)
+						// Same settings as the textures of imported meshes
+						auto CheckForClickAndSetTexture = [](SharedPtr<Engine::Texture>& texture, Engine::TextureSlot slot)
 						{
 							if (ImGui::IsItemClicked())
 							{
 								std::string filepath = OpenFileDialog("");
 								if (filepath != "")
-									texture = MakeShared<Engine::Texture>(filepath);
+									texture = Engine::TextureLibrary::LoadAsync(filepath, Engine::TextureLibrary::GetSlotSettings(slot));
 							}
 						};
 
@@ -795,7 +933,7 @@ void Editor::DrawInspector()
 							else
 								ImGui::Image((ImTextureID)textures.albedo->GetRendererID(), ImVec2(64.0f, 64.0f));
 
-							CheckForClickAndSetTexture(textures.albedo);
+							CheckForClickAndSetTexture(textures.albedo, Engine::TextureSlot::Albedo);
 							ImGui::Checkbox("Enable##Albedo", &textures.useAlbedo);
 						}
 
@@ -807,7 +945,7 @@ void Editor::DrawInspector()
 							else
 								ImGui::Image((ImTextureID)textures.normal->GetRendererID(), ImVec2(64.0f, 64.0f));
 
-							CheckForClickAndSetTexture(textures.normal);
+							CheckForClickAndSetTexture(textures.normal, Engine::TextureSlot::Normal);
 							ImGui::Checkbox("Enable##Normal", &textures.useNormal);
 						}
 
@@ -819,7 +957,7 @@ void Editor::DrawInspector()
 							else
 								ImGui::Image((ImTextureID)textures.metalness->GetRendererID(), ImVec2(64.0f, 64.0f));
 
-							CheckForClickAndSetTexture(textures.metalness);
+							CheckForClickAndSetTexture(textures.metalness, Engine::TextureSlot::Metalness);
 							ImGui::Checkbox("Enable##Metalness", &textures.useMetalness);
 						}
 
@@ -831,7 +969,7 @@ void Editor::DrawInspector()
 							else
 								ImGui::Image((ImTextureID)textures.roughness->GetRendererID(), ImVec2(64.0f, 64.0f));
 
-							CheckForClickAndSetTexture(textures.roughness);
+							CheckForClickAndSetTexture(textures.roughness, Engine::TextureSlot::Roughness);
 							ImGui::Checkbox("Enable##Roughness", &textures.useRoughness);
 						}
 
@@ -947,6 +1085,105 @@ void Editor::DrawDebugInfo()
 
 	ImGui::Separator();
 
+	const auto& meshStats = Engine::MeshLibrary::GetStatistics();
+	ImGui::Text("Resident meshes: %u", meshStats.residentMeshes);
+	ImGui::Text("Mesh loads: %u (%u hits, %u misses, %u evicted)", meshStats.loads, meshStats.hits, meshStats.misses, meshStats.evictions);
+
+	const auto textureStats = Engine::TextureLibrary::GetStatistics();
+	ImGui::Text("Resident textures: %u (%.2f MB, %.2f MB all textures)", textureStats.residentTextures,
+		textureStats.residentMemory / (1024.0f * 1024.0f), Engine::Texture::GetAllocatedMemory() / (1024.0f * 1024.0f));
+	ImGui::Text("Texture loads: %u (%u hits, %u misses, %u evicted)", textureStats.loads, textureStats.hits, textureStats.misses, textureStats.evictions);
+
+	const auto& uploadStats = Engine::Texture::GetUploadStatistics();
+	bool stageUploads = Engine::Texture::IsUploadStaging();
+	if (ImGui::Checkbox("Stage texture uploads", &stageUploads))
+		Engine::Texture::SetUploadStaging(stageUploads);
+	ImGui::Text("Texture uploads: %u, %.2f MB in %.2f ms (%u stalls)", uploadStats.uploads,
+		uploadStats.bytes / (1024.0f * 1024.0f), uploadStats.time, uploadStats.stalls);
+
+	static TextureUploadBenchmark uploadBenchmark;
+	if (ImGui::Button("Benchmark Texture Uploads"))
+		uploadBenchmark = BenchmarkTextureUploads("Assets/Meshes/sponza/textures");
+
+	if (uploadBenchmark.valid)
+	{
+		const float megabytes = uploadBenchmark.bytes / (1024.0f * 1024.0f);
+		ImGui::Text("%u textures, %.2f MB, decoded in %.2f ms", uploadBenchmark.textureCount, megabytes, uploadBenchmark.decode);
+		ImGui::Text("Direct: %.2f ms (%.0f MB/s)", uploadBenchmark.direct, megabytes / (uploadBenchmark.direct / 1000.0f));
+		ImGui::Text("Staged: %.2f ms (%.0f MB/s)", uploadBenchmark.staged, megabytes / (uploadBenchmark.staged / 1000.0f));
+	}
+
+	const auto& loaderStats = Engine::AsyncLoader::GetStatistics();
+	float loadBudget = Engine::AsyncLoader::GetFrameBudget();
+	if (ImGui::SliderFloat("Load budget (ms)", &loadBudget, 0.5f, 16.0f))
+		Engine::AsyncLoader::SetFrameBudget(loadBudget);
+	ImGui::Text("Streaming: %u decoding, %u waiting, %u finalized last frame (%.3f ms)", loaderStats.pendingDecodes,
+		loaderStats.pendingFinalizes, loaderStats.finalizedLastFrame, loaderStats.finalizeTime);
+
+	const auto& watcherStats = Engine::FileWatcher::GetStatistics();
+	float debounceTime = Engine::FileWatcher::GetDebounceTime();
+	if (ImGui::SliderFloat("Reload debounce (ms)", &debounceTime, 0.0f, 1000.0f))
+		Engine::FileWatcher::SetDebounceTime(debounceTime);
+	ImGui::Text("Hot reload: %s, %u changed files (%u notifications)", Engine::FileWatcher::IsRunning() ? "watching" : "off",
+		watcherStats.changes, watcherStats.events);
+
+	ImGui::Separator();
+
+	const auto& rendererStats = Engine::Renderer::GetStatistics();
+	bool multiDrawIndirect = Engine::Renderer::IsMultiDrawIndirectEnabled();
+	if (ImGui::Checkbox("Multi Draw Indirect", &multiDrawIndirect))
+		Engine::Renderer::SetMultiDrawIndirect(multiDrawIndirect);
+
+	ImGui::Text("Draw calls: %u (%u instances, %u indirect commands)", rendererStats.drawCalls, rendererStats.instances, rendererStats.indirectCommands);
+	ImGui::Text("State changes: %u (%u shader, %u pipeline, %u texture)", rendererStats.GetStateChanges(),
+		rendererStats.shaderBinds, rendererStats.pipelineBinds, rendererStats.textureBinds);
+	ImGui::Text("Draw sort: %.3f ms", rendererStats.sortTime);
+
+	const auto& streamingStats = Engine::Renderer::GetStreamingStatistics();
+	ImGui::Text("Streaming buffer: %.1f KB in %u allocations, %u stalls (%.3f ms), %u resizes", streamingStats.bytes / 1024.0f,
+		streamingStats.allocations, streamingStats.stalls, streamingStats.stallTime, streamingStats.resizes);
+
+	const auto& shaderStats = Engine::Shader::GetCacheStatistics();
+	bool programCache = Engine::Shader::IsProgramCacheEnabled();
+	if (ImGui::Checkbox("Program cache", &programCache))
+		Engine::Shader::SetProgramCache(programCache);
+	ImGui::Text("Shader programs: %u loaded in %.2f ms, %u compiled in %.2f ms (%u rejected binaries)", shaderStats.cacheHits, shaderStats.loadTime,
+		shaderStats.programs - shaderStats.cacheHits, shaderStats.compileTime, shaderStats.rejectedBinaries);
+	ImGui::Text("PBR variants: %u", Engine::Renderer::GetShader("PBR")->GetVariantCount());
+
+	bool frustumCulling = Engine::Renderer::IsFrustumCullingEnabled();
+	if (ImGui::Checkbox("Frustum Culling", &frustumCulling))
+		Engine::Renderer::SetFrustumCulling(frustumCulling);
+
+	ImGui::Text("Sub meshes: %u visible, %u culled (%.3f ms)", rendererStats.visibleSubMeshes, rendererStats.culledSubMeshes, rendererStats.cullTime);
+
+	for (bool compact : { false, true })
+	{
+		const auto& arenaStats = Engine::Renderer::GetGeometryArena(compact)->GetStatistics();
+		ImGui::Text("%s arena: %u / %u vertices, %u / %u indices", compact ? "Compact" : "Standard",
+			arenaStats.vertexCount, arenaStats.vertexCapacity, arenaStats.indexCount, arenaStats.indexCapacity);
+	}
+
+	ImGui::Separator();
+
+	static RayKernelBenchmark rayBenchmark;
+	ImGui::Text("Ray kernels: %s", Engine::Math::GetSIMDLevelName(Engine::Math::GetSIMDLevel()));
+	if (ImGui::Button("Benchmark Ray Kernels"))
+		rayBenchmark = BenchmarkRayKernels();
+
+	if (rayBenchmark.valid)
+	{
+		ImGui::Text("%u rays x %u triangles", RayKernelBenchmark::RayCount, RayKernelBenchmark::TriangleCount);
+		ImGui::Text("RayIntersectsTriangle: %.3f ms", rayBenchmark.reference);
+		for (int level = 0; level <= static_cast<int>(Engine::Math::GetSupportedSIMDLevel()); level++)
+		{
+			ImGui::Text("%s: %.3f ms single, %.3f ms packets", Engine::Math::GetSIMDLevelName(static_cast<Engine::SIMDLevel>(level)),
+				rayBenchmark.single[level], rayBenchmark.packet[level]);
+		}
+	}
+
+	ImGui::Separator();
+
 	ImGui::Checkbox("Tonemapping", &m_EnableTonemapping);
 	ImGui::SliderFloat("Exposure", &m_Exposure, 0.1f, 10.0f);
 
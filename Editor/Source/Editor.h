@@ -26,7 +26,9 @@ private:
 	void MainRenderPass();
 	void CompositionRenderPass();
 
+	// Loads the filtered cubemaps from the environment cache, baking and caching them on a miss
 	Engine::Environment CreateEnvironment(const std::string &filepath);
+	void BakeEnvironment(const std::string &filepath, Engine::TextureCube &radianceMap, Engine::TextureCube &irradianceMap);
 
 	void BeginDockspace();
 	void EndDockspace();
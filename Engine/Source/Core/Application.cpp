@@ -2,8 +2,14 @@
 #include "Application.h"
 
 #include "Event.h"
+#include "JobSystem.h"
+#include "AsyncLoader.h"
+#include "FileWatcher.h"
 
 #include "Graphics/Renderer.h"
+#include "Graphics/TextureLibrary.h"
+#include "Graphics/MeshLibrary.h"
+#include "Graphics/Shader.h"
 #include "Graphics/ImGuiHelper.h"
 
 #include <GLFW/glfw3.h>
@@ -20,15 +26,32 @@ namespace Engine
 
 		ME_INFO("Starting up ...");
 
+		JobSystem::Initialize();
+
 		m_Window = MakeUnique<Window>("Mini Engine", 1280, 720);
 
 		Renderer::Initialize();
+		TextureLibrary::Initialize();
 		ImGuiHelper::Initialize();
+
+		// Assets edited on disk are reloaded in place, existing handles stay valid
+		FileWatcher::Initialize("Assets");
+		FileWatcher::AddListener([](const std::string &filepath)
+			{
+				Shader::ReloadDependents(filepath);
+				TextureLibrary::Reload(filepath);
+				MeshLibrary::Reload(filepath);
+			});
 	}
 
 	Application::~Application()
 	{
+		FileWatcher::Shutdown();
+		TextureLibrary::Shutdown();
+		Texture::Shutdown();
 		Renderer::Shutdown();
+		JobSystem::Shutdown();
+		AsyncLoader::Shutdown();
 
 		ME_INFO("Shutting down ...");
 	}
@@ -55,11 +78,20 @@ namespace Engine
 
 			m_Window->ClearEventBuffer();
 
+			// Create GL objects for assets that finished decoding in the background
+			AsyncLoader::Update();
+			// Reloads assets that changed on disk, their decodes finish through the loader as well
+			FileWatcher::Update();
+
+			Renderer::BeginFrame();
+
 			OnUpdate(deltaTime);
 
 			ImGuiHelper::BeginFrame();
 			OnImGui();
 			ImGuiHelper::EndFrame();
+
+			Renderer::EndFrame();
 		}
 
 		OnDestroy();
@@ -0,0 +1,104 @@
+#include "Precompiled.h"
+#include "AsyncLoader.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+
+namespace Engine
+{
+	struct AsyncLoaderData
+	{
+		std::mutex mutex;
+		std::deque<Job> finalizeQueue;
+
+		std::atomic<u32> pendingDecodes { 0 };
+		float frameBudget = 2.0f;
+
+		AsyncLoaderStatistics statistics;
+	};
+	static AsyncLoaderData s_AsyncLoaderData;
+
+	void AsyncLoader::Shutdown()
+	{
+		// Decodes were drained by the job system, their results are simply dropped
+		std::lock_guard<std::mutex> lock(s_AsyncLoaderData.mutex);
+		s_AsyncLoaderData.finalizeQueue.clear();
+	}
+
+	void AsyncLoader::Load(DecodeFunction decode)
+	{
+		auto &data = s_AsyncLoaderData;
+		data.pendingDecodes++;
+
+		JobSystem::Execute([decode = std::move(decode)]()
+			{
+				auto &data = s_AsyncLoaderData;
+				Job finalize = decode();
+
+				{
+					std::lock_guard<std::mutex> lock(data.mutex);
+					if (finalize)
+						data.finalizeQueue.push_back(std::move(finalize));
+				}
+				data.pendingDecodes--;
+			});
+	}
+
+	void AsyncLoader::QueueFinalize(Job finalize)
+	{
+		std::lock_guard<std::mutex> lock(s_AsyncLoaderData.mutex);
+		s_AsyncLoaderData.finalizeQueue.push_back(std::move(finalize));
+	}
+
+	void AsyncLoader::Update()
+	{
+		auto &data = s_AsyncLoaderData;
+		auto &stats = data.statistics;
+
+		stats.finalizedLastFrame = 0;
+		stats.finalizeTime = 0.0f;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		while (true)
+		{
+			Job finalize;
+			{
+				std::lock_guard<std::mutex> lock(data.mutex);
+				if (data.finalizeQueue.empty())
+					break;
+
+				finalize = std::move(data.finalizeQueue.front());
+				data.finalizeQueue.pop_front();
+			}
+
+			finalize();
+			stats.finalizedLastFrame++;
+
+			// At least one step per frame so a single large asset still gets through
+			stats.finalizeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			if (stats.finalizeTime >= data.frameBudget)
+				break;
+		}
+
+		std::lock_guard<std::mutex> lock(data.mutex);
+		stats.pendingFinalizes = static_cast<u32>(data.finalizeQueue.size());
+		stats.pendingDecodes = data.pendingDecodes;
+	}
+
+	void AsyncLoader::SetFrameBudget(float milliseconds)
+	{
+		s_AsyncLoaderData.frameBudget = milliseconds;
+	}
+	float AsyncLoader::GetFrameBudget()
+	{
+		return s_AsyncLoaderData.frameBudget;
+	}
+
+	const AsyncLoaderStatistics &AsyncLoader::GetStatistics()
+	{
+		return s_AsyncLoaderData.statistics;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "EngineBase.h"
+#include "JobSystem.h"
+
+#include <functional>
+
+
+namespace Engine
+{
+	struct AsyncLoaderStatistics
+	{
+		u32 pendingDecodes = 0;		// Still running on the job system
+		u32 pendingFinalizes = 0;	// Decoded, waiting for the main thread
+		u32 finalizedLastFrame = 0;
+		float finalizeTime = 0.0f;	// ms spent finalizing during the last Update()
+	};
+
+	// Streams assets in two steps: the decode step runs on the job system and must not
+	// touch GL, it returns the finalize step which runs on the main thread during
+	// Update() and creates the GL objects. Update() stops starting new finalize steps
+	// once the frame budget is used up, so loading never stalls a frame for long.
+	class AsyncLoader
+	{
+	public:
+		using DecodeFunction = std::function<Job()>;
+
+	public:
+		static void Shutdown();
+
+		static void Load(DecodeFunction decode);
+		// Queues an extra main thread step, for decode steps that produce several assets
+		static void QueueFinalize(Job finalize);
+
+		// Called once per frame by the application
+		static void Update();
+
+		static void SetFrameBudget(float milliseconds);
+		static float GetFrameBudget();
+
+		static const AsyncLoaderStatistics &GetStatistics();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "Precompiled.h"
+#include "FileWatcher.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef ME_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <poll.h>
+	#include <unistd.h>
+	#include <sys/inotify.h>
+#endif
+
+
+namespace Engine
+{
+	using WatchClock = std::chrono::steady_clock;
+
+	// The watcher thread wakes up this often (ms) to notice Shutdown()
+	static constexpr int s_PollInterval = 100;
+
+	struct FileWatcherData
+	{
+		std::string directory;
+		std::thread thread;
+		std::atomic<bool> running { false };
+
+		// Filled by the watcher thread, drained by Update()
+		std::mutex mutex;
+		std::unordered_map<std::string, WatchClock::time_point> pending;	// Filepath -> last notification
+		u32 events = 0;
+
+		std::vector<FileWatcher::Callback> listeners;
+		float debounceTime = 200.0f;
+		FileWatcherStatistics statistics;
+	};
+	static FileWatcherData s_FileWatcherData;
+
+	static void RecordChange(const std::filesystem::path &relativePath)
+	{
+		auto &data = s_FileWatcherData;
+		std::string filepath = (std::filesystem::path(data.directory) / relativePath).lexically_normal().generic_string();
+
+		std::lock_guard<std::mutex> lock(data.mutex);
+		data.pending[filepath] = WatchClock::now();
+		data.events++;
+	}
+
+#ifdef ME_PLATFORM_WINDOWS
+	static void WatchDirectory()
+	{
+		auto &data = s_FileWatcherData;
+
+		HANDLE directory = CreateFileA(data.directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (directory == INVALID_HANDLE_VALUE)
+		{
+			ME_ERROR("Failed to watch directory: %s", data.directory.c_str());
+			data.running = false;
+			return;
+		}
+
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+		// FILE_NOTIFY_INFORMATION entries have to be DWORD aligned
+		std::vector<DWORD> buffer(16 * 1024);
+		const DWORD bufferSize = static_cast<DWORD>(buffer.size() * sizeof(DWORD));
+		const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+		bool reading = false;
+		while (data.running)
+		{
+			if (!reading)
+			{
+				ResetEvent(overlapped.hEvent);
+				if (!ReadDirectoryChangesW(directory, buffer.data(), bufferSize, TRUE, filter, nullptr, &overlapped, nullptr))
+				{
+					ME_ERROR("Failed to read directory changes: %s", data.directory.c_str());
+					data.running = false;
+					break;
+				}
+				reading = true;
+			}
+
+			if (WaitForSingleObject(overlapped.hEvent, s_PollInterval) != WAIT_OBJECT_0)
+				continue;
+			reading = false;
+
+			// Zero bytes means the buffer overflowed and the notifications are lost
+			DWORD bytes = 0;
+			if (!GetOverlappedResult(directory, &overlapped, &bytes, FALSE) || bytes == 0)
+				continue;
+
+			const u8 *entry = reinterpret_cast<const u8 *>(buffer.data());
+			while (true)
+			{
+				auto *info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(entry);
+				if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+					RecordChange(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+				if (!info->NextEntryOffset)
+					break;
+				entry += info->NextEntryOffset;
+			}
+		}
+
+		if (reading)
+		{
+			DWORD bytes;
+			CancelIoEx(directory, &overlapped);
+			GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+		}
+
+		CloseHandle(overlapped.hEvent);
+		CloseHandle(directory);
+	}
+#else
+	static void WatchDirectory()
+	{
+		auto &data = s_FileWatcherData;
+
+		int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (notify < 0)
+		{
+			ME_ERROR("Failed to watch directory: %s", data.directory.c_str());
+			data.running = false;
+			return;
+		}
+
+		// inotify isn't recursive, every directory gets its own watch
+		std::unordered_map<int, std::filesystem::path> watches;	// Watch descriptor -> path inside the directory
+		auto AddWatch = [&](const std::filesystem::path &relativePath)
+		{
+			std::string path = (std::filesystem::path(data.directory) / relativePath).string();
+			int watch = inotify_add_watch(notify, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (watch < 0)
+			{
+				ME_WARN("Failed to watch directory: %s", path.c_str());
+				return;
+			}
+			watches[watch] = relativePath;
+		};
+
+		AddWatch(std::filesystem::path());
+
+		std::error_code error;
+		for (auto it = std::filesystem::recursive_directory_iterator(data.directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if (it->is_directory(error))
+				AddWatch(it->path().lexically_relative(data.directory));
+		}
+
+		alignas(inotify_event) char buffer[16 * 1024];
+		while (data.running)
+		{
+			pollfd descriptor = { notify, POLLIN, 0 };
+			if (poll(&descriptor, 1, s_PollInterval) <= 0)
+				continue;
+
+			ssize_t length = read(notify, buffer, sizeof(buffer));
+			for (ssize_t offset = 0; offset < length;)
+			{
+				auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				// The watched directory was deleted or moved away
+				if (event->mask & IN_IGNORED)
+				{
+					watches.erase(event->wd);
+					continue;
+				}
+
+				auto it = watches.find(event->wd);
+				if (it == watches.end() || !event->len)
+					continue;
+
+				std::filesystem::path relativePath = it->second / event->name;
+				if (event->mask & IN_ISDIR)
+				{
+					// Files that came along with a moved in directory aren't reported
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						AddWatch(relativePath);
+					continue;
+				}
+
+				RecordChange(relativePath);
+			}
+		}
+
+		close(notify);
+	}
+#endif
+
+	void FileWatcher::Initialize(const std::string &directory)
+	{
+		auto &data = s_FileWatcherData;
+		ME_ASSERT(!data.thread.joinable());
+
+		std::error_code error;
+		if (!std::filesystem::is_directory(directory, error))
+		{
+			ME_WARN("Not watching %s, directory not found", directory.c_str());
+			return;
+		}
+
+		data.directory = directory;
+		data.running = true;
+		data.thread = std::thread(WatchDirectory);
+
+		ME_INFO("Watching %s for changes", directory.c_str());
+	}
+
+	void FileWatcher::Shutdown()
+	{
+		auto &data = s_FileWatcherData;
+
+		data.running = false;
+		if (data.thread.joinable())
+			data.thread.join();
+
+		data.pending.clear();
+		data.listeners.clear();
+	}
+
+	bool FileWatcher::IsRunning()
+	{
+		return s_FileWatcherData.running;
+	}
+
+	void FileWatcher::AddListener(Callback callback)
+	{
+		s_FileWatcherData.listeners.push_back(std::move(callback));
+	}
+
+	void FileWatcher::Update()
+	{
+		auto &data = s_FileWatcherData;
+
+		std::vector<std::string> changes;
+		{
+			std::lock_guard<std::mutex> lock(data.mutex);
+
+			data.statistics.events += data.events;
+			data.events = 0;
+
+			const auto settled = WatchClock::now() - std::chrono::duration_cast<WatchClock::duration>(std::chrono::duration<float, std::milli>(data.debounceTime));
+			for (auto it = data.pending.begin(); it != data.pending.end();)
+			{
+				if (it->second <= settled)
+				{
+					changes.push_back(it->first);
+					it = data.pending.erase(it);
+				}
+				else
+					it++;
+			}
+		}
+
+		// Listeners run without the lock, they are free to take their time
+		for (auto &filepath : changes)
+		{
+			ME_TRACE("File changed: %s", filepath.c_str());
+			data.statistics.changes++;
+
+			for (auto &listener : data.listeners)
+				listener(filepath);
+		}
+	}
+
+	void FileWatcher::SetDebounceTime(float milliseconds)
+	{
+		s_FileWatcherData.debounceTime = milliseconds;
+	}
+
+	float FileWatcher::GetDebounceTime()
+	{
+		return s_FileWatcherData.debounceTime;
+	}
+
+	const FileWatcherStatistics &FileWatcher::GetStatistics()
+	{
+		return s_FileWatcherData.statistics;
+	}
+}
\ No newline at end of file
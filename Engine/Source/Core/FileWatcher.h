@@ -0,0 +1,42 @@
+#pragma once
+#include "EngineBase.h"
+
+#include <functional>
+#include <string>
+
+
+namespace Engine
+{
+	struct FileWatcherStatistics
+	{
+		u32 events = 0;			// Raw notifications received by the watcher thread
+		u32 changes = 0;		// Files handed to the listeners after debouncing
+	};
+
+	// Watches a directory tree on a background thread (ReadDirectoryChangesW on Windows,
+	// inotify elsewhere). Editors tend to save in several steps, so notifications are
+	// only collected there: Update() hands a file to the listeners on the main thread
+	// once it stayed untouched for the debounce time.
+	class FileWatcher
+	{
+	public:
+		// Receives "<directory>/<path inside it>" with forward slashes
+		using Callback = std::function<void(const std::string &filepath)>;
+
+	public:
+		static void Initialize(const std::string &directory);
+		static void Shutdown();
+
+		static bool IsRunning();
+
+		static void AddListener(Callback callback);
+
+		// Called once per frame by the application
+		static void Update();
+
+		static void SetDebounceTime(float milliseconds);
+		static float GetDebounceTime();
+
+		static const FileWatcherStatistics &GetStatistics();
+	};
+}
\ No newline at end of file
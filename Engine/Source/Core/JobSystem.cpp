@@ -0,0 +1,228 @@
+#include "Precompiled.h"
+#include "JobSystem.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+namespace Engine
+{
+	struct QueuedJob
+	{
+		Job function;
+		JobCounter *counter;
+	};
+
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+	};
+
+	struct JobSystemData
+	{
+		std::vector<std::thread> workers;
+		// Index 0 belongs to the main thread, the others to their worker
+		std::vector<UniquePtr<JobQueue>> queues;
+
+		std::atomic<u32> queuedJobs { 0 };
+		std::atomic<bool> running { false };
+
+		std::mutex wakeMutex;
+		std::condition_variable wakeCondition;
+	};
+	static JobSystemData s_JobSystemData;
+
+	static thread_local u32 s_ThreadIndex = 0;
+
+	bool JobSystem::PopJob(u32 threadIndex, QueuedJob &job)
+	{
+		auto &data = s_JobSystemData;
+		const u32 queueCount = static_cast<u32>(data.queues.size());
+
+		// Own queue first, newest job is the one most likely still in cache
+		{
+			JobQueue &queue = *data.queues[threadIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				data.queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// Steal the oldest job of someone else
+		for (u32 i = 1; i < queueCount; i++)
+		{
+			JobQueue &queue = *data.queues[(threadIndex + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				data.queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::RunJob(QueuedJob &job)
+	{
+		job.function();
+
+		if (job.counter)
+			job.counter->m_Pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::WorkerLoop(u32 threadIndex)
+	{
+		auto &data = s_JobSystemData;
+		s_ThreadIndex = threadIndex;
+
+		while (data.running.load(std::memory_order_acquire))
+		{
+			QueuedJob job;
+			if (PopJob(threadIndex, job))
+			{
+				RunJob(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(data.wakeMutex);
+			data.wakeCondition.wait(lock, [&data]()
+				{
+					return !data.running.load(std::memory_order_acquire) || data.queuedJobs.load(std::memory_order_relaxed) > 0;
+				});
+		}
+	}
+
+	void JobSystem::Initialize(u32 workerCount)
+	{
+		auto &data = s_JobSystemData;
+		ME_ASSERT(!data.running);	// Already initialized
+
+		if (workerCount == 0)
+		{
+			u32 hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		data.queues.clear();
+		for (u32 i = 0; i < workerCount + 1; i++)
+			data.queues.push_back(MakeUnique<JobQueue>());
+
+		data.running = true;
+
+		for (u32 i = 1; i <= workerCount; i++)
+			data.workers.emplace_back(WorkerLoop, i);
+
+		ME_INFO("Job system started with %u workers", workerCount);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		auto &data = s_JobSystemData;
+		if (!data.running)
+			return;
+
+		// Finish what is queued so nobody is left waiting on a counter
+		QueuedJob job;
+		while (PopJob(0, job))
+			RunJob(job);
+
+		{
+			std::lock_guard<std::mutex> lock(data.wakeMutex);
+			data.running = false;
+		}
+		data.wakeCondition.notify_all();
+
+		for (auto &worker : data.workers)
+			worker.join();
+
+		data.workers.clear();
+		data.queues.clear();
+	}
+
+	void JobSystem::Execute(Job job, JobCounter *counter)
+	{
+		auto &data = s_JobSystemData;
+
+		if (counter)
+			counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+		// Run inline when there is no pool to hand the job to
+		if (!data.running)
+		{
+			QueuedJob inlineJob = { std::move(job), counter };
+			RunJob(inlineJob);
+			return;
+		}
+
+		{
+			JobQueue &queue = *data.queues[s_ThreadIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back({ std::move(job), counter });
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(data.wakeMutex);
+			data.queuedJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+		data.wakeCondition.notify_one();
+	}
+
+	void JobSystem::Wait(const JobCounter &counter)
+	{
+		while (!counter.IsDone())
+		{
+			QueuedJob job;
+			if (s_JobSystemData.running && PopJob(s_ThreadIndex, job))
+				RunJob(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::ParallelFor(u32 count, u32 minBatchSize, const std::function<void(u32, u32)> &function)
+	{
+		if (count == 0)
+			return;
+
+		// A few batches per thread keeps everyone busy when batches take uneven time
+		const u32 threadCount = GetWorkerCount() + 1;
+		u32 batchSize = std::max(std::max(minBatchSize, 1u), (count + threadCount * 4 - 1) / (threadCount * 4));
+
+		if (threadCount == 1 || count <= batchSize)
+		{
+			function(0, count);
+			return;
+		}
+
+		JobCounter counter;
+		for (u32 begin = batchSize; begin < count; begin += batchSize)
+		{
+			u32 end = std::min(begin + batchSize, count);
+			Execute([&function, begin, end]() { function(begin, end); }, &counter);
+		}
+
+		// The calling thread takes the first batch itself
+		function(0, batchSize);
+		Wait(counter);
+	}
+
+	u32 JobSystem::GetWorkerCount()
+	{
+		return static_cast<u32>(s_JobSystemData.workers.size());
+	}
+
+	u32 JobSystem::GetThreadIndex()
+	{
+		return s_ThreadIndex;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "EngineBase.h"
+
+#include <atomic>
+#include <functional>
+
+
+namespace Engine
+{
+	using Job = std::function<void()>;
+
+	struct QueuedJob;
+
+	// Tracks a group of jobs. Pass it to Execute() for every job of the group and
+	// JobSystem::Wait() on it to express a dependency on all of them.
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+
+		JobCounter(const JobCounter &) = delete;
+		JobCounter &operator=(const JobCounter &) = delete;
+
+		bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		std::atomic<u32> m_Pending { 0 };
+
+		friend class JobSystem;
+	};
+
+	// Pool of one worker per additional core. Every thread owns a deque: it pushes
+	// and pops its own jobs at the back and idle threads steal from the front.
+	class JobSystem
+	{
+	public:
+		// workerCount 0 picks one worker per hardware thread besides the main thread
+		static void Initialize(u32 workerCount = 0);
+		static void Shutdown();
+
+		static void Execute(Job job, JobCounter *counter = nullptr);
+
+		// Runs queued jobs on the calling thread until the counter reaches zero
+		static void Wait(const JobCounter &counter);
+
+		// Calls function(begin, end) on batches of at least minBatchSize elements of [0, count)
+		// spread over all threads and returns once every batch is done
+		static void ParallelFor(u32 count, u32 minBatchSize, const std::function<void(u32, u32)> &function);
+
+		static u32 GetWorkerCount();
+		// 0 on the main thread (or any thread outside the pool), 1..n on workers
+		static u32 GetThreadIndex();
+
+	private:
+		static bool PopJob(u32 threadIndex, QueuedJob &job);
+		static void RunJob(QueuedJob &job);
+		static void WorkerLoop(u32 threadIndex);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "Precompiled.h"
+#include "MappedFile.h"
+
+#ifdef ME_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+namespace Engine
+{
+	MappedFile::MappedFile(const std::string &filepath)
+	{
+		Open(filepath);
+	}
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef ME_PLATFORM_WINDOWS
+	bool MappedFile::Open(const std::string &filepath)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_FileHandle = file;
+		m_MappingHandle = mapping;
+		m_Data = static_cast<const u8 *>(data);
+		m_Size = static_cast<std::size_t>(size.QuadPart);
+
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_FileHandle = nullptr;
+		m_MappingHandle = nullptr;
+	}
+#else
+	bool MappedFile::Open(const std::string &filepath)
+	{
+		Close();
+
+		int file = open(filepath.c_str(), O_RDONLY);
+		if (file == -1)
+			return false;
+
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void *data = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_Data = static_cast<const u8 *>(data);
+		m_Size = static_cast<std::size_t>(info.st_size);
+
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			munmap(const_cast<u8 *>(m_Data), m_Size);
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "EngineBase.h"
+
+#include <string>
+
+
+namespace Engine
+{
+	// Read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const std::string &filepath);
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		bool Open(const std::string &filepath);
+		void Close();
+
+		bool IsOpen() const { return m_Data != nullptr; }
+
+		const u8 *GetData() const { return m_Data; }
+		std::size_t GetSize() const { return m_Size; }
+
+	private:
+		const u8 *m_Data = nullptr;
+		std::size_t m_Size = 0;
+
+		void *m_FileHandle = nullptr;
+		void *m_MappingHandle = nullptr;
+	};
+}
\ No newline at end of file
@@ -5,11 +5,17 @@
 #include "Core/Application.h"
 #include "Core/Event.h"
 #include "Core/Input.h"
+#include "Core/JobSystem.h"
+#include "Core/AsyncLoader.h"
+#include "Core/FileWatcher.h"
 
 #include "Graphics/Renderer.h"
 #include "Graphics/Camera.h"
 #include "Graphics/Texture.h"
+#include "Graphics/TextureLibrary.h"
+#include "Graphics/EnvironmentSerializer.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/MeshLibrary.h"
 #include "Graphics/Framebuffer.h"
 
 #include "Util/Math.h"
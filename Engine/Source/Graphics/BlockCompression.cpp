@@ -0,0 +1,529 @@
+#include "Precompiled.h"
+#include "BlockCompression.h"
+
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <cstring>
+
+
+namespace Engine
+{
+	static constexpr u32 BlockPixels = 16;
+
+	// 4x4 RGBA8 pixels, row major
+	struct PixelBlock
+	{
+		u8 pixels[BlockPixels][4];
+	};
+
+	struct BitWriter
+	{
+		u8 *data;
+		u32 position = 0;
+
+		void Write(u32 value, u32 count)
+		{
+			for (u32 bit = 0; bit < count; bit++, position++)
+			{
+				if ((value >> bit) & 1)
+					data[position >> 3] |= u8(1 << (position & 7));
+			}
+		}
+	};
+
+	static int ClampInt(int value, int min, int max)
+	{
+		return value < min ? min : (value > max ? max : value);
+	}
+
+	// Mean and dominant direction of the first channel count components, found with a few power iterations
+	static void FindPrincipalAxis(const PixelBlock &block, u32 channels, float (&mean)[4], float (&axis)[4])
+	{
+		for (u32 c = 0; c < 4; c++)
+			mean[c] = axis[c] = 0.0f;
+
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			for (u32 c = 0; c < channels; c++)
+				mean[c] += block.pixels[i][c];
+		}
+		for (u32 c = 0; c < channels; c++)
+			mean[c] /= BlockPixels;
+
+		float covariance[4][4] = {};
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			float d[4];
+			for (u32 c = 0; c < channels; c++)
+				d[c] = block.pixels[i][c] - mean[c];
+
+			for (u32 a = 0; a < channels; a++)
+			{
+				for (u32 b = 0; b < channels; b++)
+					covariance[a][b] += d[a] * d[b];
+			}
+		}
+
+		// Start along the channel with the largest spread
+		u32 largest = 0;
+		for (u32 c = 1; c < channels; c++)
+		{
+			if (covariance[c][c] > covariance[largest][largest])
+				largest = c;
+		}
+		if (covariance[largest][largest] <= 0.0f)
+			return;
+
+		for (u32 c = 0; c < channels; c++)
+			axis[c] = covariance[largest][c];
+
+		for (u32 iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float scale = 0.0f;
+			for (u32 a = 0; a < channels; a++)
+			{
+				for (u32 b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				scale = std::max(scale, std::abs(next[a]));
+			}
+			if (scale <= 0.0f)
+				break;
+
+			for (u32 c = 0; c < channels; c++)
+				axis[c] = next[c] / scale;
+		}
+
+		float length = 0.0f;
+		for (u32 c = 0; c < channels; c++)
+			length += axis[c] * axis[c];
+		length = std::sqrt(length);
+
+		for (u32 c = 0; c < channels; c++)
+			axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+	}
+
+	// Endpoints at the extent of the block's projection onto its principal axis
+	static void FindEndpoints(const PixelBlock &block, u32 channels, float (&start)[4], float (&end)[4])
+	{
+		float mean[4], axis[4];
+		FindPrincipalAxis(block, channels, mean, axis);
+
+		float minT = 0.0f, maxT = 0.0f;
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			float t = 0.0f;
+			for (u32 c = 0; c < channels; c++)
+				t += (block.pixels[i][c] - mean[c]) * axis[c];
+
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		for (u32 c = 0; c < channels; c++)
+		{
+			start[c] = mean[c] + axis[c] * minT;
+			end[c] = mean[c] + axis[c] * maxT;
+		}
+	}
+
+	// Least squares endpoints for fixed interpolation weights (0 selects start, 1 end),
+	// returns false if all pixels use the same weight
+	static bool RefineEndpoints(const PixelBlock &block, u32 channels, const float (&weights)[BlockPixels], float (&start)[4], float (&end)[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			float b = weights[i], a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (u32 c = 0; c < channels; c++)
+			{
+				ax[c] += a * block.pixels[i][c];
+				bx[c] += b * block.pixels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		for (u32 c = 0; c < channels; c++)
+		{
+			start[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			end[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	// BC1
+
+	static u16 PackRGB565(const float (&color)[4])
+	{
+		int r = ClampInt(int(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = ClampInt(int(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = ClampInt(int(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return u16((r << 11) | (g << 5) | b);
+	}
+
+	static void UnpackRGB565(u16 packed, int (&color)[3])
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Picks the closest of the four palette entries, returns the squared error of the block
+	static u32 SelectColorIndices(const PixelBlock &block, u16 color0, u16 color1, u8 (&indices)[BlockPixels])
+	{
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (u32 c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		u32 totalError = 0;
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			u32 bestError = ~0u;
+			for (u32 entry = 0; entry < 4; entry++)
+			{
+				u32 error = 0;
+				for (u32 c = 0; c < 3; c++)
+				{
+					int d = block.pixels[i][c] - palette[entry][c];
+					error += u32(d * d);
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = u8(entry);
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	// Always uses the four color mode, as BC3 requires for its color block
+	static void EncodeColorBlock(const PixelBlock &block, u8 *output)
+	{
+		float start[4], end[4];
+		FindEndpoints(block, 3, start, end);
+
+		u16 color0 = PackRGB565(end), color1 = PackRGB565(start);
+		u8 indices[BlockPixels];
+		u32 error = SelectColorIndices(block, color0, color1, indices);
+
+		// One least squares pass usually recovers what endpoint quantization lost
+		static const float s_Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float weights[BlockPixels];
+		for (u32 i = 0; i < BlockPixels; i++)
+			weights[i] = s_Weights[indices[i]];
+
+		float refinedStart[4], refinedEnd[4];
+		if (RefineEndpoints(block, 3, weights, refinedStart, refinedEnd))
+		{
+			u16 refined0 = PackRGB565(refinedStart), refined1 = PackRGB565(refinedEnd);
+			u8 refinedIndices[BlockPixels];
+			u32 refinedError = SelectColorIndices(block, refined0, refined1, refinedIndices);
+			if (refinedError < error)
+			{
+				color0 = refined0;
+				color1 = refined1;
+				std::memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		// color0 > color1 selects the four color mode, equal endpoints only ever need index 0
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			static const u8 s_Swapped[4] = { 1, 0, 3, 2 };
+			for (auto &index : indices)
+				index = s_Swapped[index];
+		}
+		else if (color0 == color1)
+			std::memset(indices, 0, sizeof(indices));
+
+		u32 packedIndices = 0;
+		for (u32 i = 0; i < BlockPixels; i++)
+			packedIndices |= u32(indices[i]) << (2 * i);
+
+		output[0] = u8(color0);
+		output[1] = u8(color0 >> 8);
+		output[2] = u8(color1);
+		output[3] = u8(color1 >> 8);
+		std::memcpy(output + 4, &packedIndices, sizeof(packedIndices));
+	}
+
+	// BC4, also the alpha block of BC3 and both halves of BC5
+
+	static void EncodeChannelBlock(const PixelBlock &block, u32 channel, u8 *output)
+	{
+		int min = 255, max = 0;
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			min = std::min(min, int(block.pixels[i][channel]));
+			max = std::max(max, int(block.pixels[i][channel]));
+		}
+
+		// value0 > value1 selects eight interpolated values
+		int palette[8] = { max, min };
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * max + i * min) / 7;
+
+		output[0] = u8(max);
+		output[1] = u8(min);
+
+		u64 packedIndices = 0;
+		if (max != min)
+		{
+			for (u32 i = 0; i < BlockPixels; i++)
+			{
+				int value = block.pixels[i][channel];
+				u32 best = 0;
+				int bestError = 256;
+				for (u32 entry = 0; entry < 8; entry++)
+				{
+					int error = std::abs(value - palette[entry]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = entry;
+					}
+				}
+				packedIndices |= u64(best) << (3 * i);
+			}
+		}
+
+		for (u32 i = 0; i < 6; i++)
+			output[2 + i] = u8(packedIndices >> (8 * i));
+	}
+
+	// BC7 mode 6: a single subset of RGBA 7.7.7.7 endpoints with a p-bit each and 16 interpolation steps
+
+	static const int s_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BC7Endpoint
+	{
+		int values[4];		// 7 bit
+		int pBit;
+
+		int Get(u32 channel) const { return (values[channel] << 1) | pBit; }
+	};
+
+	static BC7Endpoint QuantizeBC7Endpoint(const float (&color)[4])
+	{
+		BC7Endpoint best = {};
+		float bestError = 1e30f;
+
+		for (int pBit = 0; pBit < 2; pBit++)
+		{
+			BC7Endpoint endpoint;
+			endpoint.pBit = pBit;
+
+			float error = 0.0f;
+			for (u32 c = 0; c < 4; c++)
+			{
+				endpoint.values[c] = ClampInt(int((color[c] - pBit) * 0.5f + 0.5f), 0, 127);
+				float d = float(endpoint.Get(c)) - color[c];
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				best = endpoint;
+			}
+		}
+		return best;
+	}
+
+	static u32 SelectBC7Indices(const PixelBlock &block, const BC7Endpoint &start, const BC7Endpoint &end, u8 (&indices)[BlockPixels])
+	{
+		int palette[16][4];
+		for (u32 entry = 0; entry < 16; entry++)
+		{
+			int w = s_BC7Weights[entry];
+			for (u32 c = 0; c < 4; c++)
+				palette[entry][c] = ((64 - w) * start.Get(c) + w * end.Get(c) + 32) >> 6;
+		}
+
+		u32 totalError = 0;
+		for (u32 i = 0; i < BlockPixels; i++)
+		{
+			u32 bestError = ~0u;
+			for (u32 entry = 0; entry < 16; entry++)
+			{
+				u32 error = 0;
+				for (u32 c = 0; c < 4; c++)
+				{
+					int d = block.pixels[i][c] - palette[entry][c];
+					error += u32(d * d);
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = u8(entry);
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	static void EncodeBC7Block(const PixelBlock &block, u8 *output)
+	{
+		float startColor[4], endColor[4];
+		FindEndpoints(block, 4, startColor, endColor);
+
+		BC7Endpoint start = QuantizeBC7Endpoint(startColor), end = QuantizeBC7Endpoint(endColor);
+		u8 indices[BlockPixels];
+		u32 error = SelectBC7Indices(block, start, end, indices);
+
+		float weights[BlockPixels];
+		for (u32 i = 0; i < BlockPixels; i++)
+			weights[i] = s_BC7Weights[indices[i]] / 64.0f;
+
+		if (RefineEndpoints(block, 4, weights, startColor, endColor))
+		{
+			BC7Endpoint refinedStart = QuantizeBC7Endpoint(startColor), refinedEnd = QuantizeBC7Endpoint(endColor);
+			u8 refinedIndices[BlockPixels];
+			u32 refinedError = SelectBC7Indices(block, refinedStart, refinedEnd, refinedIndices);
+			if (refinedError < error)
+			{
+				start = refinedStart;
+				end = refinedEnd;
+				std::memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		// The first index is stored without its top bit, so it has to be below 8
+		if (indices[0] & 8)
+		{
+			std::swap(start, end);
+			for (auto &index : indices)
+				index = u8(15 - index);
+		}
+
+		std::memset(output, 0, 16);
+		BitWriter writer = { output };
+		writer.Write(1 << 6, 7);
+		for (u32 c = 0; c < 4; c++)
+		{
+			writer.Write(u32(start.values[c]), 7);
+			writer.Write(u32(end.values[c]), 7);
+		}
+		writer.Write(u32(start.pBit), 1);
+		writer.Write(u32(end.pBit), 1);
+
+		writer.Write(indices[0], 3);
+		for (u32 i = 1; i < BlockPixels; i++)
+			writer.Write(indices[i], 4);
+	}
+
+	u32 BlockCompression::GetBlockSize(TextureCompression format)
+	{
+		switch (format)
+		{
+			case TextureCompression::BC1:
+			case TextureCompression::BC4:
+				return 8;
+			case TextureCompression::BC3:
+			case TextureCompression::BC5:
+			case TextureCompression::BC6H:
+			case TextureCompression::BC7:
+				return 16;
+			default:
+				return 0;
+		}
+	}
+
+	u64 BlockCompression::GetLevelSize(TextureCompression format, u32 width, u32 height)
+	{
+		return u64((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+	}
+
+	bool BlockCompression::CanEncode(TextureCompression format)
+	{
+		return format != TextureCompression::None && format != TextureCompression::BC6H;
+	}
+
+	const char *BlockCompression::GetName(TextureCompression format)
+	{
+		switch (format)
+		{
+			case TextureCompression::BC1: return "BC1";
+			case TextureCompression::BC3: return "BC3";
+			case TextureCompression::BC4: return "BC4";
+			case TextureCompression::BC5: return "BC5";
+			case TextureCompression::BC6H: return "BC6H";
+			case TextureCompression::BC7: return "BC7";
+			default: return "None";
+		}
+	}
+
+	bool BlockCompression::Encode(TextureCompression format, const u8 *pixels, u32 width, u32 height, u8 *output)
+	{
+		if (!CanEncode(format) || !width || !height)
+			return false;
+
+		const u32 blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		const u32 blockSize = GetBlockSize(format);
+
+		JobSystem::ParallelFor(blocksY, 4, [=](u32 begin, u32 end)
+			{
+				PixelBlock block;
+				for (u32 blockY = begin; blockY < end; blockY++)
+				{
+					for (u32 blockX = 0; blockX < blocksX; blockX++)
+					{
+						for (u32 y = 0; y < 4; y++)
+						{
+							u32 row = std::min(blockY * 4 + y, height - 1);
+							for (u32 x = 0; x < 4; x++)
+							{
+								u32 column = std::min(blockX * 4 + x, width - 1);
+								std::memcpy(block.pixels[y * 4 + x], pixels + (std::size_t(row) * width + column) * 4, 4);
+							}
+						}
+
+						u8 *target = output + (std::size_t(blockY) * blocksX + blockX) * blockSize;
+						switch (format)
+						{
+							case TextureCompression::BC1:
+								EncodeColorBlock(block, target);
+								break;
+							case TextureCompression::BC3:
+								EncodeChannelBlock(block, 3, target);
+								EncodeColorBlock(block, target + 8);
+								break;
+							case TextureCompression::BC4:
+								EncodeChannelBlock(block, 0, target);
+								break;
+							case TextureCompression::BC5:
+								EncodeChannelBlock(block, 0, target);
+								EncodeChannelBlock(block, 1, target + 8);
+								break;
+							case TextureCompression::BC7:
+								EncodeBC7Block(block, target);
+								break;
+							default:
+								break;
+						}
+					}
+				}
+			});
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+
+namespace Engine
+{
+	enum class TextureCompression : u32
+	{
+		None = 0,
+		BC1,		// RGB, 4 bits per pixel
+		BC3,		// RGBA, 8 bits per pixel
+		BC4,		// Single channel, 4 bits per pixel
+		BC5,		// Two channels, 8 bits per pixel
+		BC6H,		// HDR RGB, 8 bits per pixel, upload only
+		BC7,		// RGBA, 8 bits per pixel
+	};
+
+	// CPU encoders for the BCn block formats, used when importing textures into the cache.
+	// Blocks are encoded in parallel on the job system.
+	class BlockCompression
+	{
+	public:
+		// Bytes per 4x4 block
+		static u32 GetBlockSize(TextureCompression format);
+		static u64 GetLevelSize(TextureCompression format, u32 width, u32 height);
+
+		static bool CanEncode(TextureCompression format);
+		static const char *GetName(TextureCompression format);
+
+		// Compresses rows of RGBA8 pixels into GetLevelSize() bytes of output,
+		// partial blocks at the right and bottom edge repeat the last pixel
+		static bool Encode(TextureCompression format, const u8 *pixels, u32 width, u32 height, u8 *output);
+	};
+}
\ No newline at end of file
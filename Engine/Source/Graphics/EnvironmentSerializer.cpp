@@ -0,0 +1,185 @@
+#include "Precompiled.h"
+#include "EnvironmentSerializer.h"
+
+#include "ShaderPreprocessor.h"
+#include "Core/MappedFile.h"
+#include "Util/Hash.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+
+namespace Engine
+{
+	static const char *s_EnvironmentCacheDirectory = "Cache/Environments";
+	static const char s_EnvironmentCacheMagic[4] = { 'M', 'E', 'E', 'C' };
+
+	// Half floats keep the range of HDR environments at half the size of the RGBA32F cubemaps
+	static constexpr u64 s_BytesPerTexel = 4 * sizeof(u16);
+
+	struct EnvironmentCacheHeader
+	{
+		char magic[4];
+		u32 version;
+		u64 sourceHash;
+
+		u32 radianceSize, radianceLevels;
+		u32 irradianceSize, irradianceLevels;
+	};
+
+	// All six faces of one mip level
+	static u64 GetLevelSize(u32 size, u32 level)
+	{
+		const u64 levelSize = glm::max(size >> level, 1u);
+		return levelSize * levelSize * 6 * s_BytesPerTexel;
+	}
+
+	static u64 GetCubemapSize(u32 size, u32 levels)
+	{
+		u64 bytes = 0;
+		for (u32 level = 0; level < levels; level++)
+			bytes += GetLevelSize(size, level);
+		return bytes;
+	}
+
+	u64 EnvironmentSerializer::CalculateSourceHash(const std::string &filepath, u32 cubemapSize, u32 irradianceMapSize, const std::vector<std::string> &shaderPaths)
+	{
+		u64 hash = Hash::File(filepath);
+		if (!hash)
+			return 0;
+
+		hash = Hash::FNV1aValue(cubemapSize, hash);
+		hash = Hash::FNV1aValue(irradianceMapSize, hash);
+		hash = Hash::FNV1aValue(Version, hash);
+
+		// Includes are resolved, so editing a shared include invalidates the cache as well
+		for (auto &shaderPath : shaderPaths)
+		{
+			ShaderSource source;
+			if (!ShaderPreprocessor::Process(shaderPath, source, GL_COMPUTE_SHADER))
+				return 0;
+
+			for (auto &stage : source.stages)
+				hash = Hash::FNV1a(stage.source, hash);
+		}
+
+		return hash;
+	}
+
+	std::string EnvironmentSerializer::GetCachePath(u64 sourceHash)
+	{
+		return std::string(s_EnvironmentCacheDirectory) + "/" + Hash::ToString(sourceHash) + ".env";
+	}
+
+	bool EnvironmentSerializer::Serialize(const TextureCube &radianceMap, const TextureCube &irradianceMap, const std::string &cachePath, u64 sourceHash)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+		// Write to a temporary file first so a partially written cache is never picked up
+		std::string temporaryPath = cachePath + ".tmp";
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			ME_WARN("Failed to create Environment cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		EnvironmentCacheHeader header = {};
+		std::memcpy(header.magic, s_EnvironmentCacheMagic, sizeof(header.magic));
+		header.version = Version;
+		header.sourceHash = sourceHash;
+		header.radianceSize = radianceMap.GetWidth();
+		header.radianceLevels = radianceMap.GetMipLevelCount();
+		header.irradianceSize = irradianceMap.GetWidth();
+		header.irradianceLevels = irradianceMap.GetMipLevelCount();
+
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+		// The cubemaps were just written by compute shaders
+		glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+		std::vector<u8> pixels;
+		auto WriteLevels = [&](const TextureCube &cubemap, u32 size, u32 levels)
+		{
+			for (u32 level = 0; level < levels; level++)
+			{
+				pixels.resize(GetLevelSize(size, level));
+				glGetTextureImage(cubemap.GetRendererID(), (GLint) level, GL_RGBA, GL_HALF_FLOAT, (GLsizei) pixels.size(), pixels.data());
+				stream.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+			}
+		};
+
+		WriteLevels(radianceMap, header.radianceSize, header.radianceLevels);
+		WriteLevels(irradianceMap, header.irradianceSize, header.irradianceLevels);
+
+		bool success = stream.good();
+		stream.close();
+
+		if (success)
+		{
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			success = !error;
+		}
+		if (!success)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			ME_WARN("Failed to write Environment cache: %s", cachePath.c_str());
+		}
+
+		return success;
+	}
+
+	bool EnvironmentSerializer::Deserialize(TextureCube &radianceMap, TextureCube &irradianceMap, const std::string &cachePath, u64 sourceHash)
+	{
+		MappedFile file;
+		if (!file.Open(cachePath))
+			return false;
+
+		const u8 *data = file.GetData();
+		std::size_t size = file.GetSize();
+
+		EnvironmentCacheHeader header;
+		if (size < sizeof(header))
+			return false;
+		std::memcpy(&header, data, sizeof(header));
+
+		const u64 radianceBytes = GetCubemapSize(header.radianceSize, header.radianceLevels);
+		const u64 irradianceBytes = GetCubemapSize(header.irradianceSize, header.irradianceLevels);
+
+		if (std::memcmp(header.magic, s_EnvironmentCacheMagic, sizeof(header.magic)) != 0 ||
+			header.version != Version || header.sourceHash != sourceHash ||
+			sizeof(header) + radianceBytes + irradianceBytes > size)
+		{
+			ME_WARN("Ignoring outdated Environment cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		if (header.radianceSize != radianceMap.GetWidth() || header.radianceLevels != radianceMap.GetMipLevelCount() ||
+			header.irradianceSize != irradianceMap.GetWidth() || header.irradianceLevels != irradianceMap.GetMipLevelCount())
+		{
+			ME_WARN("Environment cache doesn't match the cubemaps: %s", cachePath.c_str());
+			return false;
+		}
+
+		const u8 *pixels = data + sizeof(header);
+		auto ReadLevels = [&](TextureCube &cubemap, u32 size, u32 levels)
+		{
+			for (u32 level = 0; level < levels; level++)
+			{
+				const GLsizei levelSize = (GLsizei) glm::max(size >> level, 1u);
+				glTextureSubImage3D(cubemap.GetRendererID(), (GLint) level, 0, 0, 0, levelSize, levelSize, 6, GL_RGBA, GL_HALF_FLOAT, pixels);
+				pixels += GetLevelSize(size, level);
+			}
+		};
+
+		ReadLevels(radianceMap, header.radianceSize, header.radianceLevels);
+		ReadLevels(irradianceMap, header.irradianceSize, header.irradianceLevels);
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Texture.h"
+
+#include <vector>
+
+
+namespace Engine
+{
+	// Pre-filtered IBL cubemaps: the radiance map and the irradiance map with all their mip levels,
+	// stored as RGBA16F. Cache files are keyed by a hash of the HDR image, the cubemap sizes and the
+	// preprocessed sources of the filtering shaders, which define the sample counts.
+	class EnvironmentSerializer
+	{
+	public:
+		static constexpr u32 Version = 1;
+
+		static u64 CalculateSourceHash(const std::string &filepath, u32 cubemapSize, u32 irradianceMapSize, const std::vector<std::string> &shaderPaths);
+		static std::string GetCachePath(u64 sourceHash);
+
+		static bool Serialize(const TextureCube &radianceMap, const TextureCube &irradianceMap, const std::string &cachePath, u64 sourceHash);
+		// Uploads into cubemaps of the sizes the cache was written with, fails for missing or outdated files
+		static bool Deserialize(TextureCube &radianceMap, TextureCube &irradianceMap, const std::string &cachePath, u64 sourceHash);
+	};
+}
\ No newline at end of file
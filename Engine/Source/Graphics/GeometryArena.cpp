@@ -0,0 +1,158 @@
+#include "Precompiled.h"
+#include "GeometryArena.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+
+namespace Engine
+{
+	GeometryArena::GeometryArena(const PipelineLayout &layout, u32 vertexCapacity, u32 indexCapacity)
+	{
+		m_Pipeline.layout = layout;
+		m_VertexStride = static_cast<u32>(m_Pipeline.layout.CalculateStride());
+
+		m_Pipeline.vertexBuffer = MakeShared<VertexBuffer>(nullptr, vertexCapacity * m_VertexStride, BufferUsage::Static);
+		m_Pipeline.indexBuffer = MakeShared<IndexBuffer>(nullptr, indexCapacity * static_cast<u32>(sizeof(u32)), IndexFormat::Uint32, BufferUsage::Static);
+		m_Pipeline.Create();
+
+		m_Statistics.vertexCapacity = vertexCapacity;
+		m_Statistics.indexCapacity = indexCapacity;
+
+		m_FreeVertices.push_back({ 0, vertexCapacity });
+		m_FreeIndices.push_back({ 0, indexCapacity });
+	}
+	GeometryArena::~GeometryArena()
+	{
+	}
+
+	GeometryAllocation GeometryArena::Allocate(const void *vertices, u32 vertexCount, const u32 *indices, u32 indexCount)
+	{
+		GeometryAllocation allocation;
+		if (vertexCount == 0 || indexCount == 0)
+			return allocation;
+
+		if (!AllocateRange(m_FreeVertices, vertexCount, allocation.vertexOffset))
+		{
+			GrowVertices(vertexCount);
+			AllocateRange(m_FreeVertices, vertexCount, allocation.vertexOffset);
+		}
+		if (!AllocateRange(m_FreeIndices, indexCount, allocation.indexOffset))
+		{
+			GrowIndices(indexCount);
+			AllocateRange(m_FreeIndices, indexCount, allocation.indexOffset);
+		}
+
+		allocation.vertexCount = vertexCount;
+		allocation.indexCount = indexCount;
+
+		m_Pipeline.vertexBuffer->SetData(vertices, vertexCount * m_VertexStride, allocation.vertexOffset * m_VertexStride);
+		m_Pipeline.indexBuffer->SetData(indices, indexCount * static_cast<u32>(sizeof(u32)), IndexFormat::Uint32,
+			allocation.indexOffset * static_cast<u32>(sizeof(u32)));
+
+		m_Statistics.vertexCount += vertexCount;
+		m_Statistics.indexCount += indexCount;
+		m_Statistics.allocations++;
+
+		return allocation;
+	}
+
+	void GeometryArena::Free(const GeometryAllocation &allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		ReleaseRange(m_FreeVertices, allocation.vertexOffset, allocation.vertexCount);
+		ReleaseRange(m_FreeIndices, allocation.indexOffset, allocation.indexCount);
+
+		m_Statistics.vertexCount -= allocation.vertexCount;
+		m_Statistics.indexCount -= allocation.indexCount;
+		m_Statistics.allocations--;
+	}
+
+	void GeometryArena::SetInstanceBuffer(const PipelineLayout &instanceLayout, const SharedPtr<VertexBuffer> &instanceBuffer)
+	{
+		m_Pipeline.instanceLayout = instanceLayout;
+		m_Pipeline.instanceBuffer = instanceBuffer;
+		m_Pipeline.Create();
+	}
+
+	bool GeometryArena::AllocateRange(std::vector<FreeRange> &freeRanges, u32 size, u32 &offset)
+	{
+		// First fit, ranges are kept sorted by offset
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); it++)
+		{
+			if (it->size < size)
+				continue;
+
+			offset = it->offset;
+			it->offset += size;
+			it->size -= size;
+
+			if (it->size == 0)
+				freeRanges.erase(it);
+			return true;
+		}
+		return false;
+	}
+
+	void GeometryArena::ReleaseRange(std::vector<FreeRange> &freeRanges, u32 offset, u32 size)
+	{
+		auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+			[](const GeometryArena::FreeRange &range, u32 value) { return range.offset < value; });
+
+		auto it = freeRanges.insert(next, { offset, size });
+
+		// Merge with the following range, then with the previous one
+		auto following = it + 1;
+		if (following != freeRanges.end() && it->offset + it->size == following->offset)
+		{
+			it->size += following->size;
+			freeRanges.erase(following);
+		}
+		if (it != freeRanges.begin())
+		{
+			auto previous = it - 1;
+			if (previous->offset + previous->size == it->offset)
+			{
+				previous->size += it->size;
+				freeRanges.erase(it);
+			}
+		}
+	}
+
+	void GeometryArena::GrowVertices(u32 requiredSize)
+	{
+		const u32 oldCapacity = m_Statistics.vertexCapacity;
+		const u32 newCapacity = std::max(oldCapacity * 2, oldCapacity + requiredSize);
+
+		auto vertexBuffer = MakeShared<VertexBuffer>(nullptr, newCapacity * m_VertexStride, BufferUsage::Static);
+		glCopyNamedBufferSubData(m_Pipeline.vertexBuffer->GetRendererID(), vertexBuffer->GetRendererID(), 0, 0, oldCapacity * m_VertexStride);
+
+		m_Pipeline.vertexBuffer = vertexBuffer;
+		m_Pipeline.Create();
+
+		ReleaseRange(m_FreeVertices, oldCapacity, newCapacity - oldCapacity);
+		m_Statistics.vertexCapacity = newCapacity;
+
+		ME_TRACE("Geometry arena grew to %u vertices", newCapacity);
+	}
+
+	void GeometryArena::GrowIndices(u32 requiredSize)
+	{
+		const u32 oldCapacity = m_Statistics.indexCapacity;
+		const u32 newCapacity = std::max(oldCapacity * 2, oldCapacity + requiredSize);
+
+		auto indexBuffer = MakeShared<IndexBuffer>(nullptr, newCapacity * static_cast<u32>(sizeof(u32)), IndexFormat::Uint32, BufferUsage::Static);
+		glCopyNamedBufferSubData(m_Pipeline.indexBuffer->GetRendererID(), indexBuffer->GetRendererID(), 0, 0, oldCapacity * sizeof(u32));
+
+		m_Pipeline.indexBuffer = indexBuffer;
+		m_Pipeline.Create();
+
+		ReleaseRange(m_FreeIndices, oldCapacity, newCapacity - oldCapacity);
+		m_Statistics.indexCapacity = newCapacity;
+
+		ME_TRACE("Geometry arena grew to %u indices", newCapacity);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "GraphicsPipeline.h"
+
+#include <vector>
+
+
+namespace Engine
+{
+	struct GeometryAllocation
+	{
+		u32 vertexOffset = 0, vertexCount = 0;	// in vertices
+		u32 indexOffset = 0, indexCount = 0;	// in indices
+
+		bool IsValid() const { return vertexCount > 0 && indexCount > 0; }
+	};
+
+	struct GeometryArenaStatistics
+	{
+		u32 vertexCount = 0, vertexCapacity = 0;
+		u32 indexCount = 0, indexCapacity = 0;
+		u32 allocations = 0;
+	};
+
+	// One vertex and index buffer shared by every mesh with the same vertex layout.
+	// Meshes only keep the ranges they were given, so all of them can be drawn through
+	// a single pipeline (and a single multi draw indirect call).
+	class GeometryArena
+	{
+	public:
+		GeometryArena(const PipelineLayout &layout, u32 vertexCapacity, u32 indexCapacity);
+		~GeometryArena();
+
+		// Indices stay relative to the allocation, draws add vertexOffset as base vertex
+		GeometryAllocation Allocate(const void *vertices, u32 vertexCount, const u32 *indices, u32 indexCount);
+		void Free(const GeometryAllocation &allocation);
+
+		// Recreates the pipeline so it sources per instance attributes from the buffer
+		void SetInstanceBuffer(const PipelineLayout &instanceLayout, const SharedPtr<VertexBuffer> &instanceBuffer);
+
+		const GraphicsPipeline &GetPipeline() const { return m_Pipeline; }
+		const GeometryArenaStatistics &GetStatistics() const { return m_Statistics; }
+
+	private:
+		struct FreeRange
+		{
+			u32 offset, size;
+		};
+
+		static bool AllocateRange(std::vector<FreeRange> &freeRanges, u32 size, u32 &offset);
+		static void ReleaseRange(std::vector<FreeRange> &freeRanges, u32 offset, u32 size);
+
+		void GrowVertices(u32 requiredSize);
+		void GrowIndices(u32 requiredSize);
+
+	private:
+		GraphicsPipeline m_Pipeline;
+		u32 m_VertexStride;
+
+		std::vector<FreeRange> m_FreeVertices;
+		std::vector<FreeRange> m_FreeIndices;
+
+		GeometryArenaStatistics m_Statistics;
+	};
+}
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+#include <cstring>
+
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -36,10 +39,10 @@ namespace Engine
 		glDeleteBuffers(1, &m_RendererID);
 	}
 
-	void VertexBuffer::SetData(const void *vertices, u32 size)
+	void VertexBuffer::SetData(const void *vertices, u32 size, u32 offset)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, m_RendererID);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
 	}
 
 	void VertexBuffer::Bind() const
@@ -69,13 +72,16 @@ namespace Engine
 		glDeleteBuffers(1, &m_RendererID);
 	}
 
-	void IndexBuffer::SetData(const void *indices, u32 size, IndexFormat format)
+	void IndexBuffer::SetData(const void *indices, u32 size, IndexFormat format, u32 offset)
 	{
 		m_Format = format;
-		m_Count = size / Tools::IndexFormatToSize(format);
+
+		// Partial updates keep the indices behind the written range
+		u32 count = (offset + size) / Tools::IndexFormatToSize(format);
+		m_Count = offset == 0 ? count : std::max(m_Count, count);
 
 		glBindBuffer(GL_ARRAY_BUFFER, m_RendererID);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, size, indices);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, indices);
 	}
 
 	void IndexBuffer::Bind() const
@@ -92,6 +98,168 @@ namespace Engine
 		return static_cast<int>(m_Count);
 	}
 
+	// ---------------------------------- Storage Buffer ----------------------------------
+	StorageBuffer::StorageBuffer(u32 size, u32 binding) :
+		m_Size(size), m_Binding(binding)
+	{
+		glCreateBuffers(1, &m_RendererID);
+		glNamedBufferData(m_RendererID, size, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	StorageBuffer::~StorageBuffer()
+	{
+		glDeleteBuffers(1, &m_RendererID);
+	}
+
+	void StorageBuffer::SetData(const void *data, u32 size, u32 offset)
+	{
+		ME_ASSERT(offset + size <= m_Size);
+
+		glNamedBufferSubData(m_RendererID, offset, size, data);
+	}
+
+	void StorageBuffer::Resize(u32 size)
+	{
+		RendererID newRendererID;
+		glCreateBuffers(1, &newRendererID);
+		glNamedBufferData(newRendererID, size, nullptr, GL_DYNAMIC_DRAW);
+		glCopyNamedBufferSubData(m_RendererID, newRendererID, 0, 0, std::min(size, m_Size));
+
+		glDeleteBuffers(1, &m_RendererID);
+		m_RendererID = newRendererID;
+		m_Size = size;
+	}
+
+	void StorageBuffer::Bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_Binding, m_RendererID);
+	}
+
+	// --------------------------------- Streaming Buffer ---------------------------------
+	StreamingBuffer::StreamingBuffer(u32 frameSize) :
+		m_RendererID(0), m_MappedData(nullptr), m_FrameSize(0), m_FrameIndex(0), m_FrameOffset(0)
+	{
+		for (auto &fence : m_Fences)
+			fence = nullptr;
+
+		Create(frameSize);
+	}
+
+	StreamingBuffer::~StreamingBuffer()
+	{
+		ReleaseFences();
+
+		for (auto rendererID : m_RetiredBuffers)
+			glDeleteBuffers(1, &rendererID);
+
+		glUnmapNamedBuffer(m_RendererID);
+		glDeleteBuffers(1, &m_RendererID);
+	}
+
+	void StreamingBuffer::Create(u32 frameSize)
+	{
+		// Keeps every region start aligned for uniform and storage bindings
+		m_FrameSize = (frameSize + 255) & ~255u;
+
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &m_RendererID);
+		glNamedBufferStorage(m_RendererID, GLsizeiptr(m_FrameSize) * FrameCount, nullptr, flags);
+		m_MappedData = static_cast<u8 *>(glMapNamedBufferRange(m_RendererID, 0, GLsizeiptr(m_FrameSize) * FrameCount, flags));
+		ME_ASSERT(m_MappedData);
+	}
+
+	void StreamingBuffer::ReleaseFences()
+	{
+		for (auto &fence : m_Fences)
+		{
+			if (fence)
+				glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+	}
+
+	void StreamingBuffer::BeginFrame()
+	{
+		m_FrameIndex = (m_FrameIndex + 1) % FrameCount;
+		m_FrameOffset = 0;
+
+		for (auto rendererID : m_RetiredBuffers)
+			glDeleteBuffers(1, &rendererID);
+		m_RetiredBuffers.clear();
+
+		GLsync fence = static_cast<GLsync>(m_Fences[m_FrameIndex]);
+		if (!fence)
+			return;
+
+		// Only stalls when the CPU runs more than FrameCount - 1 frames ahead
+		if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~GLuint64(0));
+			auto end = std::chrono::high_resolution_clock::now();
+
+			m_Statistics.stalls++;
+			m_Statistics.stallTime += std::chrono::duration<float, std::milli>(end - start).count();
+		}
+
+		glDeleteSync(fence);
+		m_Fences[m_FrameIndex] = nullptr;
+	}
+
+	void StreamingBuffer::EndFrame()
+	{
+		if (m_Fences[m_FrameIndex])
+			glDeleteSync(static_cast<GLsync>(m_Fences[m_FrameIndex]));
+
+		m_Fences[m_FrameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	StreamingBuffer::Allocation StreamingBuffer::Allocate(u32 size, u32 alignment)
+	{
+		ME_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+		u32 offset = (m_FrameOffset + alignment - 1) & ~(alignment - 1);
+		if (offset + size > m_FrameSize)
+		{
+			// Draws of this frame still read the old buffer, so it is only deleted next frame.
+			// None of the new regions were used yet, which makes the old fences meaningless.
+			ME_WARN("Streaming buffer exhausted (%u bytes per frame), growing", m_FrameSize);
+
+			m_RetiredBuffers.push_back(m_RendererID);
+			glUnmapNamedBuffer(m_RendererID);
+			ReleaseFences();
+
+			Create(std::max(m_FrameSize * 2, size + alignment));
+			m_Statistics.resizes++;
+
+			offset = 0;
+		}
+
+		m_FrameOffset = offset + size;
+
+		m_Statistics.allocations++;
+		m_Statistics.bytes += size;
+
+		const u32 bufferOffset = m_FrameIndex * m_FrameSize + offset;
+		return { m_MappedData + bufferOffset, bufferOffset, size };
+	}
+
+	StreamingBuffer::Allocation StreamingBuffer::Write(const void *data, u32 size, u32 alignment)
+	{
+		auto allocation = Allocate(size, alignment);
+		std::memcpy(allocation.data, data, size);
+		return allocation;
+	}
+
+	void StreamingBuffer::BindUniform(u32 binding, const Allocation &allocation) const
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_RendererID, allocation.offset, allocation.size);
+	}
+	void StreamingBuffer::BindStorage(u32 binding, const Allocation &allocation) const
+	{
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_RendererID, allocation.offset, allocation.size);
+	}
+
 	// --------------------------------- Graphics Pipeline ---------------------------------
 	GraphicsPipeline::GraphicsPipeline() : 
 		m_VertexArrayRendererID(0)
@@ -106,6 +274,10 @@ namespace Engine
 		ME_ASSERT(vertexBuffer);
 		//ME_ASSERT(indexBuffer);
 
+		// Recreating replaces the previous vertex array (e.g. after the buffers grew)
+		if (m_VertexArrayRendererID)
+			glDeleteVertexArrays(1, &m_VertexArrayRendererID);
+
 		glCreateVertexArrays(1, &m_VertexArrayRendererID);
 		glBindVertexArray(m_VertexArrayRendererID);
 
@@ -119,9 +291,11 @@ namespace Engine
 		for (std::size_t i = 0; i < layout.attributes.size(); i++)
 		{
 			const auto &attribute = layout.attributes[i];
-			glEnableVertexAttribArray(static_cast<GLuint>(i));
+			GLuint location = attribute.location >= 0 ? static_cast<GLuint>(attribute.location) : static_cast<GLuint>(i);
+
+			glEnableVertexAttribArray(location);
 			glVertexAttribPointer(
-				static_cast<GLuint>(i),
+				location,
 				Tools::VertexFormatToCount(attribute.format),
 				Tools::VertexFormatToType(attribute.format),
 				attribute.normalized ? GL_TRUE : GL_FALSE,
@@ -129,7 +303,7 @@ namespace Engine
 				reinterpret_cast<void *>((intptr_t) layout.CalculateOffset(attribute))
 			);
 			ME_TRACE("---------------------------------------------------------");
-			ME_TRACE(" Index: %d", (int) i);
+			ME_TRACE(" Index: %d", (int) location);
 			ME_TRACE(" Count: %d", Tools::VertexFormatToCount(attribute.format));
 			ME_TRACE(" Type: %s", Tools::VertexFormatToType(attribute.format) == GL_FLOAT ? "float" : "other");
 			ME_TRACE(" Normalized: %d", attribute.normalized ? 1 : 0);
@@ -137,6 +311,30 @@ namespace Engine
 			ME_TRACE(" Offset: %d", layout.CalculateOffset(attribute));
 		}
 		ME_TRACE("---------------------------------------------------------");
+
+		if (!instanceBuffer)
+			return;
+
+		instanceBuffer->Bind();
+
+		for (std::size_t i = 0; i < instanceLayout.attributes.size(); i++)
+		{
+			const auto &attribute = instanceLayout.attributes[i];
+			ME_ASSERT(attribute.location >= 0);	// Must not overlap the vertex attributes
+			GLuint location = static_cast<GLuint>(attribute.location);
+
+			const int stride = instanceLayout.CalculateStride();
+			const void *offset = reinterpret_cast<void *>((intptr_t) instanceLayout.CalculateOffset(attribute));
+
+			glEnableVertexAttribArray(location);
+			if (Tools::VertexFormatIsInteger(attribute.format))
+				glVertexAttribIPointer(location, Tools::VertexFormatToCount(attribute.format), Tools::VertexFormatToType(attribute.format), stride, offset);
+			else
+				glVertexAttribPointer(location, Tools::VertexFormatToCount(attribute.format), Tools::VertexFormatToType(attribute.format),
+					attribute.normalized ? GL_TRUE : GL_FALSE, stride, offset);
+
+			glVertexAttribDivisor(location, 1);
+		}
 	}
 
 	void GraphicsPipeline::Bind() const
@@ -19,10 +19,12 @@ namespace Engine
 
 		~VertexBuffer();
 
-		void SetData(const void *vertices, u32 size /* bytes */);
+		void SetData(const void *vertices, u32 size /* bytes */, u32 offset = 0 /* bytes */);
 
 		void Bind() const;
 
+		RendererID GetRendererID() const { return m_RendererID; }
+
 	private:
 		RendererID m_RendererID;
 	};
@@ -39,22 +41,116 @@ namespace Engine
 
 		~IndexBuffer();
 
-		void SetData(const void *indices, u32 size /* bytes */, IndexFormat format);
+		void SetData(const void *indices, u32 size /* bytes */, IndexFormat format, u32 offset = 0 /* bytes */);
 
 		void Bind() const;
 
 		int GetType();
 		int GetCount();
 
+		RendererID GetRendererID() const { return m_RendererID; }
+
 	private:
 		RendererID m_RendererID;
 		IndexFormat m_Format;
 		u32 m_Count;
 	};
 
+	class StorageBuffer
+	{
+	public:
+		StorageBuffer(u32 size /* bytes */, u32 binding);
+		~StorageBuffer();
+
+		void SetData(const void *data, u32 size /* bytes */, u32 offset = 0);
+
+		// Copies the contents into a new buffer of the given size
+		void Resize(u32 size /* bytes */);
+
+		void Bind() const;
+
+		u32 GetSize() const { return m_Size; }
+		u32 GetBinding() const { return m_Binding; }
+		RendererID GetRendererID() const { return m_RendererID; }
+
+	private:
+		RendererID m_RendererID;
+		u32 m_Size;
+		u32 m_Binding;
+	};
+
+	struct StreamingBufferStatistics
+	{
+		u32 allocations = 0;
+		u64 bytes = 0;
+		u32 stalls = 0;			// Frames that waited for the GPU to release their region
+		float stallTime = 0.0f;	// ms
+		u32 resizes = 0;
+	};
+
+	// Persistently mapped buffer for data rewritten every frame (instance data, uniform blocks, debug lines).
+	// The storage is split into one region per frame in flight and every region is fenced at the end
+	// of its frame, so the CPU writes one region while the GPU still reads the others.
+	class StreamingBuffer
+	{
+	public:
+		static constexpr u32 FrameCount = 3;
+
+		struct Allocation
+		{
+			void *data;
+			u32 offset;	// bytes, from the start of the buffer
+			u32 size;	// bytes
+		};
+
+		StreamingBuffer(u32 frameSize /* bytes */);
+		~StreamingBuffer();
+
+		// Waits until the GPU is done with the region of this frame
+		void BeginFrame();
+		// Fences everything written since BeginFrame
+		void EndFrame();
+
+		// Grows the buffer once a frame runs out of space, earlier allocations stay valid
+		Allocation Allocate(u32 size /* bytes */, u32 alignment = 16);
+		Allocation Write(const void *data, u32 size /* bytes */, u32 alignment = 16);
+
+		void BindUniform(u32 binding, const Allocation &allocation) const;
+		void BindStorage(u32 binding, const Allocation &allocation) const;
+
+		void ResetStatistics() { m_Statistics = StreamingBufferStatistics(); }
+		const StreamingBufferStatistics &GetStatistics() const { return m_Statistics; }
+
+		u32 GetFrameSize() const { return m_FrameSize; }
+		RendererID GetRendererID() const { return m_RendererID; }
+
+	private:
+		void Create(u32 frameSize);
+		void ReleaseFences();
+
+	private:
+		RendererID m_RendererID;
+		u8 *m_MappedData;
+		u32 m_FrameSize;
+
+		u32 m_FrameIndex;
+		u32 m_FrameOffset;			// Bytes used in the current region
+		void *m_Fences[FrameCount];	// GLsync of the last frame that wrote each region
+
+		// Replaced by a resize, deleted once the frame that still binds them is over
+		std::vector<RendererID> m_RetiredBuffers;
+
+		StreamingBufferStatistics m_Statistics;
+	};
+
 	enum class VertexFormat
 	{
-		Float1, Float2, Float3, Float4
+		Float1, Float2, Float3, Float4,
+		Half2, Half4,
+		Short2, Short4,
+		UShort2, UShort4,
+		Int1010102,		// xyz 10 bits, w 2 bits (GL_INT_2_10_10_10_REV)
+		UInt1			// Integer attribute, not converted to float
 	};
 	struct PipelineLayout
 	{
@@ -63,6 +159,7 @@ namespace Engine
 			std::string name;
 			VertexFormat format;
 			bool normalized;
+			int location = -1;	// -1 uses the attribute index
 		};
 
 		PipelineLayout() = default;
@@ -91,6 +188,10 @@ namespace Engine
 		SharedPtr<VertexBuffer> vertexBuffer;
 		SharedPtr<IndexBuffer> indexBuffer;
 
+		// Optional per instance attributes (divisor 1)
+		PipelineLayout instanceLayout;
+		SharedPtr<VertexBuffer> instanceBuffer;
+
 	private:
 		friend class Renderer;
 		RendererID m_VertexArrayRendererID;
@@ -1,6 +1,10 @@
 #include "Precompiled.h"
 #include "Material.h"
 
+#include "Renderer.h"
+
+#include <cstring>
+
 
 namespace Engine
 {
@@ -14,6 +18,61 @@ namespace Engine
 	}
 	Material::~Material()
 	{
+		ReleaseUniformSlot();
+	}
+
+	Material::Material(const Material &other) :
+		m_Name(other.m_Name),
+		m_Parameters(other.m_Parameters),
+		m_Textures(other.m_Textures),
+		m_Flags(other.m_Flags)
+	{
+	}
+	Material::Material(Material &&other) noexcept :
+		m_Name(std::move(other.m_Name)),
+		m_Parameters(other.m_Parameters),
+		m_Textures(std::move(other.m_Textures)),
+		m_Flags(other.m_Flags),
+		m_UniformSlot(other.m_UniformSlot),
+		m_UniformData(other.m_UniformData),
+		m_UniformDataValid(other.m_UniformDataValid)
+	{
+		other.m_UniformSlot = InvalidUniformSlot;
+		other.m_UniformDataValid = false;
+	}
+
+	Material &Material::operator=(const Material &other)
+	{
+		if (this != &other)
+		{
+			m_Name = other.m_Name;
+			m_Parameters = other.m_Parameters;
+			m_Textures = other.m_Textures;
+			m_Flags = other.m_Flags;
+
+			// Keep our slot, but make sure the new values get uploaded
+			m_UniformDataValid = false;
+		}
+		return *this;
+	}
+	Material &Material::operator=(Material &&other) noexcept
+	{
+		if (this != &other)
+		{
+			ReleaseUniformSlot();
+
+			m_Name = std::move(other.m_Name);
+			m_Parameters = other.m_Parameters;
+			m_Textures = std::move(other.m_Textures);
+			m_Flags = other.m_Flags;
+			m_UniformSlot = other.m_UniformSlot;
+			m_UniformData = other.m_UniformData;
+			m_UniformDataValid = other.m_UniformDataValid;
+
+			other.m_UniformSlot = InvalidUniformSlot;
+			other.m_UniformDataValid = false;
+		}
+		return *this;
 	}
 
 	void Material::SetName(const std::string &name)
@@ -42,4 +101,71 @@ namespace Engine
 	{
 		return m_Textures;
 	}
+
+	void Material::SetFlag(MaterialFlag flag, bool enabled)
+	{
+		if (enabled)
+			m_Flags |= static_cast<u32>(flag);
+		else
+			m_Flags &= ~static_cast<u32>(flag);
+	}
+	bool Material::HasFlag(MaterialFlag flag) const
+	{
+		return (m_Flags & static_cast<u32>(flag)) != 0;
+	}
+
+	u32 Material::GetFlags() const
+	{
+		return m_Flags;
+	}
+	void Material::SetFlags(u32 flags)
+	{
+		m_Flags = flags;
+	}
+
+	u32 Material::GetShaderFeatures() const
+	{
+		auto Ready = [](bool used, const SharedPtr<Texture> &texture) { return used && texture && texture->IsLoaded(); };
+
+		u32 features = static_cast<u32>(MaterialFeature::None);
+		if (Ready(m_Textures.useAlbedo, m_Textures.albedo))
+			features |= static_cast<u32>(MaterialFeature::AlbedoTexture);
+		if (Ready(m_Textures.useNormal, m_Textures.normal))
+			features |= static_cast<u32>(MaterialFeature::NormalMapTexture);
+		if (Ready(m_Textures.useMetalness, m_Textures.metalness))
+			features |= static_cast<u32>(MaterialFeature::MetalnessTexture);
+		if (Ready(m_Textures.useRoughness, m_Textures.roughness))
+			features |= static_cast<u32>(MaterialFeature::RoughnessTexture);
+
+		return features;
+	}
+
+	bool Material::UpdateUniformData()
+	{
+		MaterialUniformData data = {};
+		data.albedo = m_Parameters.albedo;
+		data.metalness = m_Parameters.metalness;
+		data.roughness = m_Parameters.roughness;
+		data.opacity = m_Parameters.opacity;
+
+		if (m_UniformDataValid && std::memcmp(&data, &m_UniformData, sizeof(data)) == 0)
+			return false;
+
+		m_UniformData = data;
+		m_UniformDataValid = true;
+		return true;
+	}
+	const MaterialUniformData &Material::GetUniformData() const
+	{
+		return m_UniformData;
+	}
+
+	void Material::ReleaseUniformSlot()
+	{
+		if (m_UniformSlot != InvalidUniformSlot)
+			Renderer::ReleaseMaterialUniformSlot(m_UniformSlot);
+
+		m_UniformSlot = InvalidUniformSlot;
+		m_UniformDataValid = false;
+	}
 }
\ No newline at end of file
@@ -26,16 +26,58 @@ namespace Engine
 		glm::vec3 albedo = { 0.8f, 0.2f, 0.15f };
 		float metalness = 0.5f;
 		float roughness = 0.5f;
+		float opacity = 1.0f;
 	};
 
+	enum class MaterialFlag : u32
+	{
+		None		= 0,
+		Transparent	= 1 << 0,	// Blended and drawn back to front after all opaque geometry
+	};
+
+	// Compile time switches of PBR.glsl, every combination in use is its own shader variant
+	enum class MaterialFeature : u32
+	{
+		None				= 0,
+		AlbedoTexture		= 1 << 0,
+		NormalMapTexture	= 1 << 1,
+		MetalnessTexture	= 1 << 2,
+		RoughnessTexture	= 1 << 3,
+	};
+
+	// Element of the Materials storage buffer in PBR.glsl (std430)
+	struct MaterialUniformData
+	{
+		glm::vec3 albedo;
+		float metalness;
+		float roughness;
+		float opacity;
+		float padding[2];
+	};
+
+	class Shader;
+
 	class Material
 	{
+	public:
+		static constexpr u32 InvalidUniformSlot = ~0u;
+
 	public:
 		Material();
 		Material(const std::string &name);
 		~Material();
 
-		// TODO: Material Flags
+		// Copies get their own uniform buffer slot on first use
+		Material(const Material &other);
+		Material(Material &&other) noexcept;
+		Material &operator=(const Material &other);
+		Material &operator=(Material &&other) noexcept;
+
+		void SetFlag(MaterialFlag flag, bool enabled = true);
+		bool HasFlag(MaterialFlag flag) const;
+
+		u32 GetFlags() const;
+		void SetFlags(u32 flags);
 
 		void SetName(const std::string &name);
 		const std::string &GetName() const;
@@ -46,9 +88,34 @@ namespace Engine
 		PBRMaterialTextures &GetTextures();
 		const PBRMaterialTextures &GetTextures() const;
 
+		// MaterialFeature bits of the textures that are enabled and loaded,
+		// textures that are still streaming in fall back to the constant parameters
+		u32 GetShaderFeatures() const;
+
+		// Refreshes the uniform data from the current parameters,
+		// returns true if it differs from what was uploaded last
+		bool UpdateUniformData();
+		const MaterialUniformData &GetUniformData() const;
+
+	private:
+		void ReleaseUniformSlot();
+
 	private:
 		std::string m_Name;
 		PBRMaterialParameters m_Parameters;
 		PBRMaterialTextures m_Textures;
+		u32 m_Flags = static_cast<u32>(MaterialFlag::None);
+
+		// Persistent slice of the renderer's material uniform buffer
+		u32 m_UniformSlot = InvalidUniformSlot;
+		MaterialUniformData m_UniformData = {};
+		bool m_UniformDataValid = false;
+
+		// Specialized program, resolved again when the shader or the variant key changes
+		Shader *m_ShaderVariant = nullptr;
+		const Shader *m_VariantBaseShader = nullptr;
+		u32 m_VariantKey = 0;
+
+		friend class Renderer;
 	};
 }
\ No newline at end of file
@@ -5,28 +5,34 @@
 #include <assimp/DefaultLogger.hpp>
 
 #include "Renderer.h"
+#include "MeshSerializer.h"
+#include "TextureLibrary.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include "Core/AsyncLoader.h"
+#include "Core/JobSystem.h"
+
+#include <chrono>
+#include <mutex>
 
 
 namespace Engine
 {
-	static const uint32_t s_MeshImportFlags =
-		aiProcess_CalcTangentSpace |
-		aiProcess_Triangulate |
-		aiProcess_SortByPType |
-		aiProcess_GenNormals |
-		aiProcess_GenUVCoords |
-		aiProcess_OptimizeMeshes |
-		aiProcess_ValidateDataStructure;
-
 	struct LogStream : public Assimp::LogStream
 	{
 		static void Initialize()
 		{
-			if (Assimp::DefaultLogger::isNullLogger())
-			{
-				Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
-				Assimp::DefaultLogger::get()->attachStream(new LogStream, Assimp::Logger::Info | Assimp::Logger::Warn | Assimp::Logger::Err);
-			}
+			// Meshes can be imported by several workers at once
+			static std::once_flag once;
+			std::call_once(once, []()
+				{
+					if (Assimp::DefaultLogger::isNullLogger())
+					{
+						Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
+						Assimp::DefaultLogger::get()->attachStream(new LogStream, Assimp::Logger::Info | Assimp::Logger::Warn | Assimp::Logger::Err);
+					}
+				});
 		}
 
 		virtual void write(const char *message) override
@@ -88,28 +94,113 @@ namespace Engine
 		m_Scene(nullptr)
 	{
 	}
-	Mesh::Mesh(ConstRef<std::string> filepath) :
+	Mesh::Mesh(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings) :
 		m_Filepath(filepath),
 		m_IsLoaded(false),
 		m_Scene(nullptr)
 	{
-		Load(filepath);
+		Load(filepath, settings);
 	}
 	Mesh::~Mesh()
 	{
+		ReleaseGeometry();
 	}
-	void Mesh::Load(ConstRef<std::string> filepath)
+	SharedPtr<Mesh> Mesh::LoadAsync(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings)
 	{
-		ME_INFO("Loading Mesh: %s", filepath.c_str());
+		auto mesh = MakeShared<Mesh>();
+		mesh->m_Filepath = filepath;
+		mesh->m_ImportSettings = settings;
+		mesh->m_IsLoading = true;
 
-		LogStream::Initialize();
+		Stream(mesh, filepath, settings);
+		return mesh;
+	}
+
+	void Mesh::Reload(const SharedPtr<Mesh> &mesh)
+	{
+		ME_INFO("Reloading Mesh: %s", mesh->m_Filepath.c_str());
+		Stream(mesh, mesh->m_Filepath, mesh->m_ImportSettings);
+	}
+
+	void Mesh::Stream(const SharedPtr<Mesh> &mesh, ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings)
+	{
+		const u32 generation = ++mesh->m_LoadGeneration;
+		std::weak_ptr<Mesh> target = mesh;
+
+		AsyncLoader::Load([filepath, settings, target, generation]() -> Job
+			{
+				// Decoded into a mesh nobody else can see, so the target stays untouched until finalize
+				auto staging = MakeShared<Mesh>();
+				staging->m_DecodingAsync = true;
+				bool decoded = staging->Decode(filepath, settings);
+
+				return [staging, decoded, target, generation]()
+				{
+					auto mesh = target.lock();
+					if (!mesh || mesh->m_LoadGeneration != generation)
+						return;
+
+					mesh->m_IsLoading = false;
+					if (!decoded)
+						return;
+
+					mesh->TakeDecoded(*staging);
+					mesh->Finalize();
+				};
+			});
+	}
+
+	void Mesh::Load(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings)
+	{
+		// Supersedes any asynchronous load still in flight
+		m_LoadGeneration++;
+		m_IsLoading = false;
+
+		if (Decode(filepath, settings))
+			Finalize();
+	}
+
+	bool Mesh::Decode(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings)
+	{
+		ME_INFO("Loading Mesh: %s", filepath.c_str());
 
 		m_Filepath = filepath;
+		m_ImportSettings = settings;
+		m_IsLoaded = false;
+
+		ReleaseGeometry();
+
 		m_SubMeshes.clear();
+		m_Materials.clear();
+		m_Vertices.clear();
+		m_Indices.clear();
+		m_Positions.clear();
+		m_RaycastTriangles.clear();
+		m_BVH.Clear();
+		m_TextureRequests.clear();
+		m_ImportStatistics = MeshImportStatistics();
+
+		// Try the binary mesh cache first, this skips the whole assimp import
+		u64 sourceHash = MeshSerializer::CalculateSourceHash(m_Filepath, m_ImportSettings);
+		std::string cachePath = MeshSerializer::GetCachePath(sourceHash);
+
+		if (sourceHash && MeshSerializer::Deserialize(*this, cachePath, sourceHash))
+		{
+			ME_INFO("Loaded Mesh from cache: %s", cachePath.c_str());
+
+			LoadTextures();
+			BuildAccelerationStructure();
+			CalculateBounds();
+			return true;
+		}
+
+		LogStream::Initialize();
 
 		UniquePtr<Assimp::Importer> m_Importer;
 		m_Importer = MakeUnique<Assimp::Importer>();
-		m_Scene = m_Importer->ReadFile(filepath, s_MeshImportFlags);
+		m_Scene = m_Importer->ReadFile(filepath, m_ImportSettings.importFlags);
+
+		bool decoded = false;
 
 		if (!m_Scene || !m_Scene->HasMeshes())
 		{
@@ -122,17 +213,171 @@ namespace Engine
 		else {
 			// Process mesh recursively
 			ProcessNode(m_Scene->mRootNode, glm::mat4(1.0f));
+			LoadTextures();
+			BuildPositions(m_Vertices.data());
+			BuildAccelerationStructure();
+			CalculateBounds();
 
 			ME_TRACE("Total sub meshes: %d", m_SubMeshes.size());
 			ME_TRACE("Total mesh vertices: %d", m_Vertices.size());
 			ME_TRACE("Total mesh indices: %d", m_Indices.size());
 
+			if (sourceHash && MeshSerializer::Serialize(*this, cachePath, sourceHash))
+				ME_INFO("Wrote Mesh cache: %s", cachePath.c_str());
+
+			decoded = true;
+		}
+
+		m_Scene = nullptr;
+		return decoded;
+	}
+
+	void Mesh::Finalize()
+	{
+		// Synchronous cache loads upload straight from the mapped file
+		if (!m_GeometryArena)
+		{
 			ME_INFO("Preparing Pipeline");
-			PreparePipeline();
+			PreparePipeline(m_Vertices.data(), static_cast<u32>(m_Vertices.size()), m_Indices.data(), static_cast<u32>(m_Indices.size()));
 			ME_INFO("Pipeline was succesfully prepared");
+		}
+
+		// The GPU copy is authoritative from here on
+		if (!m_ImportSettings.retainVertexData)
+			std::vector<Vertex>().swap(m_Vertices);
+
+		m_IsLoaded = true;
+	}
+
+	void Mesh::TakeDecoded(Mesh &source)
+	{
+		ReleaseGeometry();
+
+		m_Filepath = std::move(source.m_Filepath);
+		m_ImportSettings = source.m_ImportSettings;
+		m_SubMeshes = std::move(source.m_SubMeshes);
+		m_Materials = std::move(source.m_Materials);
+		m_BoundingBox = source.m_BoundingBox;
+		m_BoundingSphere = source.m_BoundingSphere;
+
+		m_Vertices = std::move(source.m_Vertices);
+		m_Indices = std::move(source.m_Indices);
+		m_Positions = std::move(source.m_Positions);
+		m_RaycastTriangles = std::move(source.m_RaycastTriangles);
+		m_BVH = std::move(source.m_BVH);
+		m_ImportStatistics = source.m_ImportStatistics;
+	}
+
+	void Mesh::RequestTexture(u32 materialIndex, u32 slot, const std::string &filepath, bool enabled)
+	{
+		TextureSettings settings = TextureLibrary::GetSlotSettings(static_cast<TextureSlot>(slot));
+		m_TextureRequests.push_back({ materialIndex, slot, filepath, settings, enabled });
+	}
+
+	void Mesh::LoadTextures()
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		m_ImportStatistics.textureRequests = static_cast<u32>(m_TextureRequests.size());
+
+		// Materials sharing a file share the texture, files already resident aren't decoded again
+		struct UniqueTexture
+		{
+			std::string filepath;
+			TextureSettings settings;
+			SharedPtr<Texture> texture;
+			bool decode;
+			TextureImage image;
+			float decodeTime;
+		};
+		std::vector<UniqueTexture> uniqueTextures;
+		std::unordered_map<std::string, u32> lookup;
+
+		for (const auto &request : m_TextureRequests)
+		{
+			std::string key = request.filepath + "|" + std::to_string(request.slot);
+			auto [it, inserted] = lookup.try_emplace(key, static_cast<u32>(uniqueTextures.size()));
+			if (inserted)
+			{
+				bool created;
+				auto texture = TextureLibrary::Acquire(request.filepath, request.settings, created);
+				uniqueTextures.push_back({ request.filepath, request.settings, texture, created, {}, 0.0f });
+				m_ImportStatistics.decodedTextures += created ? 1 : 0;
+			}
+
+			auto &textures = m_Materials[request.materialIndex].GetTextures();
+			SharedPtr<Texture> *slots[] = { &textures.albedo, &textures.normal, &textures.metalness, &textures.roughness };
+			bool *used[] = { &textures.useAlbedo, &textures.useNormal, &textures.useMetalness, &textures.useRoughness };
 
-			m_IsLoaded = true;
+			*slots[request.slot] = uniqueTextures[it->second].texture;
+			*used[request.slot] = request.enabled;
 		}
+
+		m_ImportStatistics.uniqueTextures = static_cast<u32>(uniqueTextures.size());
+
+		auto wallStart = Clock::now();
+		JobSystem::ParallelFor(static_cast<u32>(uniqueTextures.size()), 1, [&uniqueTextures](u32 begin, u32 end)
+			{
+				for (u32 i = begin; i < end; i++)
+				{
+					if (!uniqueTextures[i].decode)
+						continue;
+
+					auto start = Clock::now();
+					uniqueTextures[i].image = Texture::Decode(uniqueTextures[i].filepath, uniqueTextures[i].settings);
+					uniqueTextures[i].decodeTime = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+				}
+			});
+		m_ImportStatistics.textureWallTime = std::chrono::duration<float, std::milli>(Clock::now() - wallStart).count();
+
+		m_ImportStatistics.textureDecodeTime = 0.0f;
+		for (auto &unique : uniqueTextures)
+		{
+			if (!unique.decode)
+				continue;
+
+			m_ImportStatistics.textureDecodeTime += unique.decodeTime;
+
+			// GL objects can only be created on the main thread
+			if (m_DecodingAsync)
+			{
+				auto image = MakeShared<TextureImage>(std::move(unique.image));
+				std::weak_ptr<Texture> target = unique.texture;
+				AsyncLoader::QueueFinalize([image, target]()
+					{
+						if (auto texture = target.lock())
+							texture->Upload(*image);
+					});
+			}
+			else
+			{
+				unique.texture->Upload(unique.image);
+			}
+		}
+
+		// Failed files stay disabled, streaming ones are enabled once they arrive. A shared
+		// texture can still be streaming for another mesh's async load even on this path.
+		if (!m_DecodingAsync)
+		{
+			auto Failed = [](const SharedPtr<Texture> &texture) { return !texture || (!texture->IsLoaded() && !texture->IsLoading()); };
+			for (auto &material : m_Materials)
+			{
+				auto &textures = material.GetTextures();
+				textures.useAlbedo = textures.useAlbedo && !Failed(textures.albedo);
+				textures.useNormal = textures.useNormal && !Failed(textures.normal);
+				textures.useMetalness = textures.useMetalness && !Failed(textures.metalness);
+				textures.useRoughness = textures.useRoughness && !Failed(textures.roughness);
+			}
+		}
+
+		if (m_ImportStatistics.decodedTextures)
+		{
+			const auto &stats = m_ImportStatistics;
+			ME_INFO("Decoded %u textures (%u references, %u shared) in %.2f ms, %.2f ms summed decode time (%.1fx)", stats.decodedTextures,
+				stats.textureRequests, stats.uniqueTextures - stats.decodedTextures, stats.textureWallTime, stats.textureDecodeTime, stats.textureDecodeTime / glm::max(stats.textureWallTime, 0.001f));
+		}
+
+		m_TextureRequests.clear();
 	}
 
 	bool Mesh::IsLoaded() const
@@ -190,12 +435,13 @@ namespace Engine
 				currentVertex.bitangent = AssimpVec3ToVec3(mesh->mBitangents[i]);
 			}
 
-			// Texture Coords
+			// Texture Coords, flipped because images are uploaded top row first.
+			// Tangents were already generated from the original coordinates.
 			if (mesh->HasTextureCoords(0))
 			{
 				glm::vec2 textureCoords = {
 					mesh->mTextureCoords[0][i].x,
-					mesh->mTextureCoords[0][i].y
+					1.0f - mesh->mTextureCoords[0][i].y
 				};
 
 				currentVertex.texCoords = textureCoords;
@@ -205,25 +451,12 @@ namespace Engine
 		}
 
 		// Indices
-		typedef struct { u32 v1, v2, v3; } TriangleInfo;
-		
 		for (uint32_t i = 0; i < mesh->mNumFaces; i++)
 		{
 			aiFace face = mesh->mFaces[i];
 
 			ME_ASSERT(face.mNumIndices == 3);
 
-			TriangleInfo currentTriangle;
-			currentTriangle = { mesh->mFaces[i].mIndices[0], mesh->mFaces[i].mIndices[1], mesh->mFaces[i].mIndices[2] };
-
-			// Triangles
-			Triangle triangle = {
-				m_Vertices[currentTriangle.v1 + subMesh.vertexOffset],
-				m_Vertices[currentTriangle.v2 + subMesh.vertexOffset],
-				m_Vertices[currentTriangle.v3 + subMesh.vertexOffset]
-			};
-			m_TriangleRepresentation.emplace_back(triangle);
-
 			for (uint32_t j = 0; j < face.mNumIndices; j++)
 				m_Indices.push_back(face.mIndices[j]);
 		}
@@ -232,6 +465,29 @@ namespace Engine
 		subMesh.vertexCount = m_Vertices.size() - subMesh.vertexOffset;
 		subMesh.indexCount = m_Indices.size() - subMesh.indexOffset;
 
+		// Bounds
+		if (subMesh.vertexCount > 0)
+		{
+			const Vertex *vertices = &m_Vertices[subMesh.vertexOffset];
+
+			subMesh.boundingBox.min = subMesh.boundingBox.max = vertices[0].position;
+			for (u32 i = 1; i < subMesh.vertexCount; i++)
+			{
+				subMesh.boundingBox.min = glm::min(subMesh.boundingBox.min, vertices[i].position);
+				subMesh.boundingBox.max = glm::max(subMesh.boundingBox.max, vertices[i].position);
+			}
+
+			// Centered on the box, tighter than its half diagonal for most shapes
+			subMesh.boundingSphere.center = subMesh.boundingBox.GetCenter();
+			float radiusSquared = 0.0f;
+			for (u32 i = 0; i < subMesh.vertexCount; i++)
+			{
+				glm::vec3 offset = vertices[i].position - subMesh.boundingSphere.center;
+				radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+			}
+			subMesh.boundingSphere.radius = glm::sqrt(radiusSquared);
+		}
+
 		// Materials
 		{
 			aiMaterial* aiMaterial = m_Scene->mMaterials[mesh->mMaterialIndex];
@@ -263,13 +519,19 @@ namespace Engine
 				if (aiMaterial->Get(AI_MATKEY_REFLECTIVITY, metalness) != aiReturn_SUCCESS)
 					metalness = 0.0f;
 
+				float opacity;
+				if (aiMaterial->Get(AI_MATKEY_OPACITY, opacity) != aiReturn_SUCCESS)
+					opacity = 1.0f;
+
 				roughness = 1.0f - glm::sqrt(shininess / 100.0f);
 
 				subMaterial.GetParameters() = {
 					glm::vec3(aiColor.r, aiColor.g, aiColor.b),	// Albedo
 					metalness,									// Metalness	
-					roughness									// Roughness
+					roughness,									// Roughness
+					opacity										// Opacity
 				};
+				subMaterial.SetFlag(MaterialFlag::Transparent, opacity < 1.0f);
 
 				ME_TRACE("Mesh Debug Info: %s: AlbedoColor: %.2f, %.2f, %.2f", aiMaterial->GetName().C_Str(), aiColor.r, aiColor.g, aiColor.b);
 				ME_TRACE("Mesh Debug Info: %s: Metalness: %.2f", aiMaterial->GetName().C_Str(), metalness);
@@ -277,10 +539,10 @@ namespace Engine
 
 				// TODO: Normal, metalness and roughness maps
 				PBRMaterialTextures textures = {
-					MakeShared<Texture>(), false,
-					MakeShared<Texture>(), false,
-					MakeShared<Texture>(), false,
-					MakeShared<Texture>(), false
+					TextureLibrary::GetDefault(TextureSlot::Albedo), false,
+					TextureLibrary::GetDefault(TextureSlot::Normal), false,
+					TextureLibrary::GetDefault(TextureSlot::Metalness), false,
+					TextureLibrary::GetDefault(TextureSlot::Roughness), false
 				};
 
 				aiString aiTexturePath;
@@ -291,10 +553,7 @@ namespace Engine
 					parentPath /= std::string(aiTexturePath.data);
 					std::string texturePath = parentPath.string();
 					ME_INFO("Albedo Texture filepath = %s", texturePath.c_str());
-					auto texture = MakeShared<Texture>(texturePath, true);
-					textures.albedo = texture;
-					if (texture->IsLoaded())
-						textures.useAlbedo = true;
+					RequestTexture(materialIndex, 0, texturePath, true);
 				}
 
 				subMaterial.GetTextures() = textures;
@@ -309,21 +568,198 @@ namespace Engine
 		return subMesh;
 	}
 
-	void Mesh::PreparePipeline()
+	void Mesh::BuildPositions(const Vertex *vertices)
 	{
-		m_Pipeline.layout = {
-			{ "a_Position",  VertexFormat::Float3, false },
-			{ "a_Normal",	 VertexFormat::Float3, false },
-			{ "a_Tangent",	 VertexFormat::Float3, false },
-			{ "a_Bitangent", VertexFormat::Float3, false },
-			{ "a_TexCoords", VertexFormat::Float2, false }
-		};
+		u32 vertexCount = 0;
+		for (const auto &subMesh : m_SubMeshes)
+			vertexCount = glm::max(vertexCount, subMesh.vertexOffset + subMesh.vertexCount);
+
+		m_Positions.resize(vertexCount);
+
+		for (const auto &subMesh : m_SubMeshes)
+		{
+			for (u32 i = subMesh.vertexOffset; i < subMesh.vertexOffset + subMesh.vertexCount; i++)
+				m_Positions[i] = subMesh.transform * glm::vec4(vertices[i].position, 1.0f);
+		}
+	}
+
+	void Mesh::BuildAccelerationStructure()
+	{
+		m_RaycastTriangles.clear();
+		m_RaycastTriangles.reserve(m_Indices.size() / 3);
+
+		std::vector<AABB> triangleBounds;
+		triangleBounds.reserve(m_Indices.size() / 3);
+
+		for (u32 subMeshIndex = 0; subMeshIndex < m_SubMeshes.size(); subMeshIndex++)
+		{
+			const auto &subMesh = m_SubMeshes[subMeshIndex];
+
+			for (u32 i = 0; i < subMesh.indexCount; i += 3)
+			{
+				const Index *triangleIndices = &m_Indices[subMesh.indexOffset + i];
+
+				const glm::vec3 &vertex0 = m_Positions[triangleIndices[0] + subMesh.vertexOffset];
+				const glm::vec3 &vertex1 = m_Positions[triangleIndices[1] + subMesh.vertexOffset];
+				const glm::vec3 &vertex2 = m_Positions[triangleIndices[2] + subMesh.vertexOffset];
+
+				AABB bounds;
+				bounds.min = glm::min(glm::min(vertex0, vertex1), vertex2);
+				bounds.max = glm::max(glm::max(vertex0, vertex1), vertex2);
+
+				m_RaycastTriangles.push_back({ subMesh.indexOffset + i, subMeshIndex });
+				triangleBounds.push_back(bounds);
+			}
+		}
+
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		m_BVH.Build(triangleBounds);
+		auto buildEnd = std::chrono::high_resolution_clock::now();
+
+		// Store triangles in leaf order so a leaf reads one contiguous range
+		const auto &order = m_BVH.GetPrimitiveIndices();
+		std::vector<RaycastTriangle> sorted(order.size());
+		for (u32 i = 0; i < order.size(); i++)
+			sorted[i] = m_RaycastTriangles[order[i]];
+		m_RaycastTriangles = std::move(sorted);
+
+		ME_TRACE("Built BVH with %u nodes for %u triangles in %.2fms", static_cast<u32>(m_BVH.GetNodes().size()), static_cast<u32>(m_RaycastTriangles.size()),
+			std::chrono::duration<float, std::milli>(buildEnd - buildStart).count());
+	}
+
+	bool Mesh::Raycast(const Ray &ray, float &distance, u32 &subMeshIndex, u32 &triangleIndex) const
+	{
+		// Leaves are gathered from the position stream into a small batch for the SIMD kernel
+		thread_local TriangleBatch batch;
+
+		return m_BVH.TraverseLeaves(ray, distance, [&](u32 firstSlot, u32 count, float &closestDistance)
+			{
+				batch.Clear();
+				for (u32 slot = firstSlot; slot < firstSlot + count; slot++)
+				{
+					const RaycastTriangle &triangle = m_RaycastTriangles[slot];
+					const u32 vertexOffset = m_SubMeshes[triangle.subMeshIndex].vertexOffset;
+					const Index *triangleIndices = &m_Indices[triangle.firstIndex];
+
+					batch.Add(m_Positions[triangleIndices[0] + vertexOffset],
+						m_Positions[triangleIndices[1] + vertexOffset],
+						m_Positions[triangleIndices[2] + vertexOffset]);
+				}
+
+				TriangleHit hit;
+				hit.t = closestDistance;
+				if (!Math::IntersectTriangles(ray, batch, hit))
+					return false;
+
+				const RaycastTriangle &triangle = m_RaycastTriangles[firstSlot + hit.index];
+				closestDistance = hit.t;
+				subMeshIndex = triangle.subMeshIndex;
+				triangleIndex = (triangle.firstIndex - m_SubMeshes[triangle.subMeshIndex].indexOffset) / 3;
+				return true;
+			});
+	}
+
+	static CompactVertex PackVertex(ConstRef<Vertex> vertex, ConstRef<glm::vec3> scale, ConstRef<glm::vec3> offset)
+	{
+		CompactVertex packed;
+
+		glm::vec3 position = glm::clamp((vertex.position - offset) / scale, glm::vec3(-1.0f), glm::vec3(1.0f));
+		packed.position[0] = static_cast<int16_t>(glm::round(position.x * 32767.0f));
+		packed.position[1] = static_cast<int16_t>(glm::round(position.y * 32767.0f));
+		packed.position[2] = static_cast<int16_t>(glm::round(position.z * 32767.0f));
+		packed.position[3] = 0;
+
+		// Octahedral normal encoding
+		glm::vec3 normal = vertex.normal / glm::max(glm::abs(vertex.normal.x) + glm::abs(vertex.normal.y) + glm::abs(vertex.normal.z), 1e-8f);
+		glm::vec2 octahedral = glm::vec2(normal);
+		if (normal.z < 0.0f)
+		{
+			glm::vec2 signs = { octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f };
+			octahedral = (1.0f - glm::abs(glm::vec2(octahedral.y, octahedral.x))) * signs;
+		}
+		packed.normal[0] = static_cast<int16_t>(glm::round(glm::clamp(octahedral.x, -1.0f, 1.0f) * 32767.0f));
+		packed.normal[1] = static_cast<int16_t>(glm::round(glm::clamp(octahedral.y, -1.0f, 1.0f) * 32767.0f));
+
+		// Bitangent is rebuilt in the shader from normal, tangent and handedness
+		float handedness = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+		glm::vec3 tangent = glm::length(vertex.tangent) > 0.0f ? glm::normalize(vertex.tangent) : glm::vec3(0.0f);
+		packed.tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+
+		packed.texCoords = glm::packHalf2x16(vertex.texCoords);
+
+		return packed;
+	}
+
+	void Mesh::PreparePipeline(const Vertex *vertices, u32 vertexCount, const Index *indices, u32 indexCount)
+	{
+		m_GeometryArena = Renderer::GetGeometryArena(m_ImportSettings.compactVertices);
+
+		if (m_ImportSettings.compactVertices)
+		{
+			std::vector<CompactVertex> compactVertices(vertexCount);
+
+			for (auto &subMesh : m_SubMeshes)
+			{
+				if (subMesh.vertexCount == 0)
+					continue;
+
+				glm::vec3 min = vertices[subMesh.vertexOffset].position;
+				glm::vec3 max = min;
+				for (u32 i = subMesh.vertexOffset; i < subMesh.vertexOffset + subMesh.vertexCount; i++)
+				{
+					min = glm::min(min, vertices[i].position);
+					max = glm::max(max, vertices[i].position);
+				}
 
-		m_Pipeline.vertexBuffer = MakeShared<VertexBuffer>(m_Vertices.data(), m_Vertices.size() * sizeof(Vertex), BufferUsage::Static);
-		m_Pipeline.indexBuffer = MakeShared<IndexBuffer>(m_Indices.data(), m_Indices.size() * sizeof(u32), IndexFormat::Uint32, BufferUsage::Static);
+				subMesh.dequantizationOffset = (min + max) * 0.5f;
+				subMesh.dequantizationScale = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
 
-		m_Pipeline.Create();
+				for (u32 i = subMesh.vertexOffset; i < subMesh.vertexOffset + subMesh.vertexCount; i++)
+					compactVertices[i] = PackVertex(vertices[i], subMesh.dequantizationScale, subMesh.dequantizationOffset);
+			}
+
+			m_Geometry = m_GeometryArena->Allocate(compactVertices.data(), vertexCount, indices, indexCount);
+		}
+		else
+		{
+			m_Geometry = m_GeometryArena->Allocate(vertices, vertexCount, indices, indexCount);
+		}
 
 		m_Shader = Renderer::GetShader("PBR");
 	}
+
+	void Mesh::ReleaseGeometry()
+	{
+		if (m_GeometryArena)
+			m_GeometryArena->Free(m_Geometry);
+
+		m_GeometryArena = nullptr;
+		m_Geometry = GeometryAllocation();
+	}
+
+	void Mesh::CalculateBounds()
+	{
+		m_BoundingBox = AABB();
+		m_BoundingSphere = BoundingSphere();
+
+		if (m_SubMeshes.empty())
+			return;
+
+		m_BoundingBox = Math::TransformAABB(m_SubMeshes[0].boundingBox, m_SubMeshes[0].transform);
+		for (const auto &subMesh : m_SubMeshes)
+		{
+			AABB box = Math::TransformAABB(subMesh.boundingBox, subMesh.transform);
+			m_BoundingBox.min = glm::min(m_BoundingBox.min, box.min);
+			m_BoundingBox.max = glm::max(m_BoundingBox.max, box.max);
+		}
+
+		// Enclose the sub mesh spheres instead of the box corners
+		m_BoundingSphere.center = m_BoundingBox.GetCenter();
+		for (const auto &subMesh : m_SubMeshes)
+		{
+			BoundingSphere sphere = Math::TransformSphere(subMesh.boundingSphere, subMesh.transform);
+			float radius = glm::distance(m_BoundingSphere.center, sphere.center) + sphere.radius;
+			m_BoundingSphere.radius = glm::max(m_BoundingSphere.radius, radius);
+		}
+	}
 }
\ No newline at end of file
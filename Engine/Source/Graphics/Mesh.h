@@ -4,6 +4,9 @@
 
 #include "Material.h"
 #include "GraphicsPipeline.h"
+#include "GeometryArena.h"
+#include "Util/Math.h"
+#include "Util/BVH.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -26,9 +29,34 @@ namespace Engine
 		glm::vec2 texCoords;
 	};
 
-	struct Triangle
+	// Packed vertex layout (20 bytes instead of 56):
+	//  - position quantized to 16 bit snorm inside the sub mesh bounds
+	//  - octahedral encoded normal as 16 bit snorm
+	//  - tangent as 10_10_10 snorm, w holds the bitangent sign
+	//  - half float texture coordinates
+	struct CompactVertex
 	{
-		Vertex v1, v2, v3;
+		int16_t position[4];
+		int16_t normal[2];
+		u32 tangent;
+		u32 texCoords;
+	};
+
+	struct MeshImportSettings
+	{
+		u32 importFlags =
+			aiProcess_CalcTangentSpace |
+			aiProcess_Triangulate |
+			aiProcess_SortByPType |
+			aiProcess_GenNormals |
+			aiProcess_GenUVCoords |
+			aiProcess_OptimizeMeshes |
+			aiProcess_ValidateDataStructure;
+
+		// Upload vertices in the packed CompactVertex layout
+		bool compactVertices = false;
+		// Keep the full vertex array on the CPU after upload, only positions are kept otherwise
+		bool retainVertexData = false;
 	};
 
 	struct SubMesh
@@ -37,44 +65,119 @@ namespace Engine
 		u32 vertexCount, indexCount;
 		u32 materialIndex;
 		glm::mat4 transform;
+
+		// Bounds in sub mesh space, transform is not applied
+		AABB boundingBox;
+		BoundingSphere boundingSphere;
+
+		// Maps quantized positions back into sub mesh space (compact vertices only)
+		glm::vec3 dequantizationScale { 1.0f };
+		glm::vec3 dequantizationOffset { 0.0f };
+	};
+
+	struct MeshImportStatistics
+	{
+		u32 textureRequests = 0;		// Texture references of all materials
+		u32 uniqueTextures = 0;			// Distinct files referenced
+		u32 decodedTextures = 0;		// Files that weren't resident in the texture library yet
+		float textureWallTime = 0.0f;	// ms from first decode start to last decode end
+		float textureDecodeTime = 0.0f;	// ms of decoding summed over all textures
 	};
 
 	class Mesh
 	{
+	public:
+		// Returns right away with an empty mesh that reports IsLoading() until its
+		// geometry and materials arrive. Textures keep streaming in afterwards
+		static SharedPtr<Mesh> LoadAsync(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings = MeshImportSettings());
+		// Imports the mesh's file again on a worker and swaps geometry and materials in once
+		// done. The mesh stays drawable with its current data meanwhile and if the import fails.
+		static void Reload(const SharedPtr<Mesh> &mesh);
+
 	public:
 		Mesh();
-		Mesh(ConstRef<std::string> filepath);
+		Mesh(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings = MeshImportSettings());
 		~Mesh();
 
-		void Load(const std::string &filepath);
+		void Load(const std::string &filepath, ConstRef<MeshImportSettings> settings = MeshImportSettings());
 
 		bool IsLoaded() const;
+		bool IsLoading() const { return m_IsLoading; }
 		std::vector<Material> &GetMaterials();
 		std::vector<SubMesh> &GetSubMeshes();
 
 		const std::string& GetFilepath() const { return m_Filepath; }
+		const MeshImportSettings& GetImportSettings() const { return m_ImportSettings; }
+
+		const MeshImportStatistics& GetImportStatistics() const { return m_ImportStatistics; }
+
+		// Bounds of all sub meshes in mesh space
+		const AABB& GetBoundingBox() const { return m_BoundingBox; }
+		const BoundingSphere& GetBoundingSphere() const { return m_BoundingSphere; }
 
 		SharedPtr<Shader> GetShader() { return m_Shader; }
 
 		auto begin() const noexcept { return m_SubMeshes.begin(); }
 		auto end() const noexcept { return m_SubMeshes.end(); }
 
-		const std::vector<Triangle>& GetTriangleRepresentation() const
-		{
-			return m_TriangleRepresentation;
-		}
+		// Mesh space positions, indexed by GetIndices() + sub mesh vertex offset
+		const std::vector<glm::vec3>& GetPositions() const { return m_Positions; }
+		const std::vector<Index>& GetIndices() const { return m_Indices; }
+		// Empty unless the mesh was imported with retainVertexData
+		const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+
+		// Closest hit of a mesh space ray, only accepted when nearer than distance
+		bool Raycast(const Ray &ray, float &distance, u32 &subMeshIndex, u32 &triangleIndex) const;
 
 	private:
+		// Decodes on a worker into a staging mesh, the target is only touched once finalized
+		static void Stream(const SharedPtr<Mesh> &mesh, ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings);
+
+		// Everything but GL, may run on a worker
+		bool Decode(ConstRef<std::string> filepath, ConstRef<MeshImportSettings> settings);
+		// Uploads the decoded geometry, main thread only
+		void Finalize();
+		void TakeDecoded(Mesh &source);
+
+		// Material textures are gathered while decoding and loaded together by LoadTextures()
+		void RequestTexture(u32 materialIndex, u32 slot, const std::string &filepath, bool enabled);
+		void LoadTextures();
+
 		void ProcessNode(aiNode *node, ConstRef<glm::mat4> parenTransform);
 		SubMesh ProcessMesh(aiMesh *mesh, ConstRef<glm::mat4> meshTransform);
 
-		void PreparePipeline();
+		void BuildPositions(const Vertex *vertices);
+		void BuildAccelerationStructure();
+		void CalculateBounds();
+		void PreparePipeline(const Vertex *vertices, u32 vertexCount, const Index *indices, u32 indexCount);
+		void ReleaseGeometry();
 
 	private:
 		std::string m_Filepath;
+		MeshImportSettings m_ImportSettings;
 		bool m_IsLoaded;
+
+		bool m_IsLoading = false;
+		// Lets a pending asynchronous load notice that a newer Load() replaced it
+		u32 m_LoadGeneration = 0;
+		// Set on the staging mesh of LoadAsync: textures stream too and the cache isn't uploaded in place
+		bool m_DecodingAsync = false;
+
+		struct TextureRequest
+		{
+			u32 materialIndex;
+			u32 slot;			// 0 albedo, 1 normal, 2 metalness, 3 roughness
+			std::string filepath;
+			TextureSettings settings;
+			bool enabled;
+		};
+		std::vector<TextureRequest> m_TextureRequests;
+		MeshImportStatistics m_ImportStatistics;
 		std::vector<SubMesh> m_SubMeshes;
 
+		AABB m_BoundingBox;
+		BoundingSphere m_BoundingSphere;
+
 		SharedPtr<Shader> m_Shader;
 		std::vector<Material> m_Materials;
 
@@ -83,11 +186,22 @@ namespace Engine
 		std::vector<Vertex> m_Vertices;
 		std::vector<Index> m_Indices;
 
-		std::vector<Triangle> m_TriangleRepresentation;
+		std::vector<glm::vec3> m_Positions;
+
+		// Triangles in BVH leaf order, referencing m_Indices
+		struct RaycastTriangle
+		{
+			u32 firstIndex;
+			u32 subMeshIndex;
+		};
+		std::vector<RaycastTriangle> m_RaycastTriangles;
+		BVH m_BVH;
 
-		// Pipeline
-		GraphicsPipeline m_Pipeline;
+		// Vertices and indices live in the renderer's arena for this vertex layout
+		SharedPtr<GeometryArena> m_GeometryArena;
+		GeometryAllocation m_Geometry;
 
 		friend class Renderer;
+		friend class MeshSerializer;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "Precompiled.h"
+#include "MeshLibrary.h"
+
+#include <filesystem>
+
+
+namespace Engine
+{
+	struct MeshLibraryData
+	{
+		std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+		MeshLibraryStatistics statistics;
+	};
+	static MeshLibraryData s_MeshLibraryData;
+
+	SharedPtr<Mesh> MeshLibrary::Load(const std::string &filepath, ConstRef<MeshImportSettings> settings)
+	{
+		return Acquire(filepath, settings, false);
+	}
+
+	SharedPtr<Mesh> MeshLibrary::LoadAsync(const std::string &filepath, ConstRef<MeshImportSettings> settings)
+	{
+		return Acquire(filepath, settings, true);
+	}
+
+	SharedPtr<Mesh> MeshLibrary::Acquire(const std::string &filepath, ConstRef<MeshImportSettings> settings, bool async)
+	{
+		auto &stats = s_MeshLibraryData.statistics;
+		stats.loads++;
+
+		std::string key = CreateKey(filepath, settings);
+
+		auto it = s_MeshLibraryData.meshes.find(key);
+		if (it != s_MeshLibraryData.meshes.end())
+		{
+			auto mesh = it->second.lock();
+			if (mesh && (mesh->IsLoaded() || mesh->IsLoading()))
+			{
+				stats.hits++;
+				return mesh;
+			}
+
+			// Last handle was released since the previous request, or an asynchronous import failed
+			s_MeshLibraryData.meshes.erase(it);
+			if (!mesh)
+				stats.evictions++;
+		}
+
+		stats.misses++;
+
+		auto mesh = async ? Mesh::LoadAsync(filepath, settings) : MakeShared<Mesh>(filepath, settings);
+
+		// Don't cache failed imports so the next request can retry
+		if (mesh->IsLoaded() || mesh->IsLoading())
+			s_MeshLibraryData.meshes[key] = mesh;
+
+		CollectGarbage();
+
+		return mesh;
+	}
+
+	u32 MeshLibrary::Reload(const std::string &filepath)
+	{
+		// Keys are the canonical path followed by the import settings
+		const std::string prefix = CanonicalPath(filepath) + "|";
+
+		u32 reloaded = 0;
+		for (auto &[key, entry] : s_MeshLibraryData.meshes)
+		{
+			if (key.compare(0, prefix.size(), prefix) != 0)
+				continue;
+
+			if (auto mesh = entry.lock())
+			{
+				Mesh::Reload(mesh);
+				reloaded++;
+			}
+		}
+		return reloaded;
+	}
+
+	void MeshLibrary::CollectGarbage()
+	{
+		auto &meshes = s_MeshLibraryData.meshes;
+		auto &stats = s_MeshLibraryData.statistics;
+
+		for (auto it = meshes.begin(); it != meshes.end();)
+		{
+			if (it->second.expired())
+			{
+				it = meshes.erase(it);
+				stats.evictions++;
+			}
+			else
+				it++;
+		}
+
+		stats.residentMeshes = static_cast<u32>(meshes.size());
+	}
+
+	void MeshLibrary::Clear()
+	{
+		s_MeshLibraryData.meshes.clear();
+		s_MeshLibraryData.statistics.residentMeshes = 0;
+	}
+
+	const MeshLibraryStatistics &MeshLibrary::GetStatistics()
+	{
+		return s_MeshLibraryData.statistics;
+	}
+
+	std::string MeshLibrary::CanonicalPath(const std::string &filepath)
+	{
+		std::error_code error;
+		std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+
+		return error ? filepath : canonicalPath.generic_string();
+	}
+
+	std::string MeshLibrary::CreateKey(const std::string &filepath, ConstRef<MeshImportSettings> settings)
+	{
+		std::string key = CanonicalPath(filepath);
+		key += "|" + std::to_string(settings.importFlags);
+		key += settings.compactVertices ? "|compact" : "";
+		key += settings.retainVertexData ? "|retain" : "";
+
+		return key;
+	}
+}
\ No newline at end of file
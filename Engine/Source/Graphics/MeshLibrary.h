@@ -0,0 +1,43 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Mesh.h"
+
+#include <unordered_map>
+
+
+namespace Engine
+{
+	struct MeshLibraryStatistics
+	{
+		u32 loads = 0;			// Total Load() requests
+		u32 hits = 0;			// Requests served by an already resident mesh
+		u32 misses = 0;			// Requests that had to import the mesh
+		u32 evictions = 0;		// Meshes dropped after their last handle was released
+		u32 residentMeshes = 0;
+	};
+
+	// Hands out shared mesh handles keyed by canonical filepath and import settings.
+	// The library only holds weak references, so a mesh is evicted as soon as the
+	// last component referencing it lets go of its handle.
+	class MeshLibrary
+	{
+	public:
+		static SharedPtr<Mesh> Load(const std::string &filepath, ConstRef<MeshImportSettings> settings = MeshImportSettings());
+		// Shares meshes with Load(), a pending mesh is handed out while it streams in
+		static SharedPtr<Mesh> LoadAsync(const std::string &filepath, ConstRef<MeshImportSettings> settings = MeshImportSettings());
+
+		// Reimports every resident mesh of the file in place, whatever its import settings
+		static u32 Reload(const std::string &filepath);
+
+		static void CollectGarbage();
+		static void Clear();
+
+		static const MeshLibraryStatistics &GetStatistics();
+
+	private:
+		static SharedPtr<Mesh> Acquire(const std::string &filepath, ConstRef<MeshImportSettings> settings, bool async);
+		static std::string CanonicalPath(const std::string &filepath);
+		static std::string CreateKey(const std::string &filepath, ConstRef<MeshImportSettings> settings);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "Precompiled.h"
+#include "MeshSerializer.h"
+#include "TextureLibrary.h"
+
+#include "Core/MappedFile.h"
+#include "Util/Hash.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+
+namespace Engine
+{
+	static const char *s_MeshCacheDirectory = "Cache/Meshes";
+	static const char s_MeshCacheMagic[4] = { 'M', 'E', 'M', 'C' };
+
+	static constexpr u32 s_MaterialTextureSlots = 4;
+
+	struct MeshCacheHeader
+	{
+		char magic[4];
+		u32 version;
+		u64 sourceHash;
+
+		u32 vertexCount, indexCount;
+		u32 subMeshCount, materialCount;
+
+		u64 vertexDataOffset, indexDataOffset;
+		u64 subMeshDataOffset, materialDataOffset;
+	};
+
+	struct MeshCacheSubMesh
+	{
+		u32 vertexOffset, indexOffset;
+		u32 vertexCount, indexCount;
+		u32 materialIndex;
+		glm::mat4 transform;
+		AABB boundingBox;
+		BoundingSphere boundingSphere;
+	};
+
+	// Materials are variable sized: name, parameters and one filepath per texture slot
+	class MeshCacheWriter
+	{
+	public:
+		MeshCacheWriter(std::ofstream &stream) : m_Stream(stream) {}
+
+		template<typename Type>
+		void Write(const Type &value) { m_Stream.write(reinterpret_cast<const char *>(&value), sizeof(Type)); }
+		void Write(const void *data, std::size_t size) { m_Stream.write(static_cast<const char *>(data), size); }
+
+		void WriteString(const std::string &string)
+		{
+			Write<u32>(static_cast<u32>(string.size()));
+			Write(string.data(), string.size());
+		}
+
+		// Pads the stream so the next block starts on an 8 byte boundary
+		u64 Align()
+		{
+			u64 position = static_cast<u64>(m_Stream.tellp());
+			while (position % 8 != 0)
+			{
+				m_Stream.put(0);
+				position++;
+			}
+			return position;
+		}
+
+	private:
+		std::ofstream &m_Stream;
+	};
+
+	class MeshCacheReader
+	{
+	public:
+		MeshCacheReader(const u8 *data, std::size_t size, u64 offset) :
+			m_Data(data), m_Size(size), m_Offset(offset) {}
+
+		template<typename Type>
+		bool Read(Type &value) { return Read(&value, sizeof(Type)); }
+		bool Read(void *data, std::size_t size)
+		{
+			if (m_Offset + size > m_Size)
+				return false;
+
+			std::memcpy(data, m_Data + m_Offset, size);
+			m_Offset += size;
+			return true;
+		}
+
+		bool ReadString(std::string &string)
+		{
+			u32 length;
+			if (!Read(length) || m_Offset + length > m_Size)
+				return false;
+
+			string.assign(reinterpret_cast<const char *>(m_Data + m_Offset), length);
+			m_Offset += length;
+			return true;
+		}
+
+	private:
+		const u8 *m_Data;
+		std::size_t m_Size;
+		u64 m_Offset;
+	};
+
+	u64 MeshSerializer::CalculateSourceHash(const std::string &filepath, ConstRef<MeshImportSettings> settings)
+	{
+		u64 hash = Hash::File(filepath);
+		if (!hash)
+			return 0;
+
+		hash = Hash::FNV1aValue(settings.importFlags, hash);
+		hash = Hash::FNV1aValue(Version, hash);
+
+		return hash;
+	}
+
+	std::string MeshSerializer::GetCachePath(u64 sourceHash)
+	{
+		return std::string(s_MeshCacheDirectory) + "/" + Hash::ToString(sourceHash) + ".mesh";
+	}
+
+	bool MeshSerializer::Serialize(const Mesh &mesh, const std::string &cachePath, u64 sourceHash)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+		// Write to a temporary file first so a partially written cache is never picked up
+		std::string temporaryPath = cachePath + ".tmp";
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			ME_WARN("Failed to create Mesh cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		MeshCacheWriter writer(stream);
+
+		MeshCacheHeader header = {};
+		std::memcpy(header.magic, s_MeshCacheMagic, sizeof(header.magic));
+		header.version = Version;
+		header.sourceHash = sourceHash;
+		header.vertexCount = static_cast<u32>(mesh.m_Vertices.size());
+		header.indexCount = static_cast<u32>(mesh.m_Indices.size());
+		header.subMeshCount = static_cast<u32>(mesh.m_SubMeshes.size());
+		header.materialCount = static_cast<u32>(mesh.m_Materials.size());
+
+		// Header is written again once all offsets are known
+		writer.Write(header);
+
+		header.vertexDataOffset = writer.Align();
+		writer.Write(mesh.m_Vertices.data(), mesh.m_Vertices.size() * sizeof(Vertex));
+
+		header.indexDataOffset = writer.Align();
+		writer.Write(mesh.m_Indices.data(), mesh.m_Indices.size() * sizeof(Index));
+
+		header.subMeshDataOffset = writer.Align();
+		for (auto &subMesh : mesh.m_SubMeshes)
+		{
+			MeshCacheSubMesh cacheSubMesh = {
+				subMesh.vertexOffset, subMesh.indexOffset,
+				subMesh.vertexCount, subMesh.indexCount,
+				subMesh.materialIndex,
+				subMesh.transform,
+				subMesh.boundingBox,
+				subMesh.boundingSphere
+			};
+			writer.Write(cacheSubMesh);
+		}
+
+		header.materialDataOffset = writer.Align();
+		for (auto &material : mesh.m_Materials)
+		{
+			auto &params = material.GetParameters();
+			auto &textures = material.GetTextures();
+
+			writer.WriteString(material.GetName());
+			writer.Write(params);
+			writer.Write(material.GetFlags());
+
+			const SharedPtr<Texture> slots[s_MaterialTextureSlots] = { textures.albedo, textures.normal, textures.metalness, textures.roughness };
+			const bool enabled[s_MaterialTextureSlots] = { textures.useAlbedo, textures.useNormal, textures.useMetalness, textures.useRoughness };
+
+			for (u32 i = 0; i < s_MaterialTextureSlots; i++)
+			{
+				// Pending textures of an asynchronous load aren't loaded yet but have their path
+				bool hasTexture = slots[i] && !slots[i]->GetFilepath().empty();
+				writer.WriteString(hasTexture ? slots[i]->GetFilepath() : std::string());
+				writer.Write<u8>(enabled[i] ? 1 : 0);
+			}
+		}
+
+		stream.seekp(0);
+		writer.Write(header);
+
+		bool success = stream.good();
+		stream.close();
+
+		if (success)
+		{
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			success = !error;
+		}
+		if (!success)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			ME_WARN("Failed to write Mesh cache: %s", cachePath.c_str());
+		}
+
+		return success;
+	}
+
+	bool MeshSerializer::Deserialize(Mesh &mesh, const std::string &cachePath, u64 sourceHash)
+	{
+		MappedFile file;
+		if (!file.Open(cachePath))
+			return false;
+
+		const u8 *data = file.GetData();
+		std::size_t size = file.GetSize();
+
+		MeshCacheHeader header;
+		if (size < sizeof(header))
+			return false;
+		std::memcpy(&header, data, sizeof(header));
+
+		if (std::memcmp(header.magic, s_MeshCacheMagic, sizeof(header.magic)) != 0 ||
+			header.version != Version || header.sourceHash != sourceHash)
+		{
+			ME_WARN("Ignoring outdated Mesh cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		if (header.vertexDataOffset + u64(header.vertexCount) * sizeof(Vertex) > size ||
+			header.indexDataOffset + u64(header.indexCount) * sizeof(Index) > size ||
+			header.subMeshDataOffset + u64(header.subMeshCount) * sizeof(MeshCacheSubMesh) > size ||
+			header.materialDataOffset > size)
+		{
+			ME_WARN("Ignoring corrupted Mesh cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		auto Corrupted = [&]()
+		{
+			ME_WARN("Ignoring corrupted Mesh cache: %s", cachePath.c_str());
+			mesh.m_SubMeshes.clear();
+			mesh.m_Materials.clear();
+			mesh.m_TextureRequests.clear();
+			return false;
+		};
+
+		// Sub meshes
+		MeshCacheReader subMeshReader(data, size, header.subMeshDataOffset);
+		mesh.m_SubMeshes.resize(header.subMeshCount);
+		for (auto &subMesh : mesh.m_SubMeshes)
+		{
+			MeshCacheSubMesh cacheSubMesh;
+			subMeshReader.Read(cacheSubMesh);
+
+			subMesh.vertexOffset = cacheSubMesh.vertexOffset;
+			subMesh.indexOffset = cacheSubMesh.indexOffset;
+			subMesh.vertexCount = cacheSubMesh.vertexCount;
+			subMesh.indexCount = cacheSubMesh.indexCount;
+			subMesh.materialIndex = cacheSubMesh.materialIndex;
+			subMesh.transform = cacheSubMesh.transform;
+			subMesh.boundingBox = cacheSubMesh.boundingBox;
+			subMesh.boundingSphere = cacheSubMesh.boundingSphere;
+		}
+
+		// Materials
+		MeshCacheReader materialReader(data, size, header.materialDataOffset);
+		mesh.m_Materials.reserve(header.materialCount);
+		for (u32 i = 0; i < header.materialCount; i++)
+		{
+			std::string name;
+			PBRMaterialParameters params;
+			u32 flags;
+			std::string texturePaths[s_MaterialTextureSlots];
+			u8 enabled[s_MaterialTextureSlots];
+
+			bool valid = materialReader.ReadString(name) && materialReader.Read(params) && materialReader.Read(flags);
+			for (u32 slot = 0; slot < s_MaterialTextureSlots && valid; slot++)
+				valid = materialReader.ReadString(texturePaths[slot]) && materialReader.Read(enabled[slot]);
+
+			if (!valid)
+				return Corrupted();
+
+			Material material(name);
+			material.GetParameters() = params;
+			material.SetFlags(flags);
+
+			material.GetTextures() = {
+				TextureLibrary::GetDefault(TextureSlot::Albedo), false,
+				TextureLibrary::GetDefault(TextureSlot::Normal), false,
+				TextureLibrary::GetDefault(TextureSlot::Metalness), false,
+				TextureLibrary::GetDefault(TextureSlot::Roughness), false
+			};
+
+			for (u32 slot = 0; slot < s_MaterialTextureSlots; slot++)
+			{
+				if (!texturePaths[slot].empty())
+					mesh.RequestTexture(i, slot, texturePaths[slot], enabled[slot] != 0);
+			}
+
+			mesh.m_Materials.push_back(material);
+		}
+
+		const Vertex *vertices = reinterpret_cast<const Vertex *>(data + header.vertexDataOffset);
+		const Index *indices = reinterpret_cast<const Index *>(data + header.indexDataOffset);
+
+		// Sub mesh ranges and indices are used as is by raycasts and draws
+		for (auto &subMesh : mesh.m_SubMeshes)
+		{
+			if (u64(subMesh.vertexOffset) + subMesh.vertexCount > header.vertexCount ||
+				u64(subMesh.indexOffset) + subMesh.indexCount > header.indexCount ||
+				subMesh.materialIndex >= header.materialCount)
+				return Corrupted();
+
+			const Index *subMeshIndices = indices + subMesh.indexOffset;
+			for (u32 i = 0; i < subMesh.indexCount; i++)
+			{
+				if (subMeshIndices[i] >= subMesh.vertexCount)
+					return Corrupted();
+			}
+		}
+
+		mesh.m_Indices.assign(indices, indices + header.indexCount);
+		mesh.BuildPositions(vertices);
+
+		// Geometry is uploaded straight from the mapped pages, unless this runs on a
+		// worker and the upload has to wait for the main thread
+		if (mesh.m_ImportSettings.retainVertexData || mesh.m_DecodingAsync)
+			mesh.m_Vertices.assign(vertices, vertices + header.vertexCount);
+
+		if (!mesh.m_DecodingAsync)
+			mesh.PreparePipeline(vertices, header.vertexCount, indices, header.indexCount);
+
+		return true;
+	}
+}
\ No newline at end of file
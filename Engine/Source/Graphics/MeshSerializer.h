@@ -0,0 +1,23 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Mesh.h"
+
+
+namespace Engine
+{
+	// Versioned binary cache of processed meshes (vertices, indices, sub meshes and materials).
+	// Cache files are keyed by a hash of the source file and the import settings, so a
+	// changed source or different import flags simply miss the cache.
+	class MeshSerializer
+	{
+	public:
+		static constexpr u32 Version = 4;
+
+		static u64 CalculateSourceHash(const std::string &filepath, ConstRef<MeshImportSettings> settings);
+		static std::string GetCachePath(u64 sourceHash);
+
+		static bool Serialize(const Mesh &mesh, const std::string &cachePath, u64 sourceHash);
+		static bool Deserialize(Mesh &mesh, const std::string &cachePath, u64 sourceHash);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "Precompiled.h"
+#include "MipChain.h"
+
+#include "Core/JobSystem.h"
+
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+
+
+namespace Engine
+{
+	static constexpr u32 LinearToSRGBSteps = 16384;
+
+	struct MipFilterTables
+	{
+		float unormToFloat[256];
+		float srgbToLinear[256];
+		float unormToNormal[256];	// [0, 255] to [-1, 1]
+		u8 linearToSRGB[LinearToSRGBSteps];
+
+		MipFilterTables()
+		{
+			for (u32 i = 0; i < 256; i++)
+			{
+				float value = i / 255.0f;
+				unormToFloat[i] = value;
+				srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+				unormToNormal[i] = value * 2.0f - 1.0f;
+			}
+
+			for (u32 i = 0; i < LinearToSRGBSteps; i++)
+			{
+				float value = float(i) / (LinearToSRGBSteps - 1);
+				float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				linearToSRGB[i] = u8(std::min(std::max(srgb * 255.0f + 0.5f, 0.0f), 255.0f));
+			}
+		}
+	};
+
+	static const MipFilterTables &GetTables()
+	{
+		static const MipFilterTables s_Tables;
+		return s_Tables;
+	}
+
+	using SourcePixels = const u8 *[4];
+
+	static void FilterLinear(const SourcePixels &source, u8 *target)
+	{
+		for (u32 c = 0; c < 4; c++)
+			target[c] = u8((source[0][c] + source[1][c] + source[2][c] + source[3][c] + 2) >> 2);
+	}
+
+	static void FilterSRGB(const MipFilterTables &tables, const SourcePixels &source, u8 *target)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (u32 i = 0; i < 4; i++)
+		{
+			const u8 *p = source[i];
+			sum = _mm_add_ps(sum, _mm_setr_ps(tables.srgbToLinear[p[0]], tables.srgbToLinear[p[1]], tables.srgbToLinear[p[2]], tables.unormToFloat[p[3]]));
+		}
+
+		// Color indexes the linear to sRGB table, alpha is rounded directly
+		const __m128 scale = _mm_setr_ps(0.25f * (LinearToSRGBSteps - 1), 0.25f * (LinearToSRGBSteps - 1), 0.25f * (LinearToSRGBSteps - 1), 0.25f * 255.0f);
+		alignas(16) int values[4];
+		_mm_store_si128(reinterpret_cast<__m128i *>(values), _mm_cvtps_epi32(_mm_mul_ps(sum, scale)));
+
+		for (u32 c = 0; c < 3; c++)
+			target[c] = tables.linearToSRGB[std::min(std::max(values[c], 0), int(LinearToSRGBSteps - 1))];
+		target[3] = u8(std::min(std::max(values[3], 0), 255));
+	}
+
+	static void FilterNormalMap(const MipFilterTables &tables, const SourcePixels &source, u8 *target)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (u32 i = 0; i < 4; i++)
+		{
+			const u8 *p = source[i];
+			sum = _mm_add_ps(sum, _mm_setr_ps(tables.unormToNormal[p[0]], tables.unormToNormal[p[1]], tables.unormToNormal[p[2]], tables.unormToFloat[p[3]]));
+		}
+
+		// Length of xyz in every lane
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		__m128 squared = _mm_and_ps(_mm_mul_ps(sum, sum), xyzMask);
+		squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+		squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 0, 3, 2)));
+		const __m128 length = _mm_sqrt_ps(squared);
+
+		// Opposing normals cancel out, fall back to the surface normal
+		__m128 normal = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+		if (_mm_cvtss_f32(length) > 1e-6f)
+			normal = _mm_div_ps(sum, length);
+
+		const __m128 alpha = _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+		__m128 encoded = _mm_add_ps(_mm_mul_ps(normal, _mm_set1_ps(127.5f)), _mm_set1_ps(127.5f));
+		encoded = _mm_or_ps(_mm_and_ps(xyzMask, encoded), _mm_andnot_ps(xyzMask, _mm_mul_ps(alpha, _mm_set1_ps(255.0f))));
+
+		__m128i packed = _mm_cvtps_epi32(encoded);
+		packed = _mm_packs_epi32(packed, packed);
+		packed = _mm_packus_epi16(packed, packed);
+
+		const int value = _mm_cvtsi128_si32(packed);
+		std::memcpy(target, &value, 4);
+	}
+
+	// Four output pixels of the linear filter from 8x2 source pixels
+	static void FilterLinear4(const u8 *row0, const u8 *row1, u8 *target)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		__m128i result[2];
+		for (u32 half = 0; half < 2; half++)
+		{
+			__m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + half * 16));
+			__m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + half * 16));
+
+			// Vertical sums of source pixels 0,1 and 2,3 widened to 16 bit
+			__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+			__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+			// Horizontal pairs end up in the lower four lanes
+			low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+			high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+			result[half] = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), rounding), 2);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(target), _mm_packus_epi16(result[0], result[1]));
+	}
+
+	u32 MipChain::GetLevelCount(u32 width, u32 height)
+	{
+		u32 levels = 1;
+		while ((width | height) >> levels)
+			levels++;
+		return levels;
+	}
+
+	std::vector<u8> MipChain::Downsample(const u8 *pixels, u32 width, u32 height, MipFilter filter)
+	{
+		const u32 targetWidth = std::max(width / 2, 1u), targetHeight = std::max(height / 2, 1u);
+		std::vector<u8> target(std::size_t(targetWidth) * targetHeight * 4);
+
+		const MipFilterTables &tables = GetTables();
+		u8 *output = target.data();
+
+		JobSystem::ParallelFor(targetHeight, 16, [=, &tables](u32 begin, u32 end)
+			{
+				for (u32 y = begin; y < end; y++)
+				{
+					const u8 *row0 = pixels + std::size_t(std::min(2 * y, height - 1)) * width * 4;
+					const u8 *row1 = pixels + std::size_t(std::min(2 * y + 1, height - 1)) * width * 4;
+					u8 *targetRow = output + std::size_t(y) * targetWidth * 4;
+
+					u32 x = 0;
+
+					// Full 2x2 footprints, four at a time
+					if (filter == MipFilter::Linear)
+					{
+						for (; x + 4 <= width / 2; x += 4)
+							FilterLinear4(row0 + x * 8, row1 + x * 8, targetRow + x * 4);
+					}
+
+					for (; x < targetWidth; x++)
+					{
+						const u32 x0 = std::min(2 * x, width - 1) * 4, x1 = std::min(2 * x + 1, width - 1) * 4;
+						SourcePixels source = { row0 + x0, row0 + x1, row1 + x0, row1 + x1 };
+
+						switch (filter)
+						{
+							case MipFilter::Linear: FilterLinear(source, targetRow + x * 4); break;
+							case MipFilter::SRGB: FilterSRGB(tables, source, targetRow + x * 4); break;
+							case MipFilter::NormalMap: FilterNormalMap(tables, source, targetRow + x * 4); break;
+						}
+					}
+				}
+			});
+
+		return target;
+	}
+
+	std::vector<u8> MipChain::Generate(const u8 *pixels, u32 width, u32 height, MipFilter filter, u32 &levels)
+	{
+		levels = GetLevelCount(width, height);
+
+		std::size_t totalSize = 0;
+		for (u32 level = 0; level < levels; level++)
+			totalSize += std::size_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+
+		std::vector<u8> chain(totalSize);
+		std::memcpy(chain.data(), pixels, std::size_t(width) * height * 4);
+
+		std::size_t offset = 0;
+		for (u32 level = 1; level < levels; level++)
+		{
+			const u32 sourceWidth = std::max(width >> (level - 1), 1u), sourceHeight = std::max(height >> (level - 1), 1u);
+			std::vector<u8> next = Downsample(chain.data() + offset, sourceWidth, sourceHeight, filter);
+
+			offset += std::size_t(sourceWidth) * sourceHeight * 4;
+			std::memcpy(chain.data() + offset, next.data(), next.size());
+		}
+
+		return chain;
+	}
+}
\ No newline at end of file
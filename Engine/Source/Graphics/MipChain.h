@@ -0,0 +1,26 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+
+namespace Engine
+{
+	enum class MipFilter : u32
+	{
+		Linear = 0,		// Plain average of all four channels
+		SRGB,			// Color averaged in linear space, alpha as is
+		NormalMap,		// Tangent space normals averaged and renormalized, alpha as is
+	};
+
+	// CPU mip generation for RGBA8 images, rows are filtered in parallel on the job system
+	class MipChain
+	{
+	public:
+		static u32 GetLevelCount(u32 width, u32 height);
+
+		// Halves the image with a 2x2 box filter, odd edges repeat their last pixel
+		static std::vector<u8> Downsample(const u8 *pixels, u32 width, u32 height, MipFilter filter);
+
+		// All levels back to back, starting with a copy of the source image
+		static std::vector<u8> Generate(const u8 *pixels, u32 width, u32 height, MipFilter filter, u32 &levels);
+	};
+}
\ No newline at end of file
@@ -4,25 +4,268 @@
 #include "GraphicsPipeline.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include "Material.h"
+#include "GeometryArena.h"
+#include "Scene/Scene.h"
+#include "Util/Math.h"
+#include "Core/JobSystem.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glad/glad.h>
 #include <imgui.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
 #include <unordered_map>
 
 
 namespace Engine
 {
+	// Uniform block bindings shared with the shaders
+	static constexpr u32 CameraUniformBinding = 0;
+	static constexpr u32 LightUniformBinding = 1;
+
+	// Shader storage bindings
+	static constexpr u32 InstanceDataBinding = 0;
+	static constexpr u32 MaterialDataBinding = 1;
+
+	// Vertex attribute holding the index into the instance data (see PBR.glsl)
+	static constexpr int InstanceIndexLocation = 5;
+
+	static constexpr u32 MaxDirectionalLights = 4;
+	static constexpr u32 MaterialTextureUnits = 4;
+	static constexpr u32 InitialMaterialSlots = 64;
+	static constexpr u32 InitialInstanceCapacity = 4096;
+	// Per frame camera, light, instance, indirect and line data, grows when a frame needs more
+	static constexpr u32 StreamingFrameSize = 4 * 1024 * 1024;
+	// Smaller ranges cost more in scheduling than they save
+	static constexpr u32 CullBatchSize = 2048;
+
+	static_assert(sizeof(MaterialUniformData) == 32, "MaterialUniformData has to match the std430 layout in PBR.glsl");
+
+	// Macros of the PBR.glsl variants, indexed by the bits of the variant key. The
+	// MaterialFeature bits come first, the vertex format is a property of the mesh.
+	static const char *const s_VariantDefines[] = {
+		"ENABLE_ALBEDO_TEXTURE",
+		"ENABLE_NORMAL_MAP_TEXTURE",
+		"ENABLE_METALNESS_TEXTURE",
+		"ENABLE_ROUGHNESS_TEXTURE",
+		"COMPACT_VERTICES"
+	};
+	static constexpr u32 CompactVerticesVariant = 1u << 4;
+	static_assert(static_cast<u32>(MaterialFeature::RoughnessTexture) < CompactVerticesVariant, "Variant key bits overlap");
+
+	// std140 mirrors of the blocks in PBR.glsl
+	struct CameraUniformData
+	{
+		glm::mat4 projectionView;
+		glm::vec3 position;
+		float padding;
+	};
+	struct DirectionalLightUniformData
+	{
+		glm::vec3 direction;
+		float multiplier;
+		glm::vec3 radiance;
+		int active;
+	};
+	struct LightUniformData
+	{
+		DirectionalLightUniformData directionalLights[MaxDirectionalLights];
+	};
+
+	// std430 mirror of InstanceData in PBR.glsl
+	struct InstanceData
+	{
+		glm::mat4 transform;
+		glm::vec3 dequantizationScale;
+		u32 materialIndex;
+		glm::vec3 dequantizationOffset;
+		u32 padding;
+	};
+
+	// Layout consumed by glMultiDrawElementsIndirect
+	struct DrawElementsIndirectCommand
+	{
+		u32 count;
+		u32 instanceCount;
+		u32 firstIndex;
+		int baseVertex;
+		u32 baseInstance;
+	};
+
+	struct LineVertex
+	{
+		glm::vec3 position;
+		glm::vec4 color;
+	};
+	struct DebugLine
+	{
+		glm::vec3 from, to;
+		glm::vec4 color;
+		float thickness;
+	};
+
+	struct DrawPacket
+	{
+		const GraphicsPipeline *pipeline;
+		Shader *shader;
+		Material *material;
+		const SubMesh *subMesh;
+		u32 subMeshIndex;
+		glm::mat4 transform;
+
+		// Sub mesh range inside the geometry arena
+		u32 firstIndex;
+		int baseVertex;
+	};
+
+	// Packets are sorted through these instead of moving the packets themselves
+	struct DrawKey
+	{
+		u64 key;
+		u32 packetIndex;
+
+		bool operator<(const DrawKey &other) const { return key < other.key; }
+	};
+
 	struct RendererData
 	{
 		GraphicsPipeline quadPipeline;
 		GraphicsPipeline skyboxPipeline;
 
 		std::unordered_map <std::string, SharedPtr<Shader>> shaders;
+
+		// Everything rewritten each frame, bound by range so the regions never stall on the GPU
+		UniquePtr<StreamingBuffer> streamingBuffer;
+		u32 uniformAlignment = 256;
+		u32 storageAlignment = 256;
+
+		// Every material owns a fixed slot in this buffer, so its
+		// parameters are only uploaded when they actually change
+		UniquePtr<StorageBuffer> materialBuffer;
+		u32 materialSlotCount = 0;
+		std::vector<u32> freeMaterialSlots;
+
+		// All meshes of one vertex layout share a vertex array
+		SharedPtr<GeometryArena> geometryArena;
+		SharedPtr<GeometryArena> compactGeometryArena;
+
+		// Holds 0, 1, 2, ... so a_InstanceIndex = baseInstance + gl_InstanceID
+		SharedPtr<VertexBuffer> instanceIndexBuffer;
+		u32 instanceCapacity = 0;
+
+		std::vector<DrawPacket> drawPackets;
+		std::vector<DrawKey> drawKeys;
+
+		// Per instance data in draw order and one indirect command per instanced run
+		std::vector<InstanceData> instanceData;
+		std::vector<DrawElementsIndirectCommand> drawCommands;
+		std::vector<u32> drawCommandPackets;	// First key index of every command
+
+		// World space sub mesh bounds, indexed like drawPackets
+		AABBBatch packetBounds;
+		std::vector<u8> packetVisibility;
+		Frustum frustum;
+		bool frustumCulling = true;
+
+		// Drawn after the meshes of the current scene
+		std::vector<DebugLine> lines;
+		RendererID lineVertexArray = 0;
+
+		bool multiDrawIndirect = false;
+		glm::vec3 cameraPosition = glm::vec3(0.0f);
+		bool sceneActive = false;
+
+		RendererStatistics statistics;
 	};
 	static RendererData s_RendererData;
 
+	// Draw key layout, most significant bits first:
+	//  opaque:      0 | shader (10) | material (16) | vertex array (13) | sub mesh (8) | depth front to back (16)
+	//  transparent: 1 | depth back to front (24) | shader (10) | material (16) | vertex array (13)
+	// Sorting sub mesh before depth keeps instances of the same sub mesh adjacent.
+	// Ids are truncated, so a collision only costs batching, never correctness.
+	static u64 CreateDrawKey(bool transparent, u32 shaderID, u32 materialSlot, u32 vertexArrayID, u32 subMeshIndex, float depth)
+	{
+		// The bit pattern of a non-negative float sorts like the float itself
+		u32 depthBits;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+		const u64 shader = shaderID & 0x3ff;
+		const u64 material = materialSlot & 0xffff;
+		const u64 vertexArray = vertexArrayID & 0x1fff;
+
+		if (transparent)
+		{
+			const u64 inverseDepth = ~(depthBits >> 8) & 0xffffff;
+			return (1ull << 63) | (inverseDepth << 39) | (shader << 29) | (material << 13) | vertexArray;
+		}
+
+		const u64 subMesh = subMeshIndex & 0xff;
+		return (shader << 53) | (material << 37) | (vertexArray << 24) | (subMesh << 16) | (depthBits >> 16);
+	}
+
+	static bool CanInstance(const DrawPacket &first, const DrawPacket &other)
+	{
+		return first.subMesh == other.subMesh && first.material == other.material &&
+			first.shader == other.shader && first.pipeline == other.pipeline;
+	}
+
+	// Textures the shader samples for this material, 0 for units it ignores
+	static void GetRequiredTextures(const Material &material, RendererID (&textures)[MaterialTextureUnits])
+	{
+		const auto &materialTextures = material.GetTextures();
+		const SharedPtr<Texture> *slots[MaterialTextureUnits] = { &materialTextures.albedo, &materialTextures.normal, &materialTextures.metalness, &materialTextures.roughness };
+		const bool used[MaterialTextureUnits] = { materialTextures.useAlbedo, materialTextures.useNormal, materialTextures.useMetalness, materialTextures.useRoughness };
+
+		for (u32 unit = 0; unit < MaterialTextureUnits; unit++)
+		{
+			const auto &texture = *slots[unit];
+			textures[unit] = used[unit] && texture && texture->IsLoaded() ? texture->GetRendererID() : 0;
+		}
+	}
+
+	// Without bindless textures a multi draw can only span materials whose textures don't conflict
+	static bool MergeTextures(RendererID (&batch)[MaterialTextureUnits], const RendererID (&textures)[MaterialTextureUnits])
+	{
+		for (u32 unit = 0; unit < MaterialTextureUnits; unit++)
+		{
+			if (batch[unit] && textures[unit] && batch[unit] != textures[unit])
+				return false;
+		}
+		for (u32 unit = 0; unit < MaterialTextureUnits; unit++)
+		{
+			if (!batch[unit])
+				batch[unit] = textures[unit];
+		}
+		return true;
+	}
+
+	static void EnsureInstanceCapacity(u32 instanceCount)
+	{
+		auto &data = s_RendererData;
+		if (instanceCount <= data.instanceCapacity)
+			return;
+
+		u32 capacity = std::max(data.instanceCapacity, InitialInstanceCapacity);
+		while (capacity < instanceCount)
+			capacity *= 2;
+
+		std::vector<u32> indices(capacity);
+		for (u32 i = 0; i < capacity; i++)
+			indices[i] = i;
+
+		data.instanceIndexBuffer = MakeShared<VertexBuffer>(indices.data(), capacity * static_cast<u32>(sizeof(u32)), BufferUsage::Static);
+		data.instanceCapacity = capacity;
+
+		const PipelineLayout instanceLayout = { { "a_InstanceIndex", VertexFormat::UInt1, false, InstanceIndexLocation } };
+		data.geometryArena->SetInstanceBuffer(instanceLayout, data.instanceIndexBuffer);
+		data.compactGeometryArena->SetInstanceBuffer(instanceLayout, data.instanceIndexBuffer);
+	}
+
 	void Renderer::Initialize()
 	{
 		ME_INFO("Initializing Renderer");
@@ -97,15 +340,97 @@ namespace Engine
 
 		s_RendererData.skyboxPipeline.Create();
 
+		GLint uniformAlignment, storageAlignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		s_RendererData.uniformAlignment = static_cast<u32>(std::max(uniformAlignment, 16));
+		s_RendererData.storageAlignment = static_cast<u32>(std::max(storageAlignment, 16));
+
+		s_RendererData.streamingBuffer = MakeUnique<StreamingBuffer>(StreamingFrameSize);
+
+		// Vertices are sourced from the streaming buffer at a different offset every frame
+		RendererID lineVertexArray;
+		glCreateVertexArrays(1, &lineVertexArray);
+		glEnableVertexArrayAttrib(lineVertexArray, 0);
+		glVertexArrayAttribFormat(lineVertexArray, 0, 3, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(LineVertex, position)));
+		glVertexArrayAttribBinding(lineVertexArray, 0, 0);
+		glEnableVertexArrayAttrib(lineVertexArray, 1);
+		glVertexArrayAttribFormat(lineVertexArray, 1, 4, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(LineVertex, color)));
+		glVertexArrayAttribBinding(lineVertexArray, 1, 0);
+		s_RendererData.lineVertexArray = lineVertexArray;
+
+		s_RendererData.materialSlotCount = InitialMaterialSlots;
+		s_RendererData.materialBuffer = MakeUnique<StorageBuffer>(static_cast<u32>(sizeof(MaterialUniformData)) * InitialMaterialSlots, MaterialDataBinding);
+
+		s_RendererData.freeMaterialSlots.clear();
+		for (u32 slot = InitialMaterialSlots; slot > 0; slot--)
+			s_RendererData.freeMaterialSlots.push_back(slot - 1);
+
+		const PipelineLayout standardLayout = {
+			{ "a_Position",  VertexFormat::Float3, false },
+			{ "a_Normal",	 VertexFormat::Float3, false },
+			{ "a_Tangent",	 VertexFormat::Float3, false },
+			{ "a_Bitangent", VertexFormat::Float3, false },
+			{ "a_TexCoords", VertexFormat::Float2, false }
+		};
+		const PipelineLayout compactLayout = {
+			{ "a_Position",  VertexFormat::Short4,     true, 0 },
+			{ "a_Normal",    VertexFormat::Short2,     true, 1 },
+			{ "a_Tangent",   VertexFormat::Int1010102, true, 2 },
+			{ "a_TexCoords", VertexFormat::Half2,      false, 4 }
+		};
+
+		s_RendererData.geometryArena = MakeShared<GeometryArena>(standardLayout, 1u << 16, 3u << 16);
+		s_RendererData.compactGeometryArena = MakeShared<GeometryArena>(compactLayout, 1u << 16, 3u << 16);
+
+		s_RendererData.instanceCapacity = 0;
+		EnsureInstanceCapacity(InitialInstanceCapacity);
+
+		// Cold starts compile every program, warm starts load the binaries stored by the cold one
+		auto shaderStart = std::chrono::high_resolution_clock::now();
+		const ShaderCacheStatistics shaderStatistics = Shader::GetCacheStatistics();
+
 		s_RendererData.shaders["PBR"] = MakeShared<Shader>("Assets/Shaders/PBR.glsl");
 		s_RendererData.shaders["Skybox"] = MakeShared<Shader>("Assets/Shaders/Skybox.glsl");
 		s_RendererData.shaders["Grid"] = MakeShared<Shader>("Assets/Shaders/Grid.glsl");
 		s_RendererData.shaders["Outline"] = MakeShared<Shader>("Assets/Shaders/Outline.glsl");
 		s_RendererData.shaders["Composition"] = MakeShared<Shader>("Assets/Shaders/Composition.glsl");
+		s_RendererData.shaders["Line"] = MakeShared<Shader>("Assets/Shaders/Line.glsl");
+
+		const auto &cacheStatistics = Shader::GetCacheStatistics();
+		ME_INFO("Created %u shader programs in %.2f ms (%u from the program cache, %u compiled)",
+			cacheStatistics.programs - shaderStatistics.programs,
+			std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - shaderStart).count(),
+			cacheStatistics.cacheHits - shaderStatistics.cacheHits,
+			cacheStatistics.programs - shaderStatistics.programs - (cacheStatistics.cacheHits - shaderStatistics.cacheHits));
 	}
 	void Renderer::Shutdown()
 	{
 		ME_INFO("Shutting down Renderer");
+
+		s_RendererData.streamingBuffer.reset();
+		s_RendererData.materialBuffer.reset();
+		s_RendererData.instanceIndexBuffer = nullptr;
+		s_RendererData.geometryArena = nullptr;
+		s_RendererData.compactGeometryArena = nullptr;
+		s_RendererData.freeMaterialSlots.clear();
+		s_RendererData.materialSlotCount = 0;
+		s_RendererData.lines.clear();
+
+		if (s_RendererData.lineVertexArray)
+			glDeleteVertexArrays(1, &s_RendererData.lineVertexArray);
+		s_RendererData.lineVertexArray = 0;
+	}
+
+	void Renderer::BeginFrame()
+	{
+		// Streaming statistics cover a whole frame, including the wait at its start
+		s_RendererData.streamingBuffer->ResetStatistics();
+		s_RendererData.streamingBuffer->BeginFrame();
+	}
+	void Renderer::EndFrame()
+	{
+		s_RendererData.streamingBuffer->EndFrame();
 	}
 
 	SharedPtr<Shader> Renderer::GetShader(const std::string& name)
@@ -113,6 +438,80 @@ namespace Engine
 		return s_RendererData.shaders[name];
 	}
 
+	void Renderer::BeginScene(const glm::mat4 &projectionView, const glm::vec3 &cameraPosition, const Environment &environment)
+	{
+		ME_ASSERT(!s_RendererData.sceneActive);
+		s_RendererData.sceneActive = true;
+		s_RendererData.cameraPosition = cameraPosition;
+		s_RendererData.frustum = Math::ExtractFrustum(projectionView);
+
+		CameraUniformData camera = {};
+		camera.projectionView = projectionView;
+		camera.position = cameraPosition;
+
+		auto &streamingBuffer = *s_RendererData.streamingBuffer;
+		streamingBuffer.BindUniform(CameraUniformBinding, streamingBuffer.Write(&camera, sizeof(camera), s_RendererData.uniformAlignment));
+
+		// Scene only has a single directional light for now, the others stay inactive
+		LightUniformData lights = {};
+		auto &directionalLight = environment.directionalLight;
+		lights.directionalLights[0].direction = directionalLight.direction;
+		lights.directionalLights[0].multiplier = directionalLight.intensity;
+		lights.directionalLights[0].radiance = directionalLight.radiance;
+		lights.directionalLights[0].active = directionalLight.active;
+
+		streamingBuffer.BindUniform(LightUniformBinding, streamingBuffer.Write(&lights, sizeof(lights), s_RendererData.uniformAlignment));
+
+		// Texture units match the sampler bindings in PBR.glsl
+		environment.brdflutTexture->Bind(5);
+		environment.radianceMap->Bind(6);
+		environment.irradianceMap->Bind(7);
+	}
+	void Renderer::EndScene()
+	{
+		ME_ASSERT(s_RendererData.sceneActive);
+
+		FlushDrawPackets();
+		FlushLines();
+		s_RendererData.sceneActive = false;
+	}
+
+	void Renderer::SetMultiDrawIndirect(bool enable)
+	{
+		s_RendererData.multiDrawIndirect = enable;
+	}
+	bool Renderer::IsMultiDrawIndirectEnabled()
+	{
+		return s_RendererData.multiDrawIndirect;
+	}
+
+	void Renderer::SetFrustumCulling(bool enable)
+	{
+		s_RendererData.frustumCulling = enable;
+	}
+	bool Renderer::IsFrustumCullingEnabled()
+	{
+		return s_RendererData.frustumCulling;
+	}
+
+	SharedPtr<GeometryArena> Renderer::GetGeometryArena(bool compactVertices)
+	{
+		return compactVertices ? s_RendererData.compactGeometryArena : s_RendererData.geometryArena;
+	}
+
+	void Renderer::ResetStatistics()
+	{
+		s_RendererData.statistics = RendererStatistics();
+	}
+	const RendererStatistics &Renderer::GetStatistics()
+	{
+		return s_RendererData.statistics;
+	}
+	const StreamingBufferStatistics &Renderer::GetStreamingStatistics()
+	{
+		return s_RendererData.streamingBuffer->GetStatistics();
+	}
+
 	void Renderer::Clear()
 	{
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -143,62 +542,86 @@ namespace Engine
 
 	void Renderer::SubmitLine(const glm::vec3 &from, const glm::vec3 &to, const glm::vec4 color, float thickness)
 	{
-		ME_ASSERT(false);	// Not implemented
+		ME_ASSERT(s_RendererData.sceneActive);
+
+		s_RendererData.lines.push_back({ from, to, color, thickness });
 	}
 
 	void Renderer::SubmitMesh(const SharedPtr<Mesh> &mesh, const glm::mat4 &transform)
 	{
-		auto &pipeline = mesh->m_Pipeline;
-		auto &shader = mesh->m_Shader;
-
-		shader->Bind();
-		pipeline.Bind();
-
-		for (auto &subMesh : mesh->m_SubMeshes)
-		{
-			auto &material = mesh->m_Materials[subMesh.materialIndex];
-			auto &params = material.GetParameters();
-			auto &textures = material.GetTextures();
-
-			shader->SetUniformMatrix4("u_Transform", transform * subMesh.transform);
+		ME_ASSERT(s_RendererData.sceneActive);
 
-			shader->SetUniformInt("u_EnableAlbedoTexture", textures.useAlbedo);
-			shader->SetUniformInt("u_EnableNormalMapTexture", textures.useNormal);
-			shader->SetUniformInt("u_EnableMetalnessTexture", textures.useMetalness);
-			shader->SetUniformInt("u_EnableRoughnessTexture", textures.useRoughness);
+		if (!mesh->m_GeometryArena)
+			return;
 
-			shader->SetUniformInt("u_AlbedoTexture", 0);
-			shader->SetUniformInt("u_NormalMapTexture", 1);
-			shader->SetUniformInt("u_MetalnessTexture", 2);
-			shader->SetUniformInt("u_RoughnessTexture", 3);
+		auto &data = s_RendererData;
+		const auto &pipeline = mesh->m_GeometryArena->GetPipeline();
+		const auto &shader = mesh->m_Shader;
+		const auto &geometry = mesh->m_Geometry;
 
-			if (textures.albedo->IsLoaded())    textures.albedo->Bind(0);
-			if (textures.normal->IsLoaded())    textures.normal->Bind(1);
-			if (textures.metalness->IsLoaded())	textures.metalness->Bind(2);
-			if (textures.roughness->IsLoaded())	textures.roughness->Bind(3);
+		// Reject the whole mesh first, sub meshes are tested in batches when flushing
+		if (data.frustumCulling && !Math::IsSphereVisible(data.frustum, Math::TransformSphere(mesh->m_BoundingSphere, transform)))
+		{
+			data.statistics.culledSubMeshes += static_cast<u32>(mesh->m_SubMeshes.size());
+			return;
+		}
 
-			shader->SetUniformFloat3("u_AlbedoColor", params.albedo);
-			shader->SetUniformFloat("u_Metalness", params.metalness);
-			shader->SetUniformFloat("u_Roughness", params.roughness);
+		for (u32 i = 0; i < mesh->m_SubMeshes.size(); i++)
+		{
+			auto &subMesh = mesh->m_SubMeshes[i];
+			auto &material = mesh->m_Materials[subMesh.materialIndex];
 
-			glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.indexCount, GL_UNSIGNED_INT,
-				(const void *) (sizeof(u32) * subMesh.indexOffset), subMesh.vertexOffset);
+			// Assigns the uniform slot and the shader variant the key is built from
+			PrepareMaterial(material);
+			Shader *variant = ResolveShaderVariant(material, *shader, mesh->m_ImportSettings.compactVertices);
+
+			DrawPacket packet;
+			packet.pipeline = &pipeline;
+			packet.shader = variant;
+			packet.material = &material;
+			packet.subMesh = &subMesh;
+			packet.subMeshIndex = i;
+			packet.transform = transform * subMesh.transform;
+			packet.firstIndex = geometry.indexOffset + subMesh.indexOffset;
+			packet.baseVertex = static_cast<int>(geometry.vertexOffset + subMesh.vertexOffset);
+
+			const AABB bounds = Math::TransformAABB(subMesh.boundingBox, packet.transform);
+			const float depth = glm::distance(bounds.GetCenter(), data.cameraPosition);
+
+			DrawKey drawKey;
+			drawKey.key = CreateDrawKey(material.HasFlag(MaterialFlag::Transparent), variant->GetRendererID(),
+				material.m_UniformSlot, pipeline.m_VertexArrayRendererID, i, depth);
+			drawKey.packetIndex = static_cast<u32>(data.drawPackets.size());
+
+			data.drawPackets.push_back(packet);
+			data.drawKeys.push_back(drawKey);
+			data.packetBounds.Add(bounds);
 		}
 	}
 
 	void Renderer::SubmitMeshWithShader(const SharedPtr<Mesh>& mesh, const glm::mat4& transform, const SharedPtr<Shader>& shader)
 	{
-		auto& pipeline = mesh->m_Pipeline;
+		if (!mesh->m_GeometryArena)
+			return;
+
+		const auto& pipeline = mesh->m_GeometryArena->GetPipeline();
+		const auto& geometry = mesh->m_Geometry;
 
 		shader->Bind();
 		pipeline.Bind();
 
+		const int transformLocation = shader->GetUniformLocation("u_Transform");
+		const int dequantizationScaleLocation = shader->GetUniformLocation("u_DequantizationScale");
+		const int dequantizationOffsetLocation = shader->GetUniformLocation("u_DequantizationOffset");
+
 		for (auto& subMesh : mesh->m_SubMeshes)
 		{
-			shader->SetUniformMatrix4("u_Transform", transform * subMesh.transform);
+			shader->SetUniformMatrix4(transformLocation, transform * subMesh.transform);
+			shader->SetUniformFloat3(dequantizationScaleLocation, subMesh.dequantizationScale);
+			shader->SetUniformFloat3(dequantizationOffsetLocation, subMesh.dequantizationOffset);
 
 			glDrawElementsBaseVertex(GL_TRIANGLES, subMesh.indexCount, GL_UNSIGNED_INT,
-				(const void*)(sizeof(u32) * subMesh.indexOffset), subMesh.vertexOffset);
+				(const void*)(sizeof(u32) * (geometry.indexOffset + subMesh.indexOffset)), geometry.vertexOffset + subMesh.vertexOffset);
 		}
 	}
 
@@ -218,4 +641,294 @@ namespace Engine
 		glDrawElements(GL_TRIANGLES, pipeline.indexBuffer->GetCount(),
 			pipeline.indexBuffer->GetType(), nullptr);
 	}
+
+	void Renderer::ReleaseMaterialUniformSlot(u32 slot)
+	{
+		// Materials can outlive the renderer (e.g. meshes held by a static)
+		if (!s_RendererData.materialBuffer || slot >= s_RendererData.materialSlotCount)
+			return;
+
+		s_RendererData.freeMaterialSlots.push_back(slot);
+	}
+
+	void Renderer::PrepareMaterial(Material &material)
+	{
+		auto &data = s_RendererData;
+
+		if (material.m_UniformSlot == Material::InvalidUniformSlot)
+		{
+			if (data.freeMaterialSlots.empty())
+			{
+				const u32 slotCount = data.materialSlotCount * 2;
+				data.materialBuffer->Resize(static_cast<u32>(sizeof(MaterialUniformData)) * slotCount);
+
+				for (u32 slot = slotCount; slot > data.materialSlotCount; slot--)
+					data.freeMaterialSlots.push_back(slot - 1);
+				data.materialSlotCount = slotCount;
+			}
+
+			material.m_UniformSlot = data.freeMaterialSlots.back();
+			data.freeMaterialSlots.pop_back();
+
+			// Fresh slot, make sure the current values end up in it
+			material.m_UniformDataValid = false;
+		}
+
+		if (material.UpdateUniformData())
+		{
+			data.materialBuffer->SetData(&material.GetUniformData(), sizeof(MaterialUniformData),
+				material.m_UniformSlot * static_cast<u32>(sizeof(MaterialUniformData)));
+		}
+	}
+
+	Shader *Renderer::ResolveShaderVariant(Material &material, Shader &shader, bool compactVertices)
+	{
+		const u32 key = material.GetShaderFeatures() | (compactVertices ? CompactVerticesVariant : 0);
+		if (material.m_ShaderVariant && material.m_VariantBaseShader == &shader && material.m_VariantKey == key)
+			return material.m_ShaderVariant;
+
+		std::vector<std::string> defines;
+		for (u32 bit = 0; bit < static_cast<u32>(std::size(s_VariantDefines)); bit++)
+		{
+			if (key & (1u << bit))
+				defines.push_back(s_VariantDefines[bit]);
+		}
+
+		material.m_ShaderVariant = shader.GetVariant(defines);
+		material.m_VariantBaseShader = &shader;
+		material.m_VariantKey = key;
+
+		return material.m_ShaderVariant;
+	}
+
+	void Renderer::FlushDrawPackets()
+	{
+		auto &data = s_RendererData;
+		auto &stats = data.statistics;
+
+		if (data.frustumCulling)
+		{
+			auto cullStart = std::chrono::high_resolution_clock::now();
+
+			// Boxes are independent, so each thread culls its own range into the shared array
+			const u32 packetCount = data.packetBounds.GetCount();
+			data.packetVisibility.resize(packetCount);
+			JobSystem::ParallelFor(packetCount, CullBatchSize, [&data](u32 begin, u32 end)
+				{
+					Math::CullAABBs(data.frustum, data.packetBounds, begin, end, data.packetVisibility.data());
+				});
+
+			const auto visibility = data.packetVisibility.data();
+			auto visibleEnd = std::remove_if(data.drawKeys.begin(), data.drawKeys.end(),
+				[visibility](const DrawKey &drawKey) { return visibility[drawKey.packetIndex] == 0; });
+
+			stats.culledSubMeshes += static_cast<u32>(data.drawKeys.end() - visibleEnd);
+			data.drawKeys.erase(visibleEnd, data.drawKeys.end());
+
+			auto cullEnd = std::chrono::high_resolution_clock::now();
+			stats.cullTime += std::chrono::duration<float, std::milli>(cullEnd - cullStart).count();
+		}
+		stats.visibleSubMeshes += static_cast<u32>(data.drawKeys.size());
+		data.packetBounds.Clear();
+
+		auto sortStart = std::chrono::high_resolution_clock::now();
+		std::sort(data.drawKeys.begin(), data.drawKeys.end());
+		auto sortEnd = std::chrono::high_resolution_clock::now();
+		stats.sortTime += std::chrono::duration<float, std::milli>(sortEnd - sortStart).count();
+
+		if (data.drawKeys.empty())
+		{
+			data.drawPackets.clear();
+			return;
+		}
+
+		const u32 keyCount = static_cast<u32>(data.drawKeys.size());
+		EnsureInstanceCapacity(keyCount);
+
+		// Instance data in sorted order, each run of identical packets becomes one command
+		data.instanceData.resize(keyCount);
+		data.drawCommands.clear();
+		data.drawCommandPackets.clear();
+
+		for (u32 first = 0, last = 0; first < keyCount; first = last)
+		{
+			const auto &packet = data.drawPackets[data.drawKeys[first].packetIndex];
+
+			last = first + 1;
+			while (last < keyCount && CanInstance(packet, data.drawPackets[data.drawKeys[last].packetIndex]))
+				last++;
+
+			// Material may have been edited since it was submitted
+			PrepareMaterial(*packet.material);
+
+			for (u32 i = first; i < last; i++)
+			{
+				const auto &instancePacket = data.drawPackets[data.drawKeys[i].packetIndex];
+
+				auto &instance = data.instanceData[i];
+				instance.transform = instancePacket.transform;
+				instance.dequantizationScale = instancePacket.subMesh->dequantizationScale;
+				instance.dequantizationOffset = instancePacket.subMesh->dequantizationOffset;
+				instance.materialIndex = instancePacket.material->m_UniformSlot;
+				instance.padding = 0;
+			}
+
+			DrawElementsIndirectCommand command;
+			command.count = packet.subMesh->indexCount;
+			command.instanceCount = last - first;
+			command.firstIndex = packet.firstIndex;
+			command.baseVertex = packet.baseVertex;
+			command.baseInstance = first;
+
+			data.drawCommands.push_back(command);
+			data.drawCommandPackets.push_back(first);
+		}
+
+		auto &streamingBuffer = *data.streamingBuffer;
+
+		const u32 instanceDataSize = keyCount * static_cast<u32>(sizeof(InstanceData));
+		streamingBuffer.BindStorage(InstanceDataBinding, streamingBuffer.Write(data.instanceData.data(), instanceDataSize, data.storageAlignment));
+
+		// Bound after PrepareMaterial, which may have grown the buffer
+		data.materialBuffer->Bind();
+
+		const u32 commandCount = static_cast<u32>(data.drawCommands.size());
+		u32 indirectOffset = 0;
+		if (data.multiDrawIndirect)
+		{
+			const u32 commandDataSize = commandCount * static_cast<u32>(sizeof(DrawElementsIndirectCommand));
+			indirectOffset = streamingBuffer.Write(data.drawCommands.data(), commandDataSize, 4).offset;
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, streamingBuffer.GetRendererID());
+		}
+
+		const Shader *boundShader = nullptr;
+		const GraphicsPipeline *boundPipeline = nullptr;
+		RendererID boundTextures[MaterialTextureUnits] = { 0, 0, 0, 0 };
+		bool blending = false;
+
+		for (u32 first = 0, last = 0; first < commandCount; first = last)
+		{
+			const auto &packet = data.drawPackets[data.drawKeys[data.drawCommandPackets[first]].packetIndex];
+			const bool transparent = packet.material->HasFlag(MaterialFlag::Transparent);
+
+			RendererID textures[MaterialTextureUnits];
+			GetRequiredTextures(*packet.material, textures);
+
+			// Extend the batch while shader, vertex array, blending and textures allow it
+			last = first + 1;
+			while (data.multiDrawIndirect && last < commandCount)
+			{
+				const auto &next = data.drawPackets[data.drawKeys[data.drawCommandPackets[last]].packetIndex];
+				if (next.shader != packet.shader || next.pipeline != packet.pipeline ||
+					next.material->HasFlag(MaterialFlag::Transparent) != transparent)
+					break;
+
+				RendererID nextTextures[MaterialTextureUnits];
+				GetRequiredTextures(*next.material, nextTextures);
+				if (!MergeTextures(textures, nextTextures))
+					break;
+
+				last++;
+			}
+
+			// Transparent keys sort last, so blending is switched on exactly once
+			if (!blending && transparent)
+			{
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glDepthMask(GL_FALSE);
+				blending = true;
+			}
+
+			if (packet.shader != boundShader)
+			{
+				packet.shader->Bind();
+				boundShader = packet.shader;
+				stats.shaderBinds++;
+			}
+
+			if (packet.pipeline != boundPipeline)
+			{
+				packet.pipeline->Bind();
+				boundPipeline = packet.pipeline;
+				stats.pipelineBinds++;
+			}
+
+			for (u32 unit = 0; unit < MaterialTextureUnits; unit++)
+			{
+				if (!textures[unit] || textures[unit] == boundTextures[unit])
+					continue;
+
+				glBindTextureUnit(unit, textures[unit]);
+				boundTextures[unit] = textures[unit];
+				stats.textureBinds++;
+			}
+
+			if (data.multiDrawIndirect)
+			{
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+					(const void *) (indirectOffset + sizeof(DrawElementsIndirectCommand) * first), last - first, 0);
+				stats.indirectCommands += last - first;
+			}
+			else
+			{
+				const auto &command = data.drawCommands[first];
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+					(const void *) (sizeof(u32) * command.firstIndex), command.instanceCount, command.baseVertex, command.baseInstance);
+			}
+			stats.drawCalls++;
+
+			for (u32 i = first; i < last; i++)
+				stats.instances += data.drawCommands[i].instanceCount;
+		}
+
+		if (blending)
+		{
+			glDepthMask(GL_TRUE);
+			glDisable(GL_BLEND);
+		}
+
+		data.drawPackets.clear();
+		data.drawKeys.clear();
+	}
+
+	void Renderer::FlushLines()
+	{
+		auto &data = s_RendererData;
+		if (data.lines.empty())
+			return;
+
+		const u32 lineCount = static_cast<u32>(data.lines.size());
+		auto allocation = data.streamingBuffer->Allocate(lineCount * 2 * static_cast<u32>(sizeof(LineVertex)));
+
+		auto vertices = static_cast<LineVertex *>(allocation.data);
+		for (u32 i = 0; i < lineCount; i++)
+		{
+			const auto &line = data.lines[i];
+			vertices[i * 2 + 0] = { line.from, line.color };
+			vertices[i * 2 + 1] = { line.to, line.color };
+		}
+
+		glVertexArrayVertexBuffer(data.lineVertexArray, 0, data.streamingBuffer->GetRendererID(), allocation.offset, sizeof(LineVertex));
+		glBindVertexArray(data.lineVertexArray);
+		data.shaders["Line"]->Bind();
+
+		GLfloat lineWidth;
+		glGetFloatv(GL_LINE_WIDTH, &lineWidth);
+
+		// One draw per run of equal thickness
+		for (u32 first = 0, last = 0; first < lineCount; first = last)
+		{
+			last = first + 1;
+			while (last < lineCount && data.lines[last].thickness == data.lines[first].thickness)
+				last++;
+
+			glLineWidth(data.lines[first].thickness);
+			glDrawArrays(GL_LINES, static_cast<GLint>(first * 2), static_cast<GLsizei>((last - first) * 2));
+			data.statistics.drawCalls++;
+		}
+
+		glLineWidth(lineWidth);
+		data.lines.clear();
+	}
 }
\ No newline at end of file
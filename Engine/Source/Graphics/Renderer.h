@@ -9,7 +9,28 @@ namespace Engine
 	class GraphicsPipeline;
 	class Shader;
 	class Mesh;
+	class Material;
+	class GeometryArena;
 	class TextureCube;
+	struct Environment;
+	struct StreamingBufferStatistics;
+
+	struct RendererStatistics
+	{
+		u32 drawCalls = 0;
+		u32 instances = 0;			// Sub mesh instances covered by those draw calls
+		u32 indirectCommands = 0;	// Commands issued through multi draw indirect
+		u32 shaderBinds = 0;
+		u32 pipelineBinds = 0;
+		u32 textureBinds = 0;
+		float sortTime = 0.0f;	// ms
+
+		u32 visibleSubMeshes = 0;
+		u32 culledSubMeshes = 0;
+		float cullTime = 0.0f;	// ms
+
+		u32 GetStateChanges() const { return shaderBinds + pipelineBinds + textureBinds; }
+	};
 
 	class Renderer
 	{
@@ -17,8 +38,31 @@ namespace Engine
 		static void Initialize();
 		static void Shutdown();
 
+		// Frame boundaries of the streaming buffer, regions are reused FrameCount frames later
+		static void BeginFrame();
+		static void EndFrame();
+
 		static SharedPtr<Shader> GetShader(const std::string &name);
 
+		// Uploads the per frame camera and light uniform blocks and binds the IBL textures
+		static void BeginScene(const glm::mat4 &projectionView, const glm::vec3 &cameraPosition, const Environment &environment);
+		// Sorts and draws everything queued with SubmitMesh since BeginScene
+		static void EndScene();
+
+		// Draws every batch of compatible instanced runs with one glMultiDrawElementsIndirect
+		static void SetMultiDrawIndirect(bool enable);
+		static bool IsMultiDrawIndirectEnabled();
+
+		// Tests submitted meshes and sub meshes against the BeginScene frustum
+		static void SetFrustumCulling(bool enable);
+		static bool IsFrustumCullingEnabled();
+
+		static SharedPtr<GeometryArena> GetGeometryArena(bool compactVertices);
+
+		static void ResetStatistics();
+		static const RendererStatistics &GetStatistics();
+		static const StreamingBufferStatistics &GetStreamingStatistics();
+
 		static void Clear();
 	 	static void SetClearColor(const glm::vec4 &clearColor);
 
@@ -26,13 +70,24 @@ namespace Engine
 		static void SetLineThickness(float thickness);
 
 		static void SubmitQuad(const SharedPtr<Shader> &shader);
+		// Lines are drawn with the meshes at EndScene
 		static void SubmitLine(const glm::vec3 &from, const glm::vec3 &to, const glm::vec4 color = glm::vec4(0.0f), float thickness = 1.0f);
 
+		// Queues a draw packet per sub mesh, the mesh has to stay alive until EndScene
 		static void SubmitMesh(const SharedPtr<Mesh> &mesh, const glm::mat4 &transform);
 		static void SubmitMeshWithShader(const SharedPtr<Mesh>& mesh, const glm::mat4& transform, const SharedPtr<Shader>& shader);
 
 		static void SubmitSkybox(const SharedPtr<TextureCube> &skybox, const SharedPtr<Shader> &shader);
 
 		static void SubmitPipeline(const GraphicsPipeline &pipeline);
+
+		static void ReleaseMaterialUniformSlot(u32 slot);
+
+	private:
+		static void PrepareMaterial(Material &material);
+		// Variant of the mesh shader for the material's textures and the vertex format
+		static Shader *ResolveShaderVariant(Material &material, Shader &shader, bool compactVertices);
+		static void FlushDrawPackets();
+		static void FlushLines();
 	};
 }
\ No newline at end of file
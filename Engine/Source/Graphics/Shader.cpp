@@ -1,56 +1,100 @@
 #include "Precompiled.h"
 #include "Shader.h"
 
-#include <fstream>
+#include "ShaderSerializer.h"
+#include "Util/Hash.h"
+
 #include <string>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
 
 #include <glad/glad.h>
 
 
 namespace Engine
 {
+    static bool s_ProgramCache = true;
+    static ShaderCacheStatistics s_CacheStatistics;
+
+    // Shaders loaded from source, variants are reloaded through their base shader
+    static std::vector<Shader *> s_LoadedShaders;
+
+    static std::string CanonicalPath(const std::string &filepath)
+    {
+        std::error_code error;
+        std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+        return error ? filepath : canonicalPath.generic_string();
+    }
+
     Shader::Shader(const std::string &filepath)
     {
         LoadFromFile(filepath);
     }
     Shader::~Shader()
     {
+        auto it = std::find(s_LoadedShaders.begin(), s_LoadedShaders.end(), this);
+        if (it != s_LoadedShaders.end())
+            s_LoadedShaders.erase(it);
     }
 
-    void Shader::LoadFromFile(const std::string & filepath)
+    void Shader::SetProgramCache(bool enabled)
     {
-        ME_TRACE("Loading Shader: %s", filepath.c_str());
+        s_ProgramCache = enabled;
+    }
+    bool Shader::IsProgramCacheEnabled()
+    {
+        return s_ProgramCache;
+    }
+
+    const ShaderCacheStatistics &Shader::GetCacheStatistics()
+    {
+        return s_CacheStatistics;
+    }
+    void Shader::ResetCacheStatistics()
+    {
+        s_CacheStatistics = ShaderCacheStatistics();
+    }
 
-        std::ifstream stream(filepath);
+    u32 Shader::ReloadDependents(const std::string &filepath)
+    {
+        const std::string changedPath = CanonicalPath(filepath);
 
-        enum class ShaderType
+        u32 reloaded = 0;
+        for (auto shader : s_LoadedShaders)
         {
-            None = -1, Vertex = 0, Fragment
-        };
+            auto &files = shader->m_SourceFiles;
+            bool dependent = std::any_of(files.begin(), files.end(), [&](const ShaderSourceFile &file)
+                {
+                    return CanonicalPath(file.filepath) == changedPath;
+                });
+
+            if (dependent && shader->Reload())
+                reloaded++;
+        }
+        return reloaded;
+    }
 
-        std::string line;
-        std::stringstream ss[2];
-        ShaderType type = ShaderType::None;
+    void Shader::LoadFromFile(const std::string & filepath)
+    {
+        ME_TRACE("Loading Shader: %s", filepath.c_str());
 
-        while (std::getline(stream, line))
+        ShaderSource source;
+        if (!ShaderPreprocessor::Process(filepath, source))
         {
-            if (line.find("#shader") != std::string::npos)
-            {
-                if (line.find("vertex") != std::string::npos) 
-                    type = ShaderType::Vertex;
-                else if (line.find("fragment") != std::string::npos)
-                    type = ShaderType::Fragment;
-            }
-            else
-            {
-                ss[(int) type] << line << "\n";
-            }
+            ME_ASSERT(false);
+            return;
         }
 
-        std::string vertexSource = ss[(int) ShaderType::Vertex].str();
-        std::string fragmentSource = ss[(int) ShaderType::Fragment].str();
+        m_Filepath = filepath;
+        m_Stages = std::move(source.stages);
+        m_SourceFiles = std::move(source.files);
+
+        m_RendererID = CreateProgram(m_Stages);
 
-        m_RendererID = CreateShader(vertexSource, fragmentSource);
+        if (std::find(s_LoadedShaders.begin(), s_LoadedShaders.end(), this) == s_LoadedShaders.end())
+            s_LoadedShaders.push_back(this);
     }
     void Shader::LoadFromFiles(const std::string &vertexPath, const std::string &fragmentPath)
     {
@@ -62,53 +106,227 @@ namespace Engine
         glUseProgram(m_RendererID);
     }
 
+    bool Shader::Reload()
+    {
+        ME_ASSERT(!m_Stages.empty());   // Only shaders loaded from source can be reloaded
+
+        ME_INFO("Reloading Shader: %s", m_Filepath.c_str());
+
+        ShaderSource source;
+        if (!ShaderPreprocessor::Process(m_Filepath, source, m_DefaultStageType))
+        {
+            ME_ERROR("Failed to reload Shader, keeping the previous program: %s", m_Filepath.c_str());
+            return false;
+        }
+
+        // Link everything before replacing anything, so the shader and its variants
+        // never end up built from different versions of the sources
+        std::vector<std::pair<Shader *, RendererID>> programs;
+        programs.push_back({ this, LinkProgram(source.stages, source.files) });
+
+        for (auto &[key, variant] : m_Variants)
+        {
+            std::vector<ShaderStage> stages = source.stages;
+            for (auto &stage : stages)
+                stage.source = ShaderPreprocessor::InjectDefines(stage.source, variant->m_Defines);
+
+            programs.push_back({ variant.get(), LinkProgram(stages, source.files) });
+        }
+
+        bool linked = std::all_of(programs.begin(), programs.end(), [](auto &program) { return program.second != 0; });
+        if (!linked)
+        {
+            for (auto &[shader, program] : programs)
+            {
+                if (program)
+                    glDeleteProgram(program);
+            }
+
+            ME_ERROR("Failed to reload Shader, keeping the previous program: %s", m_Filepath.c_str());
+            return false;
+        }
+
+        // Handles stay valid, only the GL programs behind them are swapped
+        for (auto &[shader, program] : programs)
+        {
+            glDeleteProgram(shader->m_RendererID);
+            shader->m_RendererID = program;
+            shader->m_SourceFiles = source.files;
+            shader->ReflectUniforms();
+        }
+        m_Stages = std::move(source.stages);
+
+        return true;
+    }
+
+    Shader *Shader::GetVariant(const std::vector<std::string> &defines)
+    {
+        ME_ASSERT(!m_Stages.empty());   // Only shaders loaded from source have variants
+
+        u64 key = Hash::FNV1aOffsetBasis;
+        for (auto &define : defines)
+            key = Hash::FNV1a(define + "\n", key);
+
+        auto it = m_Variants.find(key);
+        if (it != m_Variants.end())
+            return it->second.get();
+
+        std::string defineList;
+        for (auto &define : defines)
+            defineList += (defineList.empty() ? "" : ", ") + define;
+        ME_TRACE("Compiling Shader variant: %s [%s]", m_Filepath.c_str(), defineList.c_str());
+
+        std::vector<ShaderStage> stages = m_Stages;
+        for (auto &stage : stages)
+            stage.source = ShaderPreprocessor::InjectDefines(stage.source, defines);
+
+        auto variant = MakeUnique<Shader>();
+        variant->m_Filepath = m_Filepath;
+        variant->m_SourceFiles = m_SourceFiles;
+        variant->m_Defines = defines;
+        variant->CreateProgram(stages);
+
+        Shader *result = variant.get();
+        m_Variants[key] = std::move(variant);
+        return result;
+    }
+
     void Shader::SetUniformMatrix4(const char *name, const glm::mat4 &matrix)
     {
-        glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]);
+        SetUniformMatrix4(GetUniformLocation(name), matrix);
     }
     void Shader::SetUniformFloat(const char *name, float value)
     {
-        glUniform1f(GetUniformLocation(name), value);
+        SetUniformFloat(GetUniformLocation(name), value);
     }
     void Shader::SetUniformFloat3(const char *name, const glm::vec3 &values)
     {
-        glUniform3f(GetUniformLocation(name), values.x, values.y, values.z);
+        SetUniformFloat3(GetUniformLocation(name), values);
     }
 
     void Shader::SetUniformInt(const char *name, int value)
     {
-        glUniform1i(GetUniformLocation(name), value);
+        SetUniformInt(GetUniformLocation(name), value);
+    }
+
+    void Shader::SetUniformMatrix4(int location, const glm::mat4 &matrix)
+    {
+        if (UpdateUniformCache(location, &matrix, sizeof(matrix)))
+            glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
+    }
+    void Shader::SetUniformFloat(int location, float value)
+    {
+        if (UpdateUniformCache(location, &value, sizeof(value)))
+            glUniform1f(location, value);
+    }
+    void Shader::SetUniformFloat3(int location, const glm::vec3 &values)
+    {
+        if (UpdateUniformCache(location, &values, sizeof(values)))
+            glUniform3f(location, values.x, values.y, values.z);
+    }
+
+    void Shader::SetUniformInt(int location, int value)
+    {
+        if (UpdateUniformCache(location, &value, sizeof(value)))
+            glUniform1i(location, value);
     }
 
     u32 Shader::CreateShader(const std::string &vertexShader, const std::string &fragmentShader)
     {
+        return CreateProgram({ { GL_VERTEX_SHADER, vertexShader }, { GL_FRAGMENT_SHADER, fragmentShader } });
+    }
+    u32 Shader::CreateProgram(const std::vector<ShaderStage> &stages)
+    {
+        u32 shaderProgram = LinkProgram(stages, m_SourceFiles);
+        ME_ASSERT(shaderProgram);
+
+        m_RendererID = shaderProgram;
+        ReflectUniforms();
+
+        return shaderProgram;
+    }
+    RendererID Shader::LinkProgram(const std::vector<ShaderStage> &stages, const std::vector<ShaderSourceFile> &files)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
         u32 shaderProgram = glCreateProgram();
-        std::string errorLog;
+        s_CacheStatistics.programs++;
+
+        const bool useCache = s_ProgramCache && ShaderSerializer::IsSupported();
+        const u64 sourceHash = useCache ? ShaderSerializer::CalculateSourceHash(stages) : 0;
+        const std::string cachePath = useCache ? ShaderSerializer::GetCachePath(sourceHash) : std::string();
 
-        u32 vertexProgram = TryCompileShader(GL_VERTEX_SHADER, vertexShader, errorLog);
-        if (!vertexProgram)
+        if (useCache && ShaderSerializer::Deserialize(shaderProgram, cachePath, sourceHash))
         {
-            ME_ERROR("%s", errorLog.c_str());
-            ME_ASSERT(false);
+            s_CacheStatistics.cacheHits++;
+            s_CacheStatistics.loadTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return shaderProgram;
         }
 
-        errorLog.clear();
+        // A rejected binary leaves the program unlinked, it's simply linked again from source
+        if (useCache)
+        {
+            std::error_code error;
+            if (std::filesystem::exists(cachePath, error))
+                s_CacheStatistics.rejectedBinaries++;
+            s_CacheStatistics.cacheMisses++;
+        }
 
-        u32 fragmentProgram = TryCompileShader(GL_FRAGMENT_SHADER, fragmentShader, errorLog);
-        if (!fragmentProgram)
+        bool compiled = true;
+        std::vector<u32> shaders;
+        for (auto &stage : stages)
         {
-            ME_ERROR("%s", errorLog.c_str());
-            ME_ASSERT(false);
+            std::string errorLog;
+            u32 shader = TryCompileShader(stage.type, stage.source, errorLog);
+            if (!shader)
+            {
+                ME_ERROR("%s", ShaderPreprocessor::ResolveErrorLog(errorLog, files).c_str());
+                compiled = false;
+                continue;
+            }
+
+            glAttachShader(shaderProgram, shader);
+            shaders.push_back(shader);
+        }
+
+        int linked = 0;
+        if (compiled)
+        {
+            if (useCache)
+                glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+            glLinkProgram(shaderProgram);
+            glValidateProgram(shaderProgram);
+            glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linked);
+        }
+
+        for (auto shader : shaders)
+        {
+            glDetachShader(shaderProgram, shader);
+            glDeleteShader(shader);
+        }
+
+        if (compiled && !linked)
+        {
+            int errorLength;
+            glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &errorLength);
+
+            std::vector<char> message(static_cast<std::size_t>(errorLength) + 1);
+            glGetProgramInfoLog(shaderProgram, errorLength, &errorLength, message.data());
+
+            ME_ERROR("Failed to link shader program: %s", ShaderPreprocessor::ResolveErrorLog(message.data(), files).c_str());
         }
 
-        glAttachShader(shaderProgram, vertexProgram);
-        glAttachShader(shaderProgram, fragmentProgram);
+        s_CacheStatistics.compileTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 
-        glLinkProgram(shaderProgram);
-        glValidateProgram(shaderProgram);
+        if (!linked)
+        {
+            glDeleteProgram(shaderProgram);
+            return 0;
+        }
 
-        glDeleteShader(vertexProgram);
-        glDeleteShader(fragmentProgram);
+        if (useCache)
+            ShaderSerializer::Serialize(shaderProgram, cachePath, sourceHash);
 
         return shaderProgram;
     }
@@ -131,7 +349,7 @@ namespace Engine
             char *message = new char[errorLength * sizeof(char)];
             glGetShaderInfoLog(shaderID, errorLength, &errorLength, message);
 
-            errorLog = "Failed to compile shader" + std::string(message);
+            errorLog = "Failed to compile shader:\n" + std::string(message);
 
             glDeleteShader(shaderType);
             delete[] message;
@@ -140,39 +358,99 @@ namespace Engine
         return shaderID;
     }
 
-    int Shader::GetUniformLocation(const std::string& name)
+    int Shader::GetUniformLocation(const char *name) const
     {
-        int loc = glGetUniformLocation(m_RendererID, name.c_str());
-        if (loc == -1){
-            //ME_WARN("Uniform %s not found", name.c_str());
+        auto it = m_UniformLocations.find(Hash::FNV1a(name, std::strlen(name)));
+        if (it == m_UniformLocations.end())
+        {
+            //ME_WARN("Uniform %s not found", name);
             //ME_BREAKDEBUGGER;
+            return -1;
         }
-        return loc;
+        return it->second;
     }
 
-    ComputeShader::ComputeShader(const std::string& filepath)
+    void Shader::ReflectUniforms()
     {
-        std::ifstream is(filepath);
-        std::stringstream ss;
-        ss << is.rdbuf();
-        std::string shaderSource = ss.str();
+        m_UniformLocations.clear();
+        m_UniformValues.clear();
+
+        int uniformCount = 0, maxNameLength = 0;
+        glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::vector<char> nameBuffer(static_cast<std::size_t>(maxNameLength) + 1);
 
-        m_RendererID = glCreateProgram();
+        auto AddUniform = [this](const std::string &name, int location)
+        {
+            if (location < 0)
+                return;
+
+            m_UniformLocations[Hash::FNV1a(name)] = location;
+            if (static_cast<std::size_t>(location) >= m_UniformValues.size())
+                m_UniformValues.resize(static_cast<std::size_t>(location) + 1);
+        };
 
-        std::string errorLog;
+        for (int i = 0; i < uniformCount; i++)
+        {
+            int length = 0, size = 0;
+            GLenum type;
+            glGetActiveUniform(m_RendererID, static_cast<GLuint>(i), maxNameLength, &length, &size, &type, nameBuffer.data());
+
+            // Members of uniform blocks have no location
+            std::string name(nameBuffer.data(), static_cast<std::size_t>(length));
+            int location = glGetUniformLocation(m_RendererID, name.c_str());
+            AddUniform(name, location);
+
+            // Arrays of basic types are reported once as "name[0]"
+            auto arrayPosition = name.rfind("[0]");
+            if (arrayPosition != std::string::npos && arrayPosition + 3 == name.size())
+            {
+                std::string baseName = name.substr(0, arrayPosition);
+                AddUniform(baseName, location);
+
+                for (int element = 1; element < size; element++)
+                {
+                    std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                    AddUniform(elementName, glGetUniformLocation(m_RendererID, elementName.c_str()));
+                }
+            }
+        }
+    }
+
+    bool Shader::UpdateUniformCache(int location, const void *data, u32 size)
+    {
+        if (location < 0 || static_cast<std::size_t>(location) >= m_UniformValues.size())
+            return false;
+
+        ME_ASSERT(size <= sizeof(UniformValue::data));
+
+        auto &value = m_UniformValues[location];
+        if (value.valid && std::memcmp(value.data.data(), data, size) == 0)
+            return false;
+
+        std::memcpy(value.data.data(), data, size);
+        value.valid = true;
+        return true;
+    }
+
+    ComputeShader::ComputeShader(const std::string& filepath)
+    {
+        m_DefaultStageType = GL_COMPUTE_SHADER;
 
-        u32 computeProgram = TryCompileShader(GL_COMPUTE_SHADER, shaderSource, errorLog);
-        if (!computeProgram)
+        ShaderSource source;
+        if (!ShaderPreprocessor::Process(filepath, source, GL_COMPUTE_SHADER))
         {
-            ME_ERROR("%s", errorLog.c_str());
             ME_ASSERT(false);
+            return;
         }
 
-        glAttachShader(m_RendererID, computeProgram);
+        m_Filepath = filepath;
+        m_Stages = std::move(source.stages);
+        m_SourceFiles = std::move(source.files);
 
-        glLinkProgram(m_RendererID);
-        glValidateProgram(m_RendererID);
+        CreateProgram(m_Stages);
 
-        glDeleteShader(computeProgram);
+        s_LoadedShaders.push_back(this);
     }
 }
\ No newline at end of file
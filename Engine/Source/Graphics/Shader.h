@@ -1,11 +1,27 @@
 #pragma once
 #include "Core/EngineBase.h"
 
+#include "ShaderPreprocessor.h"
+
 #include <glm/glm.hpp>
 
+#include <array>
+#include <vector>
+#include <unordered_map>
+
 
 namespace Engine
 {
+	struct ShaderCacheStatistics
+	{
+		u32 programs = 0;
+		u32 cacheHits = 0;
+		u32 cacheMisses = 0;
+		u32 rejectedBinaries = 0;	// Cached binaries the driver refused to load
+		float loadTime = 0.0f;		// ms, programs restored from the cache
+		float compileTime = 0.0f;	// ms, programs compiled and linked from source
+	};
+
 	class Shader
 	{
 	public:
@@ -13,27 +29,86 @@ namespace Engine
 		Shader() = default;
 		~Shader();
 
+		// Linked programs are stored as driver binaries and reloaded while their sources stay the same
+		static void SetProgramCache(bool enabled);
+		static bool IsProgramCacheEnabled();
+
+		static const ShaderCacheStatistics &GetCacheStatistics();
+		static void ResetCacheStatistics();
+
+		// Reloads every shader assembled from the file, directly or through an include.
+		// Returns how many shaders were relinked.
+		static u32 ReloadDependents(const std::string &filepath);
+
 		void LoadFromFile(const std::string &filepath);
 		void LoadFromFiles(const std::string &vertexPath, const std::string &fragmentPath);
 
 		virtual void Bind() const;
 
+		// Preprocesses and links the shader and its variants again, in place. If anything fails
+		// to compile or link, the previous programs stay in use and false is returned.
+		bool Reload();
+
+		// Program compiled from the same sources with the given macros defined after #version,
+		// each entry is "NAME" or "NAME VALUE". Variants are compiled on first use and owned by this shader.
+		Shader *GetVariant(const std::vector<std::string> &defines);
+		u32 GetVariantCount() const { return static_cast<u32>(m_Variants.size()); }
+
+		// Files the shader was assembled from, the shader itself first
+		const std::vector<ShaderSourceFile> &GetSourceFiles() const { return m_SourceFiles; }
+
 		RendererID GetRendererID() const { return m_RendererID; }
 
+		// Locations are reflected once at link time, resolve them up front
+		// and use the location overloads on hot paths
+		int GetUniformLocation(const char *name) const;
+
 		void SetUniformMatrix4(const char *name, const glm::mat4 &matrix);
 		void SetUniformFloat(const char *name, float value);
 		void SetUniformFloat3(const char *name, const glm::vec3 &values);
 
 		void SetUniformInt(const char *name, int value);
 
+		void SetUniformMatrix4(int location, const glm::mat4 &matrix);
+		void SetUniformFloat(int location, float value);
+		void SetUniformFloat3(int location, const glm::vec3 &values);
+
+		void SetUniformInt(int location, int value);
+
 	protected:
 		u32 CreateShader(const std::string &vertexShader, const std::string &fragmentShader);
-		u32 TryCompileShader(u32 shaderType, const std::string &shaderSource, std::string &errorLog);
+		// Loads the program from the program cache or compiles and links the stages
+		u32 CreateProgram(const std::vector<ShaderStage> &stages);
+		// Same without touching the shader, returns 0 if the stages fail to compile or link
+		static RendererID LinkProgram(const std::vector<ShaderStage> &stages, const std::vector<ShaderSourceFile> &files);
+		static u32 TryCompileShader(u32 shaderType, const std::string &shaderSource, std::string &errorLog);
+
+		void ReflectUniforms();
 
-		int GetUniformLocation(const std::string& name);
+		// Returns false if the uniform already holds this value
+		bool UpdateUniformCache(int location, const void *data, u32 size);
 
 	protected:
 		RendererID m_RendererID;
+
+		// Preprocessed sources, variants inject their defines into these
+		std::string m_Filepath;
+		std::vector<ShaderStage> m_Stages;
+		std::vector<ShaderSourceFile> m_SourceFiles;
+		u32 m_DefaultStageType = 0;			// Stage of sources without #shader lines
+		std::vector<std::string> m_Defines;	// Set on variants
+
+	private:
+		struct UniformValue
+		{
+			std::array<u8, sizeof(glm::mat4)> data;
+			bool valid = false;
+		};
+
+		std::unordered_map<u64, int> m_UniformLocations;	// Name hash -> location
+		std::vector<UniformValue> m_UniformValues;			// Indexed by location
+
+		std::unordered_map<u64, UniquePtr<Shader>> m_Variants;	// Define hash -> variant
 	};
 
 	class ComputeShader : public Shader
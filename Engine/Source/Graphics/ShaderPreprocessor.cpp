@@ -0,0 +1,311 @@
+#include "Precompiled.h"
+#include "ShaderPreprocessor.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <filesystem>
+#include <cctype>
+#include <cstring>
+
+
+namespace Engine
+{
+	static constexpr u32 MaxIncludeDepth = 32;
+
+	struct PreprocessorState
+	{
+		PreprocessorState(ShaderSource &source) :
+			source(source)
+		{
+		}
+
+		ShaderSource &source;
+		std::unordered_map<std::string, u32> fileIndices;
+		std::vector<std::string> fileContents;	// Read once, indexed like source.files
+		std::vector<bool> includeOnce;
+
+		// Reset for every stage, each stage is compiled on its own
+		std::unordered_set<u32> includedOnce;
+	};
+
+	// Directive name and its argument, the line has to start with '#'
+	static bool ParseDirective(const char *begin, const char *end, std::string &name, std::string &argument)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t'))
+			begin++;
+		if (begin == end || *begin != '#')
+			return false;
+
+		begin++;
+		while (begin < end && (*begin == ' ' || *begin == '\t'))
+			begin++;
+
+		const char *nameEnd = begin;
+		while (nameEnd < end && (std::isalnum(static_cast<unsigned char>(*nameEnd)) || *nameEnd == '_'))
+			nameEnd++;
+		name.assign(begin, nameEnd);
+
+		while (nameEnd < end && (*nameEnd == ' ' || *nameEnd == '\t'))
+			nameEnd++;
+		while (end > nameEnd && std::isspace(static_cast<unsigned char>(end[-1])))
+			end--;
+		argument.assign(nameEnd, end);
+
+		return true;
+	}
+
+	static bool LoadFile(PreprocessorState &state, const std::string &filepath, u32 &index)
+	{
+		const std::string normalized = std::filesystem::path(filepath).lexically_normal().generic_string();
+
+		auto it = state.fileIndices.find(normalized);
+		if (it != state.fileIndices.end())
+		{
+			index = it->second;
+			return true;
+		}
+
+		std::ifstream stream(normalized, std::ios::binary);
+		if (!stream)
+			return false;
+
+		std::stringstream contents;
+		contents << stream.rdbuf();
+
+		index = static_cast<u32>(state.source.files.size());
+		state.fileIndices[normalized] = index;
+		state.source.files.push_back({ normalized, {} });
+		state.fileContents.push_back(contents.str());
+		state.includeOnce.push_back(false);
+
+		return true;
+	}
+
+	static void AppendLineDirective(std::string &output, u32 line, u32 fileIndex)
+	{
+		output += "#line " + std::to_string(line) + " " + std::to_string(fileIndex) + "\n";
+	}
+
+	// Appends the file to the current stage, a "#shader" line in the root file starts a new one
+	static bool ProcessFile(PreprocessorState &state, u32 fileIndex, u32 depth, u32 defaultStageType)
+	{
+		if (depth > MaxIncludeDepth)
+		{
+			ME_ERROR("Shader includes nested too deep (circular include?): %s", state.source.files[fileIndex].filepath.c_str());
+			return false;
+		}
+
+		// Copied, loading includes may grow the vectors
+		const std::string contents = state.fileContents[fileIndex];
+		const std::string filepath = state.source.files[fileIndex].filepath;
+		const std::string directory = std::filesystem::path(filepath).parent_path().generic_string();
+
+		auto &stages = state.source.stages;
+		std::string name, argument;
+
+		u32 line = 1;
+		for (std::size_t position = 0; position < contents.size(); line++)
+		{
+			std::size_t lineEnd = contents.find('\n', position);
+			if (lineEnd == std::string::npos)
+				lineEnd = contents.size();
+
+			const char *begin = contents.data() + position;
+			const char *end = contents.data() + lineEnd;
+			position = lineEnd + 1;
+
+			const bool directive = ParseDirective(begin, end, name, argument);
+			if (directive && name == "shader")
+			{
+				if (depth > 0)
+				{
+					ME_ERROR("#shader is only allowed in the root file: %s(%u)", filepath.c_str(), line);
+					return false;
+				}
+
+				u32 type = ShaderPreprocessor::GetStageType(argument);
+				if (!type)
+				{
+					ME_ERROR("Unknown shader stage '%s': %s(%u)", argument.c_str(), filepath.c_str(), line);
+					return false;
+				}
+
+				stages.push_back({ type, std::string() });
+				state.includedOnce.clear();
+				continue;
+			}
+
+			if (stages.empty())
+			{
+				// Text before the first #shader line only matters for single stage files
+				if (defaultStageType == 0)
+					continue;
+				stages.push_back({ defaultStageType, std::string() });
+			}
+			std::string &output = stages.back().source;
+
+			if (!directive)
+			{
+				output.append(begin, end);
+				output += '\n';
+			}
+			else if (name == "version")
+			{
+				// #line can't precede #version, so the mapping starts right after it
+				output.append(begin, end);
+				output += '\n';
+				AppendLineDirective(output, line + 1, fileIndex);
+			}
+			else if (name == "pragma" && argument == "once")
+			{
+				// Consumed directives leave an empty line, so the line numbers stay intact
+				state.includeOnce[fileIndex] = true;
+				state.includedOnce.insert(fileIndex);
+				output += '\n';
+			}
+			else if (name == "include")
+			{
+				if (argument.size() < 2 || argument.front() != '"' || argument.back() != '"')
+				{
+					ME_ERROR("Malformed #include: %s(%u)", filepath.c_str(), line);
+					return false;
+				}
+
+				const std::string includePath = (std::filesystem::path(directory) / argument.substr(1, argument.size() - 2)).generic_string();
+
+				u32 includeIndex;
+				if (!LoadFile(state, includePath, includeIndex))
+				{
+					ME_ERROR("Failed to open shader include %s: %s(%u)", includePath.c_str(), filepath.c_str(), line);
+					return false;
+				}
+
+				auto &includes = state.source.files[fileIndex].includes;
+				if (std::find(includes.begin(), includes.end(), includeIndex) == includes.end())
+					includes.push_back(includeIndex);
+
+				if (state.includeOnce[includeIndex] && state.includedOnce.count(includeIndex))
+				{
+					output += '\n';
+					continue;
+				}
+
+				AppendLineDirective(output, 1, includeIndex);
+				if (!ProcessFile(state, includeIndex, depth + 1, defaultStageType))
+					return false;
+				AppendLineDirective(output, line + 1, fileIndex);
+			}
+			else
+			{
+				output.append(begin, end);
+				output += '\n';
+			}
+		}
+
+		return true;
+	}
+
+	bool ShaderPreprocessor::Process(const std::string &filepath, ShaderSource &source, u32 defaultStageType)
+	{
+		source = ShaderSource();
+		PreprocessorState state(source);
+
+		u32 rootIndex;
+		if (!LoadFile(state, filepath, rootIndex))
+		{
+			ME_ERROR("Failed to open shader: %s", filepath.c_str());
+			return false;
+		}
+
+		if (!ProcessFile(state, rootIndex, 0, defaultStageType))
+			return false;
+
+		if (source.stages.empty())
+		{
+			ME_ERROR("Shader has no stages: %s", filepath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string ShaderPreprocessor::InjectDefines(const std::string &source, const std::vector<std::string> &defines)
+	{
+		std::size_t versionPosition = source.find("#version");
+		std::size_t insertPosition = 0;
+		std::size_t nextLine = 1;
+
+		if (versionPosition != std::string::npos)
+		{
+			std::size_t lineEnd = source.find('\n', versionPosition);
+			insertPosition = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+			nextLine = static_cast<std::size_t>(std::count(source.begin(), source.begin() + versionPosition, '\n')) + 2;
+		}
+
+		std::string injected;
+		if (insertPosition == source.size() && (source.empty() || source.back() != '\n'))
+			injected += "\n";
+
+		for (auto &define : defines)
+			injected += "#define " + define + "\n";
+		// Preprocessed sources carry their own #line right after #version
+		injected += "#line " + std::to_string(nextLine) + "\n";
+
+		std::string result = source;
+		result.insert(insertPosition, injected);
+		return result;
+	}
+
+	std::string ShaderPreprocessor::ResolveErrorLog(const std::string &errorLog, const std::vector<ShaderSourceFile> &files)
+	{
+		std::string result;
+		result.reserve(errorLog.size());
+
+		for (std::size_t position = 0; position < errorLog.size();)
+		{
+			std::size_t lineEnd = errorLog.find('\n', position);
+			if (lineEnd == std::string::npos)
+				lineEnd = errorLog.size();
+			std::string line = errorLog.substr(position, lineEnd - position);
+			position = lineEnd + 1;
+
+			// The source string number starts the line or follows a severity prefix
+			std::size_t numberBegin = 0;
+			for (const char *prefix : { "ERROR: ", "WARNING: " })
+			{
+				if (line.compare(0, std::strlen(prefix), prefix) == 0)
+					numberBegin = std::strlen(prefix);
+			}
+
+			std::size_t numberEnd = numberBegin;
+			while (numberEnd < line.size() && std::isdigit(static_cast<unsigned char>(line[numberEnd])))
+				numberEnd++;
+
+			if (numberEnd > numberBegin && numberEnd + 1 < line.size() && (line[numberEnd] == '(' || line[numberEnd] == ':') &&
+				std::isdigit(static_cast<unsigned char>(line[numberEnd + 1])))
+			{
+				std::size_t fileIndex = std::stoul(line.substr(numberBegin, numberEnd - numberBegin));
+				if (fileIndex < files.size())
+					line.replace(numberBegin, numberEnd - numberBegin, files[fileIndex].filepath);
+			}
+
+			result += line;
+			if (lineEnd < errorLog.size())
+				result += '\n';
+		}
+
+		return result;
+	}
+
+	u32 ShaderPreprocessor::GetStageType(const std::string &name)
+	{
+		if (name == "vertex")			return GL_VERTEX_SHADER;
+		if (name == "fragment")			return GL_FRAGMENT_SHADER;
+		if (name == "geometry")			return GL_GEOMETRY_SHADER;
+		if (name == "tess_control")		return GL_TESS_CONTROL_SHADER;
+		if (name == "tess_evaluation")	return GL_TESS_EVALUATION_SHADER;
+		if (name == "compute")			return GL_COMPUTE_SHADER;
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include <string>
+#include <vector>
+
+
+namespace Engine
+{
+	struct ShaderStage
+	{
+		u32 type;	// GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, ...
+		std::string source;
+	};
+
+	struct ShaderSourceFile
+	{
+		std::string filepath;
+		std::vector<u32> includes;	// Files included directly, as indices into ShaderSource::files
+	};
+
+	struct ShaderSource
+	{
+		std::vector<ShaderStage> stages;
+		// Every file the stages were assembled from, the shader itself first. The index
+		// is the source string number in the emitted #line directives.
+		std::vector<ShaderSourceFile> files;
+	};
+
+	// Splits a shader file into stages at "#shader <stage>" lines and inlines #include "file" directives,
+	// paths are relative to the including file. Headers marked with #pragma once are inlined once per stage.
+	class ShaderPreprocessor
+	{
+	public:
+		// Files without #shader lines are a single stage of the given type
+		static bool Process(const std::string &filepath, ShaderSource &source, u32 defaultStageType = 0);
+
+		// Defines have to follow #version, the line numbers stay the same
+		static std::string InjectDefines(const std::string &source, const std::vector<std::string> &defines);
+
+		// Replaces the source string numbers in driver messages ("0(12) : error" or "ERROR: 0:12:") with file names
+		static std::string ResolveErrorLog(const std::string &errorLog, const std::vector<ShaderSourceFile> &files);
+
+		// "vertex", "fragment", "geometry", "tess_control", "tess_evaluation" or "compute", 0 if unknown
+		static u32 GetStageType(const std::string &name);
+	};
+}
\ No newline at end of file
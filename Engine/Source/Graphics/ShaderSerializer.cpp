@@ -0,0 +1,152 @@
+#include "Precompiled.h"
+#include "ShaderSerializer.h"
+
+#include "Core/MappedFile.h"
+#include "Util/Hash.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+
+namespace Engine
+{
+	static const char *s_ShaderCacheDirectory = "Cache/Shaders";
+	static const char s_ShaderCacheMagic[4] = { 'M', 'E', 'S', 'C' };
+
+	struct ShaderCacheHeader
+	{
+		char magic[4];
+		u32 version;
+		u64 sourceHash;
+
+		u32 binaryFormat;
+		u32 binarySize;
+	};
+
+	static std::string GetDriverString(GLenum name)
+	{
+		const GLubyte *string = glGetString(name);
+		return string ? reinterpret_cast<const char *>(string) : std::string();
+	}
+
+	u64 ShaderSerializer::CalculateSourceHash(const std::vector<ShaderStage> &stages)
+	{
+		// A driver update changes the version string and invalidates every binary
+		static const u64 driverHash = Hash::FNV1a(GetDriverString(GL_VERSION),
+			Hash::FNV1a(GetDriverString(GL_RENDERER), Hash::FNV1a(GetDriverString(GL_VENDOR))));
+
+		u64 hash = Hash::FNV1aValue(Version, driverHash);
+		for (auto &stage : stages)
+		{
+			hash = Hash::FNV1aValue(stage.type, hash);
+			hash = Hash::FNV1a(stage.source, hash);
+		}
+
+		return hash;
+	}
+
+	std::string ShaderSerializer::GetCachePath(u64 sourceHash)
+	{
+		return std::string(s_ShaderCacheDirectory) + "/" + Hash::ToString(sourceHash) + ".bin";
+	}
+
+	bool ShaderSerializer::IsSupported()
+	{
+		static const bool supported = []()
+		{
+			GLint formatCount = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+			return formatCount > 0;
+		}();
+
+		return supported;
+	}
+
+	bool ShaderSerializer::Serialize(RendererID program, const std::string &cachePath, u64 sourceHash)
+	{
+		GLint binarySize = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (binarySize <= 0)
+			return false;
+
+		std::vector<u8> binary(static_cast<std::size_t>(binarySize));
+		GLenum binaryFormat;
+		glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+		// Write to a temporary file first so a partially written cache is never picked up
+		std::string temporaryPath = cachePath + ".tmp";
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			ME_WARN("Failed to create Shader cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		ShaderCacheHeader header = {};
+		std::memcpy(header.magic, s_ShaderCacheMagic, sizeof(header.magic));
+		header.version = Version;
+		header.sourceHash = sourceHash;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = static_cast<u32>(binarySize);
+
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char *>(binary.data()), binarySize);
+
+		bool success = stream.good();
+		stream.close();
+
+		if (success)
+		{
+			std::filesystem::rename(temporaryPath, cachePath, error);
+			success = !error;
+		}
+		if (!success)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			ME_WARN("Failed to write Shader cache: %s", cachePath.c_str());
+		}
+
+		return success;
+	}
+
+	bool ShaderSerializer::Deserialize(RendererID program, const std::string &cachePath, u64 sourceHash)
+	{
+		MappedFile file;
+		if (!file.Open(cachePath))
+			return false;
+
+		const u8 *data = file.GetData();
+		std::size_t size = file.GetSize();
+
+		ShaderCacheHeader header;
+		if (size < sizeof(header))
+			return false;
+		std::memcpy(&header, data, sizeof(header));
+
+		if (std::memcmp(header.magic, s_ShaderCacheMagic, sizeof(header.magic)) != 0 ||
+			header.version != Version || header.sourceHash != sourceHash ||
+			sizeof(header) + u64(header.binarySize) > size)
+		{
+			ME_WARN("Ignoring outdated Shader cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		glProgramBinary(program, header.binaryFormat, data + sizeof(header), static_cast<GLsizei>(header.binarySize));
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			ME_WARN("Driver rejected Shader cache: %s", cachePath.c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Shader.h"
+
+
+namespace Engine
+{
+	// Linked program binaries as returned by glGetProgramBinary. Binaries only load on the driver that
+	// produced them, so cache files are keyed by a hash of the stage sources and the driver strings.
+	class ShaderSerializer
+	{
+	public:
+		static constexpr u32 Version = 1;
+
+		static u64 CalculateSourceHash(const std::vector<ShaderStage> &stages);
+		static std::string GetCachePath(u64 sourceHash);
+
+		// Drivers without binary formats can't use the cache at all
+		static bool IsSupported();
+
+		static bool Serialize(RendererID program, const std::string &cachePath, u64 sourceHash);
+		// Fails for missing or outdated files and for binaries the driver rejects, the program then has to be linked from source
+		static bool Deserialize(RendererID program, const std::string &cachePath, u64 sourceHash);
+	};
+}
\ No newline at end of file
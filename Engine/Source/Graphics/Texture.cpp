@@ -6,107 +6,519 @@
 
 #include <glm/glm.hpp>
 
+#include "TextureSerializer.h"
+#include "MipChain.h"
+
+#include "Core/AsyncLoader.h"
+
+#include <filesystem>
+#include <chrono>
+#include <deque>
+#include <cstring>
+
+
+// S3TC is core on every desktop driver but only exposed as an extension
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 
 namespace Engine
 {
-	Texture::Texture() : 
-		m_RendererID(0), 
-		m_Width(0), m_Height(0),
-		m_IsLoaded(false)
+	static std::atomic<u64> s_AllocatedTextureMemory = 0;
+
+	static GLenum GetCompressedFormat(TextureCompression compression, bool srgb)
 	{
+		switch (compression)
+		{
+			case TextureCompression::BC1: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			case TextureCompression::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case TextureCompression::BC4: return GL_COMPRESSED_RED_RGTC1;
+			case TextureCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+			case TextureCompression::BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+			case TextureCompression::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+			default: ME_ASSERT(false); return 0;
+		}
 	}
-	Texture::Texture(const std::string &filepath, bool srgb)
+
+	using UploadClock = std::chrono::high_resolution_clock;
+
+	// Pixels are copied into a persistently mapped ring and the texture reads them from there,
+	// so uploads return without waiting for the transfer. Fences guard regions still being read.
+	struct TextureUploadData
 	{
-		Load(filepath, srgb);
-	}
-	Texture::~Texture()
+		static constexpr u64 BufferSize = 64 * 1024 * 1024;
+
+		struct Region
+		{
+			u64 begin, end;
+			GLsync fence;
+		};
+
+		RendererID buffer = 0;
+		u8 *mapped = nullptr;
+		u64 head = 0;
+		std::deque<Region> regions;
+
+		bool staging = true;
+		TextureUploadStatistics statistics;
+	};
+	static TextureUploadData s_UploadData;
+
+	struct StagedPixels
 	{
-		glDeleteTextures(1, &m_RendererID);
+		const u8 *pixels;		// Offset into the bound unpack buffer if staged
+		u64 begin, end;
+		bool staged;
+	};
+
+	static StagedPixels StagePixels(const u8 *pixels, u64 size)
+	{
+		auto &data = s_UploadData;
+		if (!data.staging || size > TextureUploadData::BufferSize)
+			return { pixels, 0, 0, false };
+
+		if (!data.buffer)
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glCreateBuffers(1, &data.buffer);
+			glNamedBufferStorage(data.buffer, TextureUploadData::BufferSize, nullptr, flags);
+			data.mapped = static_cast<u8 *>(glMapNamedBufferRange(data.buffer, 0, TextureUploadData::BufferSize, flags));
+		}
+
+		// Offsets stay aligned for any pixel format
+		u64 begin = (data.head + 15) & ~u64(15);
+		if (begin + size > TextureUploadData::BufferSize)
+			begin = 0;
+		const u64 end = begin + size;
+
+		// Fences signal in order, waiting for the newest overlapping region covers all older ones
+		auto overlap = data.regions.end();
+		for (auto it = data.regions.begin(); it != data.regions.end(); it++)
+		{
+			if (it->begin < end && begin < it->end)
+				overlap = it;
+		}
+		if (overlap != data.regions.end())
+		{
+			glClientWaitSync(overlap->fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~GLuint64(0));
+			data.statistics.stalls++;
+
+			for (auto it = data.regions.begin(); it != overlap + 1; it++)
+				glDeleteSync(it->fence);
+			data.regions.erase(data.regions.begin(), overlap + 1);
+		}
+
+		std::memcpy(data.mapped + begin, pixels, size);
+		data.head = end;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, data.buffer);
+		return { reinterpret_cast<const u8 *>(begin), begin, end, true };
 	}
 
-	void Texture::Load(const std::string &filepath, bool srgb)
+	static void FinishStaging(const StagedPixels &staged)
 	{
-		ME_INFO("Loading Texture: %s", filepath.c_str());
+		if (!staged.staged)
+			return;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		s_UploadData.regions.push_back({ staged.begin, staged.end, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+	}
 
-		int width, height;
-		int channels;
+	static void RecordUpload(u64 bytes, UploadClock::time_point start)
+	{
+		auto &stats = s_UploadData.statistics;
+		stats.uploads++;
+		stats.bytes += bytes;
+		stats.time += std::chrono::duration<float, std::milli>(UploadClock::now() - start).count();
+	}
 
-		m_IsHDR = stbi_is_hdr(filepath.c_str());
+	void Texture::Shutdown()
+	{
+		auto &data = s_UploadData;
+		for (auto &region : data.regions)
+			glDeleteSync(region.fence);
+		data.regions.clear();
 
-		if (m_IsHDR)
+		if (data.buffer)
 		{
-			float* localBuffer = stbi_loadf(filepath.c_str(), &width, &height, &channels, 0);
+			glUnmapNamedBuffer(data.buffer);
+			glDeleteBuffers(1, &data.buffer);
+		}
+		data.buffer = 0;
+		data.mapped = nullptr;
+		data.head = 0;
+	}
+
+	void Texture::SetUploadStaging(bool enabled)
+	{
+		s_UploadData.staging = enabled;
+	}
+
+	bool Texture::IsUploadStaging()
+	{
+		return s_UploadData.staging;
+	}
 
-			if (localBuffer)
+	const TextureUploadStatistics &Texture::GetUploadStatistics()
+	{
+		return s_UploadData.statistics;
+	}
+
+	void Texture::ResetUploadStatistics()
+	{
+		s_UploadData.statistics = TextureUploadStatistics();
+	}
+
+	SharedPtr<Texture> Texture::CreatePending(const std::string &filepath)
+	{
+		auto texture = MakeShared<Texture>();
+		texture->m_Filepath = filepath;
+		texture->m_IsLoading = true;
+		return texture;
+	}
+
+	SharedPtr<Texture> Texture::LoadAsync(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		auto texture = MakeShared<Texture>();
+		Stream(texture, filepath, settings);
+		return texture;
+	}
+
+	void Texture::Stream(const SharedPtr<Texture> &texture, const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		texture->m_Filepath = filepath;
+		texture->m_IsLoading = true;
+
+		const u32 generation = ++texture->m_LoadGeneration;
+		std::weak_ptr<Texture> target = texture;
+
+		AsyncLoader::Load([filepath, settings, target, generation]() -> Job
 			{
-				m_IsLoaded = true;
-				m_Width = width;
-				m_Height = height;
+				auto image = MakeShared<TextureImage>(Decode(filepath, settings));
 
-				glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
-				glTextureStorage2D(m_RendererID, 1, GL_RGB32F, (GLsizei) width, (GLsizei) height);
+				return [image, target, generation]()
+				{
+					auto texture = target.lock();
+					if (texture && texture->m_LoadGeneration == generation)
+						texture->Upload(*image);
+				};
+			});
+	}
 
-				glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	void Texture::Reload(const SharedPtr<Texture> &texture, ConstRef<TextureSettings> settings)
+	{
+		const std::string filepath = texture->m_Filepath;
+		const u32 generation = ++texture->m_LoadGeneration;
+		std::weak_ptr<Texture> target = texture;
 
-				glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		AsyncLoader::Load([filepath, settings, target, generation]() -> Job
+			{
+				auto image = MakeShared<TextureImage>(Decode(filepath, settings));
 
-				glTextureSubImage2D(m_RendererID, 0, 0, 0, (GLsizei)width, (GLsizei)height, GL_RGB, GL_FLOAT, localBuffer);
+				return [image, filepath, target, generation]()
+				{
+					auto texture = target.lock();
+					if (!texture || texture->m_LoadGeneration != generation)
+						return;
+
+					if (!image->IsValid() && texture->IsLoaded())
+					{
+						ME_WARN("Failed to reload Texture, keeping the previous one: %s", filepath.c_str());
+						texture->m_IsLoading = false;
+						return;
+					}
+
+					texture->Upload(*image);
+				};
+			});
+	}
 
-				stbi_image_free(localBuffer);
-			}
-			else {
-				m_IsLoaded = false;
+	// Rows stay top to bottom as stored in the file, meshes flip their texture coordinates on import.
+	// The global stb flip flag is never touched, it isn't safe with parallel decodes.
+	static bool LoadPixels(const std::string &filepath, TextureImage &image)
+	{
+		int width, height, fileChannels;
+		stbi_uc *localBuffer = stbi_load(filepath.c_str(), &width, &height, &fileChannels, STBI_rgb_alpha);
+		if (!localBuffer)
+			return false;
+
+		image.width = width;
+		image.height = height;
+		image.channels = 4;
+		image.pixels.assign(localBuffer, localBuffer + std::size_t(width) * height * 4);
+
+		stbi_image_free(localBuffer);
+		return true;
+	}
+
+	TextureImage Texture::Decode(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		ME_INFO("Loading Texture: %s", filepath.c_str());
+
+		TextureImage image;
+
+		// Already block compressed, uploaded as stored
+		if (std::filesystem::path(filepath).extension() == ".dds")
+		{
+			if (!TextureSerializer::Deserialize(image, filepath))
+				ME_ERROR("Failed to load Texture: %s", filepath.c_str());
+			return image;
+		}
+
+		image.hdr = stbi_is_hdr(filepath.c_str());
+
+		// There is no BC6H encoder, HDR images always stay uncompressed
+		if (!image.hdr && (settings.mipmaps || BlockCompression::CanEncode(settings.compression)))
+			return DecodeCached(filepath, settings);
+
+		image.srgb = settings.srgb;
+		image.mipmaps = settings.mipmaps;
+
+		if (image.hdr)
+		{
+			int width, height, channels;
+			float *localBuffer = stbi_loadf(filepath.c_str(), &width, &height, &channels, STBI_rgb);
+			if (!localBuffer)
+			{
 				ME_ERROR("Failed to load HDR Texture: %s", filepath.c_str());
+				return image;
 			}
+
+			image.width = width;
+			image.height = height;
+			image.channels = 3;
+			image.pixels.resize(std::size_t(width) * height * image.channels * sizeof(float));
+			std::memcpy(image.pixels.data(), localBuffer, image.pixels.size());
+			stbi_image_free(localBuffer);
+		}
+		else if (!LoadPixels(filepath, image))
+		{
+			ME_ERROR("Failed to load Texture: %s", filepath.c_str());
 		}
-		else {
-			stbi_set_flip_vertically_on_load(true);
-			stbi_uc *localBuffer = stbi_load(filepath.c_str(), &width, &height, &channels, 
-				srgb ? STBI_rgb : STBI_rgb_alpha);
 
-			if (localBuffer)
-			{
-				m_IsLoaded = true;
-				m_Width = width;
-				m_Height = height;
+		return image;
+	}
 
-				if (srgb)
-				{
-					uint32_t levels = 1;
-					while ((m_Width | m_Height) >> levels)
-						levels++;
-					glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
-					glTextureStorage2D(m_RendererID, levels, GL_SRGB8, (GLsizei) m_Width, (GLsizei) m_Height);
-					glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-					glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-					glTextureSubImage2D(m_RendererID, 0, 0, 0, (GLsizei) m_Width, (GLsizei) m_Height, GL_RGB, GL_UNSIGNED_BYTE, localBuffer);
-					glGenerateTextureMipmap(m_RendererID);
-				}
-				else
-				{
-					glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
-					glTextureStorage2D(m_RendererID, 1, GL_RGBA8, (GLsizei) m_Width, (GLsizei) m_Height);
+	TextureImage Texture::DecodeCached(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		u64 sourceHash = TextureSerializer::CalculateSourceHash(filepath, settings);
+		std::string cachePath = TextureSerializer::GetCachePath(sourceHash);
+
+		TextureImage image;
+		if (sourceHash && TextureSerializer::Deserialize(image, cachePath, sourceHash))
+		{
+			ME_INFO("Loaded Texture from cache: %s", cachePath.c_str());
+			return image;
+		}
 
-					glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-					glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		TextureImage source;
+		if (!LoadPixels(filepath, source))
+		{
+			ME_ERROR("Failed to load Texture: %s", filepath.c_str());
+			return image;
+		}
 
-					glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-					glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		image.width = source.width;
+		image.height = source.height;
+		image.channels = 4;
+		image.srgb = settings.srgb;
+		image.mipmaps = settings.mipmaps;
 
-					glTextureSubImage2D(m_RendererID, 0, 0, 0, (GLsizei) m_Width, (GLsizei) m_Height, GL_RGBA, GL_UNSIGNED_BYTE, localBuffer);
-				}
+		// Compressed levels can't be generated by the driver, and filtering here gets sRGB and normals right
+		if (settings.mipmaps)
+		{
+			MipFilter filter = settings.normalMap ? MipFilter::NormalMap : (settings.srgb ? MipFilter::SRGB : MipFilter::Linear);
+			image.pixels = MipChain::Generate(source.pixels.data(), source.width, source.height, filter, image.levels);
+		}
+		else
+		{
+			image.pixels = std::move(source.pixels);
+			image.levels = 1;
+		}
 
-				stbi_image_free(localBuffer);
+		if (BlockCompression::CanEncode(settings.compression))
+		{
+			u64 compressedSize = 0;
+			for (u32 level = 0; level < image.levels; level++)
+				compressedSize += BlockCompression::GetLevelSize(settings.compression, glm::max(image.width >> level, 1u), glm::max(image.height >> level, 1u));
+
+			std::vector<u8> compressed(compressedSize);
+
+			std::size_t sourceOffset = 0;
+			u64 offset = 0;
+			for (u32 level = 0; level < image.levels; level++)
+			{
+				const u32 width = glm::max(image.width >> level, 1u), height = glm::max(image.height >> level, 1u);
+				BlockCompression::Encode(settings.compression, image.pixels.data() + sourceOffset, width, height, compressed.data() + offset);
+
+				sourceOffset += std::size_t(width) * height * 4;
+				offset += BlockCompression::GetLevelSize(settings.compression, width, height);
 			}
-			else {
-				m_IsLoaded = false;
-				ME_ERROR("Failed to load Texture: %s", filepath.c_str());
+
+			image.pixels = std::move(compressed);
+			image.compression = settings.compression;
+
+			ME_INFO("Compressed Texture to %s: %s", BlockCompression::GetName(settings.compression), filepath.c_str());
+		}
+
+		if (sourceHash)
+			TextureSerializer::Serialize(image, cachePath, sourceHash);
+
+		return image;
+	}
+
+	Texture::Texture()
+	{
+	}
+	Texture::Texture(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		Load(filepath, settings);
+	}
+	Texture::~Texture()
+	{
+		Release();
+	}
+
+	u64 Texture::GetAllocatedMemory()
+	{
+		return s_AllocatedTextureMemory;
+	}
+
+	void Texture::Load(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		m_Filepath = filepath;
+
+		// Supersedes any asynchronous load still in flight
+		m_LoadGeneration++;
+		Upload(Decode(filepath, settings));
+	}
+
+	void Texture::Release()
+	{
+		if (m_RendererID)
+			glDeleteTextures(1, &m_RendererID);
+		m_RendererID = 0;
+
+		s_AllocatedTextureMemory -= m_MemorySize;
+		m_MemorySize = 0;
+	}
+
+	void Texture::Upload(const TextureImage &image)
+	{
+		m_IsLoading = false;
+		m_IsHDR = image.hdr;
+
+		if (!image.IsValid())
+		{
+			m_IsLoaded = false;
+			return;
+		}
+
+		Release();
+
+		m_IsLoaded = true;
+		m_Width = image.width;
+		m_Height = image.height;
+		m_Compression = image.compression;
+
+		if (image.compression != TextureCompression::None || image.levels > 1)
+		{
+			UploadLevels(image);
+			return;
+		}
+
+		u32 levels = 1;
+		if (image.mipmaps && !image.hdr)
+			levels = MipChain::GetLevelCount(m_Width, m_Height);
+
+		// LDR images are always RGBA8, a layout the driver can copy without repacking
+		const u64 bytesPerPixel = image.hdr ? 12 : 4;
+		for (u32 level = 0; level < levels; level++)
+			m_MemorySize += u64(glm::max(m_Width >> level, 1u)) * glm::max(m_Height >> level, 1u) * bytesPerPixel;
+		s_AllocatedTextureMemory += m_MemorySize;
+
+		auto uploadStart = UploadClock::now();
+		StagedPixels staged = StagePixels(image.pixels.data(), image.pixels.size());
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
+
+		if (image.hdr)
+		{
+			glTextureStorage2D(m_RendererID, 1, GL_RGB32F, (GLsizei) m_Width, (GLsizei) m_Height);
+
+			glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+			glTextureSubImage2D(m_RendererID, 0, 0, 0, (GLsizei) m_Width, (GLsizei) m_Height, GL_RGB, GL_FLOAT, staged.pixels);
+		}
+		else
+		{
+			glTextureStorage2D(m_RendererID, levels, image.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, (GLsizei) m_Width, (GLsizei) m_Height);
+
+			glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			if (!image.srgb)
+			{
+				glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 			}
+
+			glTextureSubImage2D(m_RendererID, 0, 0, 0, (GLsizei) m_Width, (GLsizei) m_Height, GL_RGBA, GL_UNSIGNED_BYTE, staged.pixels);
+		}
+
+		FinishStaging(staged);
+
+		if (levels > 1)
+			glGenerateTextureMipmap(m_RendererID);
+
+		RecordUpload(image.pixels.size(), uploadStart);
+	}
+
+	// Uploads every stored level, either block compressed or RGBA8
+	void Texture::UploadLevels(const TextureImage &image)
+	{
+		const bool compressed = image.compression != TextureCompression::None;
+		const GLenum format = compressed ? GetCompressedFormat(image.compression, image.srgb) : (image.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
+		glTextureStorage2D(m_RendererID, (GLsizei) image.levels, format, (GLsizei) m_Width, (GLsizei) m_Height);
+
+		glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, image.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		auto uploadStart = UploadClock::now();
+		StagedPixels staged = StagePixels(image.pixels.data(), image.pixels.size());
+
+		u64 offset = 0;
+		for (u32 level = 0; level < image.levels; level++)
+		{
+			const u32 width = glm::max(m_Width >> level, 1u), height = glm::max(m_Height >> level, 1u);
+			const u64 size = compressed ? BlockCompression::GetLevelSize(image.compression, width, height) : u64(width) * height * 4;
+
+			if (compressed)
+				glCompressedTextureSubImage2D(m_RendererID, (GLint) level, 0, 0, (GLsizei) width, (GLsizei) height, format, (GLsizei) size, staged.pixels + offset);
+			else
+				glTextureSubImage2D(m_RendererID, (GLint) level, 0, 0, (GLsizei) width, (GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, staged.pixels + offset);
+			offset += size;
 		}
+
+		FinishStaging(staged);
+		RecordUpload(image.pixels.size(), uploadStart);
+
+		m_MemorySize = offset;
+		s_AllocatedTextureMemory += m_MemorySize;
 	}
+
 	bool Texture::IsLoaded() const
 	{
 		return m_IsLoaded;
@@ -117,6 +529,11 @@ namespace Engine
 		return m_IsHDR;
 	}
 
+	const std::string &Texture::GetFilepath() const
+	{
+		return m_Filepath;
+	}
+
 	void Texture::Bind(u32 slot) const
 	{
 		glBindTextureUnit(slot, m_RendererID);
@@ -143,7 +560,6 @@ namespace Engine
 	}
 	TextureCube::TextureCube(const std::string& right, const std::string& left, const std::string& top, const std::string& bottom, const std::string& front, const std::string& back)
 	{
-		stbi_set_flip_vertically_on_load(false);
 		glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_RendererID);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, m_RendererID);
 
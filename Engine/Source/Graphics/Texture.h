@@ -1,33 +1,123 @@
 #pragma once
 #include "Core/EngineBase.h"
 
+#include "BlockCompression.h"
+
+#include <atomic>
+
 
 namespace Engine
 {
+	struct TextureSettings
+	{
+		bool srgb = false;			// Ignored for HDR images
+		bool mipmaps = false;		// Allocate and generate a full mip chain
+		bool normalMap = false;		// Renormalize when filtering mips
+		// LDR images with mips or block compression are processed once and then loaded from the texture cache
+		TextureCompression compression = TextureCompression::None;
+	};
+
+	// Decoded pixels, produced by Texture::Decode on any thread
+	struct TextureImage
+	{
+		std::vector<u8> pixels;		// Rows top to bottom, floats for HDR images, all levels back to back
+		u32 width = 0, height = 0;
+		u32 channels = 0;
+		bool hdr = false;
+		bool srgb = false;
+		bool mipmaps = false;		// Generated on upload if only the first level is stored
+
+		TextureCompression compression = TextureCompression::None;
+		u32 levels = 1;				// Mip levels stored in pixels
+
+		bool IsValid() const { return !pixels.empty(); }
+	};
+
+	struct TextureUploadStatistics
+	{
+		u32 uploads = 0;
+		u64 bytes = 0;
+		float time = 0.0f;		// ms spent in upload calls on the main thread
+		u32 stalls = 0;			// Waits for the GPU to release staging memory
+	};
+
 	class Texture
 	{
+	public:
+		// Releases the upload staging buffer, needs the GL context
+		static void Shutdown();
+
+		// Uploads go through a persistently mapped unpack buffer unless disabled
+		static void SetUploadStaging(bool enabled);
+		static bool IsUploadStaging();
+
+		static const TextureUploadStatistics &GetUploadStatistics();
+		static void ResetUploadStatistics();
+
+		// Returns right away, the texture reports IsLoading() until the pixels are on the GPU
+		static SharedPtr<Texture> LoadAsync(const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+
+		// Decodes the file on a worker, the texture reports IsLoading() until the pixels are uploaded
+		static void Stream(const SharedPtr<Texture> &texture, const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+		// Decodes the texture's file again on a worker and swaps the new pixels in on upload. The
+		// texture keeps its current pixels meanwhile, and for good if the file fails to decode.
+		static void Reload(const SharedPtr<Texture> &texture, ConstRef<TextureSettings> settings = TextureSettings());
+
+		// Reports IsLoading() until Upload() is called with its pixels
+		static SharedPtr<Texture> CreatePending(const std::string &filepath);
+
+		// No GL calls, safe on worker threads
+		static TextureImage Decode(const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+
+		// GPU memory of all uploaded 2D textures
+		static u64 GetAllocatedMemory();
+
 	public:
 		Texture();
-		Texture(const std::string &fileapth, bool srgb = false);
+		Texture(const std::string &fileapth, ConstRef<TextureSettings> settings = TextureSettings());
 		~Texture();
 
-		void Load(const std::string &filepath, bool srgb = false);
+		void Load(const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+		// Finishes a pending load, an invalid image leaves the texture unloaded
+		void Upload(const TextureImage &image);
+
 		bool IsLoaded() const;
+		bool IsLoading() const { return m_IsLoading; }
 
 		bool IsHDR() const;
 
+		const std::string &GetFilepath() const;
+
 		void Bind(u32 slot = 0) const;
 
 		u32 GetWidth() const;
 		u32 GetHeight() const;
 
+		// Bytes of all mip levels, 0 until loaded
+		u64 GetMemorySize() const { return m_MemorySize; }
+		TextureCompression GetCompression() const { return m_Compression; }
+
 		RendererID GetRendererID() const;
 
 	private:
-		RendererID m_RendererID;
-		u32 m_Width, m_Height;
-		bool m_IsLoaded;
-		bool m_IsHDR;
+		static TextureImage DecodeCached(const std::string &filepath, ConstRef<TextureSettings> settings);
+
+		void UploadLevels(const TextureImage &image);
+		void Release();
+
+	private:
+		std::string m_Filepath;
+		RendererID m_RendererID = 0;
+		u32 m_Width = 0, m_Height = 0;
+		u64 m_MemorySize = 0;
+		TextureCompression m_Compression = TextureCompression::None;
+		bool m_IsHDR = false;
+
+		// Read by the texture library from worker threads
+		std::atomic<bool> m_IsLoaded = false;
+		std::atomic<bool> m_IsLoading = false;
+		// Lets a pending asynchronous load notice that a newer Load() replaced it
+		u32 m_LoadGeneration = 0;
 	};
 
 	class TextureCube
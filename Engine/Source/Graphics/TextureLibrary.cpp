@@ -0,0 +1,238 @@
+#include "Precompiled.h"
+#include "TextureLibrary.h"
+
+#include <filesystem>
+#include <mutex>
+
+
+namespace Engine
+{
+	struct TextureLibraryEntry
+	{
+		std::weak_ptr<Texture> texture;
+		TextureSettings settings;		// Kept for reloading
+	};
+
+	struct TextureLibraryData
+	{
+		// Meshes import their textures on worker threads
+		std::mutex mutex;
+
+		std::unordered_map<std::string, TextureLibraryEntry> textures;
+		SharedPtr<Texture> defaults[static_cast<u32>(TextureSlot::Count)];
+		TextureLibraryStatistics statistics;
+	};
+	static TextureLibraryData s_TextureLibraryData;
+
+	void TextureLibrary::Initialize()
+	{
+		const u8 colors[static_cast<u32>(TextureSlot::Count)][4] = {
+			{ 255, 255, 255, 255 },
+			{ 128, 128, 255, 255 },
+			{ 0, 0, 0, 255 },
+			{ 255, 255, 255, 255 }
+		};
+
+		for (u32 slot = 0; slot < static_cast<u32>(TextureSlot::Count); slot++)
+		{
+			TextureImage image;
+			image.pixels.assign(colors[slot], colors[slot] + 4);
+			image.width = 1;
+			image.height = 1;
+			image.channels = 4;
+
+			auto texture = MakeShared<Texture>();
+			texture->Upload(image);
+			s_TextureLibraryData.defaults[slot] = texture;
+		}
+	}
+
+	void TextureLibrary::Shutdown()
+	{
+		Clear();
+
+		for (auto &texture : s_TextureLibraryData.defaults)
+			texture.reset();
+	}
+
+	SharedPtr<Texture> TextureLibrary::Load(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		bool created;
+		auto texture = Acquire(filepath, settings, created);
+		if (created)
+			texture->Upload(Texture::Decode(filepath, settings));
+
+		return texture;
+	}
+
+	SharedPtr<Texture> TextureLibrary::LoadAsync(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		bool created;
+		auto texture = Acquire(filepath, settings, created);
+		if (created)
+			Texture::Stream(texture, filepath, settings);
+
+		return texture;
+	}
+
+	SharedPtr<Texture> TextureLibrary::Acquire(const std::string &filepath, ConstRef<TextureSettings> settings, bool &created)
+	{
+		std::string key = CreateKey(filepath, settings);
+
+		std::lock_guard<std::mutex> lock(s_TextureLibraryData.mutex);
+
+		auto &stats = s_TextureLibraryData.statistics;
+		stats.loads++;
+
+		auto it = s_TextureLibraryData.textures.find(key);
+		if (it != s_TextureLibraryData.textures.end())
+		{
+			auto texture = it->second.texture.lock();
+			if (texture && (texture->IsLoaded() || texture->IsLoading()))
+			{
+				stats.hits++;
+				created = false;
+				return texture;
+			}
+
+			// Last handle was released since the previous request, or the file failed to load
+			s_TextureLibraryData.textures.erase(it);
+			if (!texture)
+				stats.evictions++;
+		}
+
+		stats.misses++;
+		created = true;
+
+		auto texture = Texture::CreatePending(filepath);
+		s_TextureLibraryData.textures[key] = { texture, settings };
+
+		return texture;
+	}
+
+	SharedPtr<Texture> TextureLibrary::GetDefault(TextureSlot slot)
+	{
+		auto &texture = s_TextureLibraryData.defaults[static_cast<u32>(slot)];
+		ME_ASSERT(texture);
+		return texture;
+	}
+
+	TextureSettings TextureLibrary::GetSlotSettings(TextureSlot slot)
+	{
+		TextureSettings settings;
+		settings.mipmaps = true;
+
+		switch (slot)
+		{
+			case TextureSlot::Albedo:
+				settings.srgb = true;
+				settings.compression = TextureCompression::BC7;
+				break;
+			// Two channels, the shader reconstructs z
+			case TextureSlot::Normal:
+				settings.normalMap = true;
+				settings.compression = TextureCompression::BC5;
+				break;
+			default:
+				settings.compression = TextureCompression::BC4;
+				break;
+		}
+		return settings;
+	}
+
+	u32 TextureLibrary::Reload(const std::string &filepath)
+	{
+		const std::string path = CanonicalPath(filepath);
+
+		std::vector<std::pair<SharedPtr<Texture>, TextureSettings>> textures;
+		{
+			std::lock_guard<std::mutex> lock(s_TextureLibraryData.mutex);
+
+			// Keys are the canonical path followed by the settings, each starting with '|'
+			for (auto &[key, entry] : s_TextureLibraryData.textures)
+			{
+				if (key.compare(0, path.size(), path) != 0 || (key.size() > path.size() && key[path.size()] != '|'))
+					continue;
+
+				if (auto texture = entry.texture.lock())
+					textures.push_back({ texture, entry.settings });
+			}
+		}
+
+		for (auto &[texture, settings] : textures)
+		{
+			ME_INFO("Reloading Texture: %s", texture->GetFilepath().c_str());
+			Texture::Reload(texture, settings);
+		}
+
+		return static_cast<u32>(textures.size());
+	}
+
+	void TextureLibrary::CollectGarbage()
+	{
+		std::lock_guard<std::mutex> lock(s_TextureLibraryData.mutex);
+
+		auto &textures = s_TextureLibraryData.textures;
+		auto &stats = s_TextureLibraryData.statistics;
+
+		for (auto it = textures.begin(); it != textures.end();)
+		{
+			if (it->second.texture.expired())
+			{
+				it = textures.erase(it);
+				stats.evictions++;
+			}
+			else
+				it++;
+		}
+	}
+
+	void TextureLibrary::Clear()
+	{
+		std::lock_guard<std::mutex> lock(s_TextureLibraryData.mutex);
+		s_TextureLibraryData.textures.clear();
+	}
+
+	TextureLibraryStatistics TextureLibrary::GetStatistics()
+	{
+		CollectGarbage();
+
+		std::lock_guard<std::mutex> lock(s_TextureLibraryData.mutex);
+
+		auto stats = s_TextureLibraryData.statistics;
+		stats.residentTextures = static_cast<u32>(s_TextureLibraryData.textures.size());
+		stats.residentMemory = 0;
+
+		for (auto &[key, entry] : s_TextureLibraryData.textures)
+		{
+			if (auto texture = entry.texture.lock())
+				stats.residentMemory += texture->GetMemorySize();
+		}
+		for (auto &texture : s_TextureLibraryData.defaults)
+		{
+			if (texture)
+				stats.residentMemory += texture->GetMemorySize();
+		}
+
+		return stats;
+	}
+
+	std::string TextureLibrary::CanonicalPath(const std::string &filepath)
+	{
+		std::error_code error;
+		std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+
+		return error ? filepath : canonicalPath.generic_string();
+	}
+
+	std::string TextureLibrary::CreateKey(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		std::string key = CanonicalPath(filepath);
+		key += settings.srgb ? "|srgb" : "";
+		key += settings.mipmaps ? "|mips" : "";
+		key += settings.normalMap ? "|normal" : "";
+		key += settings.compression != TextureCompression::None ? std::string("|") + BlockCompression::GetName(settings.compression) : "";
+
+		return key;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Texture.h"
+
+#include <unordered_map>
+
+
+namespace Engine
+{
+	enum class TextureSlot : u32
+	{
+		Albedo = 0,		// White
+		Normal,			// Flat tangent space normal
+		Metalness,		// Black
+		Roughness,		// White
+		Count
+	};
+
+	struct TextureLibraryStatistics
+	{
+		u32 loads = 0;				// Total Load() requests
+		u32 hits = 0;				// Requests served by an already resident or streaming texture
+		u32 misses = 0;				// Requests that had to decode the file
+		u32 evictions = 0;			// Textures dropped after their last handle was released
+		u32 residentTextures = 0;
+		u64 residentMemory = 0;		// Bytes of the library's textures, including the defaults
+	};
+
+	// Shares texture handles keyed by canonical filepath and texture settings. Like the
+	// mesh library it only holds weak references, a texture is evicted once unused.
+	class TextureLibrary
+	{
+	public:
+		// Creates the default textures, needs the GL context
+		static void Initialize();
+		static void Shutdown();
+
+		static SharedPtr<Texture> Load(const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+		// Shares textures with Load(), a pending texture is handed out while it streams in
+		static SharedPtr<Texture> LoadAsync(const std::string &filepath, ConstRef<TextureSettings> settings = TextureSettings());
+
+		// Returns the resident texture, or registers a pending one if created is set which the
+		// caller has to finish with Texture::Upload(). Safe to call from worker threads.
+		static SharedPtr<Texture> Acquire(const std::string &filepath, ConstRef<TextureSettings> settings, bool &created);
+
+		// 1x1 placeholder for empty material slots, shared by all materials
+		static SharedPtr<Texture> GetDefault(TextureSlot slot);
+		// Color space and block compression for textures assigned to a material slot
+		static TextureSettings GetSlotSettings(TextureSlot slot);
+
+		// Streams the file into every resident texture made from it, whatever its settings.
+		// Handles stay valid and show the previous pixels until the new ones are uploaded.
+		static u32 Reload(const std::string &filepath);
+
+		static void CollectGarbage();
+		static void Clear();
+
+		static TextureLibraryStatistics GetStatistics();
+
+	private:
+		static std::string CanonicalPath(const std::string &filepath);
+		static std::string CreateKey(const std::string &filepath, ConstRef<TextureSettings> settings);
+	};
+}
\ No newline at end of file
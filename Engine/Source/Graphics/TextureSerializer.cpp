@@ -0,0 +1,294 @@
+#include "Precompiled.h"
+#include "TextureSerializer.h"
+
+#include "Core/MappedFile.h"
+#include "Util/Hash.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+
+namespace Engine
+{
+	static const char *s_TextureCacheDirectory = "Cache/Textures";
+
+	static constexpr u32 MakeFourCC(char a, char b, char c, char d)
+	{
+		return u32(u8(a)) | (u32(u8(b)) << 8) | (u32(u8(c)) << 16) | (u32(u8(d)) << 24);
+	}
+
+	static constexpr u32 DDSMagic = MakeFourCC('D', 'D', 'S', ' ');
+	// Stored in the reserved words of the header to recognize our own cache files
+	static constexpr u32 DDSCacheTag = MakeFourCC('M', 'E', 'T', 'C');
+
+	static constexpr u32 DDSFlagsCaps = 0x1, DDSFlagsHeight = 0x2, DDSFlagsWidth = 0x4, DDSFlagsPitch = 0x8, DDSFlagsPixelFormat = 0x1000;
+	static constexpr u32 DDSFlagsMipMapCount = 0x20000, DDSFlagsLinearSize = 0x80000;
+	static constexpr u32 DDSPixelFormatFourCC = 0x4;
+	static constexpr u32 DDSCapsComplex = 0x8, DDSCapsTexture = 0x1000, DDSCapsMipMap = 0x400000;
+	static constexpr u32 DDSDimensionTexture2D = 3;
+
+	struct DDSPixelFormat
+	{
+		u32 size;
+		u32 flags;
+		u32 fourCC;
+		u32 rgbBitCount;
+		u32 rBitMask, gBitMask, bBitMask, aBitMask;
+	};
+
+	struct DDSHeader
+	{
+		u32 size;
+		u32 flags;
+		u32 height, width;
+		u32 pitchOrLinearSize;
+		u32 depth;
+		u32 mipMapCount;
+		u32 reserved1[11];
+		DDSPixelFormat pixelFormat;
+		u32 caps, caps2, caps3, caps4;
+		u32 reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		u32 dxgiFormat;
+		u32 resourceDimension;
+		u32 miscFlag;
+		u32 arraySize;
+		u32 miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header has to match the file layout");
+
+	struct DXGIFormat
+	{
+		u32 format;
+		TextureCompression compression;
+		bool srgb;
+	};
+
+	static const DXGIFormat s_DXGIFormats[] = {
+		{ 28, TextureCompression::None, false }, { 29, TextureCompression::None, true },
+		{ 71, TextureCompression::BC1, false }, { 72, TextureCompression::BC1, true },
+		{ 77, TextureCompression::BC3, false }, { 78, TextureCompression::BC3, true },
+		{ 80, TextureCompression::BC4, false },
+		{ 83, TextureCompression::BC5, false },
+		{ 95, TextureCompression::BC6H, false },
+		{ 98, TextureCompression::BC7, false }, { 99, TextureCompression::BC7, true },
+	};
+
+	// Uncompressed images are always RGBA8
+	static u64 GetLevelSize(TextureCompression compression, u32 width, u32 height)
+	{
+		if (compression == TextureCompression::None)
+			return u64(width) * height * 4;
+		return BlockCompression::GetLevelSize(compression, width, height);
+	}
+
+	static u32 GetDXGIFormat(TextureCompression compression, bool srgb)
+	{
+		for (const auto &format : s_DXGIFormats)
+		{
+			if (format.compression == compression && format.srgb == srgb)
+				return format.format;
+		}
+		return 0;
+	}
+
+	u64 TextureSerializer::CalculateSourceHash(const std::string &filepath, ConstRef<TextureSettings> settings)
+	{
+		u64 hash = Hash::File(filepath);
+		if (!hash)
+			return 0;
+
+		hash = Hash::FNV1aValue(settings.srgb, hash);
+		hash = Hash::FNV1aValue(settings.mipmaps, hash);
+		hash = Hash::FNV1aValue(settings.normalMap, hash);
+		hash = Hash::FNV1aValue(settings.compression, hash);
+		hash = Hash::FNV1aValue(Version, hash);
+
+		return hash;
+	}
+
+	std::string TextureSerializer::GetCachePath(u64 sourceHash)
+	{
+		return std::string(s_TextureCacheDirectory) + "/" + Hash::ToString(sourceHash) + ".dds";
+	}
+
+	bool TextureSerializer::Serialize(const TextureImage &image, const std::string &filepath, u64 sourceHash)
+	{
+		const u32 dxgiFormat = GetDXGIFormat(image.compression, image.srgb);
+		if (!dxgiFormat || image.hdr || (image.compression == TextureCompression::None && image.channels != 4))
+			return false;
+
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(filepath).parent_path(), error);
+
+		// Write to a temporary file first so a partially written cache is never picked up
+		std::string temporaryPath = filepath + ".tmp";
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			ME_WARN("Failed to create Texture cache: %s", filepath.c_str());
+			return false;
+		}
+
+		DDSHeader header = {};
+		header.size = sizeof(DDSHeader);
+		header.flags = DDSFlagsCaps | DDSFlagsHeight | DDSFlagsWidth | DDSFlagsPixelFormat | DDSFlagsMipMapCount;
+		header.flags |= image.compression == TextureCompression::None ? DDSFlagsPitch : DDSFlagsLinearSize;
+		header.width = image.width;
+		header.height = image.height;
+		header.pitchOrLinearSize = static_cast<u32>(image.compression == TextureCompression::None ?
+			image.width * 4 : BlockCompression::GetLevelSize(image.compression, image.width, image.height));
+		header.depth = 1;
+		header.mipMapCount = image.levels;
+		header.reserved1[0] = DDSCacheTag;
+		header.reserved1[1] = Version;
+		std::memcpy(&header.reserved1[2], &sourceHash, sizeof(sourceHash));
+		header.pixelFormat.size = sizeof(DDSPixelFormat);
+		header.pixelFormat.flags = DDSPixelFormatFourCC;
+		header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+		header.caps = DDSCapsTexture | (image.levels > 1 ? DDSCapsComplex | DDSCapsMipMap : 0);
+
+		DDSHeaderDX10 headerDX10 = {};
+		headerDX10.dxgiFormat = dxgiFormat;
+		headerDX10.resourceDimension = DDSDimensionTexture2D;
+		headerDX10.arraySize = 1;
+
+		stream.write(reinterpret_cast<const char *>(&DDSMagic), sizeof(DDSMagic));
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char *>(&headerDX10), sizeof(headerDX10));
+		stream.write(reinterpret_cast<const char *>(image.pixels.data()), image.pixels.size());
+
+		bool success = stream.good();
+		stream.close();
+
+		if (success)
+		{
+			std::filesystem::rename(temporaryPath, filepath, error);
+			success = !error;
+		}
+		if (!success)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			ME_WARN("Failed to write Texture cache: %s", filepath.c_str());
+		}
+
+		return success;
+	}
+
+	bool TextureSerializer::Deserialize(TextureImage &image, const std::string &filepath, u64 sourceHash)
+	{
+		MappedFile file;
+		if (!file.Open(filepath))
+			return false;
+
+		const u8 *data = file.GetData();
+		std::size_t size = file.GetSize();
+
+		u32 magic;
+		DDSHeader header;
+		if (size < sizeof(magic) + sizeof(header))
+			return false;
+
+		std::memcpy(&magic, data, sizeof(magic));
+		std::memcpy(&header, data + sizeof(magic), sizeof(header));
+		std::size_t offset = sizeof(magic) + sizeof(header);
+
+		if (magic != DDSMagic || header.size != sizeof(DDSHeader))
+		{
+			ME_WARN("Not a DDS file: %s", filepath.c_str());
+			return false;
+		}
+
+		if (sourceHash)
+		{
+			u64 storedHash;
+			std::memcpy(&storedHash, &header.reserved1[2], sizeof(storedHash));
+			if (header.reserved1[0] != DDSCacheTag || header.reserved1[1] != Version || storedHash != sourceHash)
+			{
+				ME_WARN("Ignoring outdated Texture cache: %s", filepath.c_str());
+				return false;
+			}
+		}
+
+		TextureCompression compression = TextureCompression::None;
+		bool srgb = false;
+		bool supported = false;
+
+		if (!(header.pixelFormat.flags & DDSPixelFormatFourCC))
+		{
+			ME_WARN("Only DDS files with a DX10 header or FourCC format are supported: %s", filepath.c_str());
+			return false;
+		}
+
+		const u32 fourCC = header.pixelFormat.fourCC;
+		if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			DDSHeaderDX10 headerDX10;
+			if (size < offset + sizeof(headerDX10))
+				return false;
+			std::memcpy(&headerDX10, data + offset, sizeof(headerDX10));
+			offset += sizeof(headerDX10);
+
+			for (const auto &format : s_DXGIFormats)
+			{
+				if (format.format == headerDX10.dxgiFormat)
+				{
+					compression = format.compression;
+					srgb = format.srgb;
+					supported = true;
+				}
+			}
+			if (headerDX10.resourceDimension != DDSDimensionTexture2D || headerDX10.arraySize > 1)
+				supported = false;
+		}
+		else
+		{
+			supported = true;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+				compression = TextureCompression::BC1;
+			else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+				compression = TextureCompression::BC3;
+			else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+				compression = TextureCompression::BC4;
+			else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+				compression = TextureCompression::BC5;
+			else
+				supported = false;
+		}
+
+		if (!supported)
+		{
+			ME_WARN("Unsupported DDS format: %s", filepath.c_str());
+			return false;
+		}
+
+		u32 levels = (header.flags & DDSFlagsMipMapCount) ? std::max(header.mipMapCount, 1u) : 1;
+
+		u64 dataSize = 0;
+		for (u32 level = 0; level < levels; level++)
+			dataSize += GetLevelSize(compression, std::max(header.width >> level, 1u), std::max(header.height >> level, 1u));
+
+		if (!header.width || !header.height || offset + dataSize > size)
+		{
+			ME_WARN("Ignoring corrupted DDS file: %s", filepath.c_str());
+			return false;
+		}
+
+		image.pixels.assign(data + offset, data + offset + dataSize);
+		image.width = header.width;
+		image.height = header.height;
+		image.channels = 4;
+		image.hdr = compression == TextureCompression::BC6H;
+		image.srgb = srgb;
+		image.mipmaps = levels > 1;
+		image.compression = compression;
+		image.levels = levels;
+
+		return true;
+	}
+}
\ No newline at end of file
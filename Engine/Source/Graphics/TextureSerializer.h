@@ -0,0 +1,23 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Texture.h"
+
+
+namespace Engine
+{
+	// Block compressed or RGBA8 textures with their whole mip chain, stored as DDS files with a DX10 header.
+	// Cache files are keyed by a hash of the source image and the texture settings, like the mesh cache.
+	class TextureSerializer
+	{
+	public:
+		static constexpr u32 Version = 3;
+
+		static u64 CalculateSourceHash(const std::string &filepath, ConstRef<TextureSettings> settings);
+		static std::string GetCachePath(u64 sourceHash);
+
+		static bool Serialize(const TextureImage &image, const std::string &filepath, u64 sourceHash);
+		// A source hash of 0 accepts any DDS file in a supported format, e.g. ones from external tools
+		static bool Deserialize(TextureImage &image, const std::string &filepath, u64 sourceHash = 0);
+	};
+}
\ No newline at end of file
@@ -55,6 +55,14 @@ namespace Engine
 			case VertexFormat::Float2:  return 2;
 			case VertexFormat::Float3:  return 3;
 			case VertexFormat::Float4:  return 4;
+			case VertexFormat::Half2:   return 2;
+			case VertexFormat::Half4:   return 4;
+			case VertexFormat::Short2:  return 2;
+			case VertexFormat::Short4:  return 4;
+			case VertexFormat::UShort2: return 2;
+			case VertexFormat::UShort4: return 4;
+			case VertexFormat::Int1010102: return 4;
+			case VertexFormat::UInt1:   return 1;
 		}
 
 		ME_ASSERT(false);
@@ -68,6 +76,14 @@ namespace Engine
 			case VertexFormat::Float2:  return 2 * sizeof(float);
 			case VertexFormat::Float3:  return 3 * sizeof(float);
 			case VertexFormat::Float4:  return 4 * sizeof(float);
+			case VertexFormat::Half2:   return 2 * sizeof(u16);
+			case VertexFormat::Half4:   return 4 * sizeof(u16);
+			case VertexFormat::Short2:  return 2 * sizeof(u16);
+			case VertexFormat::Short4:  return 4 * sizeof(u16);
+			case VertexFormat::UShort2: return 2 * sizeof(u16);
+			case VertexFormat::UShort4: return 4 * sizeof(u16);
+			case VertexFormat::Int1010102: return sizeof(u32);
+			case VertexFormat::UInt1:   return sizeof(u32);
 		}
 
 		ME_ASSERT(false);
@@ -81,9 +97,21 @@ namespace Engine
 			case VertexFormat::Float2:  return GL_FLOAT;
 			case VertexFormat::Float3:  return GL_FLOAT;
 			case VertexFormat::Float4:  return GL_FLOAT;
+			case VertexFormat::Half2:   return GL_HALF_FLOAT;
+			case VertexFormat::Half4:   return GL_HALF_FLOAT;
+			case VertexFormat::Short2:  return GL_SHORT;
+			case VertexFormat::Short4:  return GL_SHORT;
+			case VertexFormat::UShort2: return GL_UNSIGNED_SHORT;
+			case VertexFormat::UShort4: return GL_UNSIGNED_SHORT;
+			case VertexFormat::Int1010102: return GL_INT_2_10_10_10_REV;
+			case VertexFormat::UInt1:   return GL_UNSIGNED_INT;
 		}
 
 		ME_ASSERT(false);
 		return 0;
 	}
+	bool Tools::VertexFormatIsInteger(VertexFormat format)
+	{
+		return format == VertexFormat::UInt1;
+	}
 }
\ No newline at end of file
@@ -19,5 +19,6 @@ namespace Engine
 		static u32 VertexFormatToCount(VertexFormat format);
 		static u32 VertexFormatToSize(VertexFormat format);
 		static int VertexFormatToType(VertexFormat format);
+		static bool VertexFormatIsInteger(VertexFormat format);
 	};
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "Graphics/Transform.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/MeshLibrary.h"
 
 #include "Graphics/Camera.h"
 
@@ -33,7 +34,7 @@ namespace Engine
 			mesh = MakeShared<Mesh>();
 		}
 		MeshComponent(const std::string &filepath) {
-			mesh = MakeShared<Mesh>(filepath);
+			mesh = MeshLibrary::Load(filepath);
 		}
 	};
 
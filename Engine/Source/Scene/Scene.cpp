@@ -4,6 +4,8 @@
 #include "Entity.h"
 #include "Components.h"
 
+#include <limits>
+
 // Box2D
 #include <box2d/box2d.h>
 #include <box2d/b2_world.h>
@@ -93,6 +95,94 @@ namespace Engine
 		return ent;
 	}
 
+	void Scene::UpdateRaycastBVH()
+	{
+		// Components are edited in place, so changes are found by comparing against the cached
+		// instances. The SAH build and the inverse transforms only run for what actually changed.
+		bool rebuild = false;
+		bool refit = false;
+		u32 count = 0;
+
+		auto view = m_Registry.view<TransformComponent, MeshComponent>();
+		for (auto entity : view)
+		{
+			auto [tc, mc] = view.get<TransformComponent, MeshComponent>(entity);
+			if (!mc.mesh || !mc.mesh->IsLoaded())
+				continue;
+
+			const glm::mat4 &transform = tc.transform.GetTransform();
+			const AABB &meshBounds = mc.mesh->GetBoundingBox();
+
+			if (count == m_RaycastInstances.size())
+			{
+				m_RaycastInstances.emplace_back();
+				m_RaycastBounds.emplace_back();
+			}
+
+			RaycastInstance &instance = m_RaycastInstances[count];
+			AABB &bounds = m_RaycastBounds[count];
+			count++;
+
+			if (instance.entity == entity && instance.mesh == mc.mesh.get() && instance.transform == transform &&
+				instance.meshBounds.min == meshBounds.min && instance.meshBounds.max == meshBounds.max)
+				continue;
+
+			// The same instance moving only needs new bounds, a different one changes the tree
+			if (instance.entity == entity)
+				refit = true;
+			else
+				rebuild = true;
+
+			instance.entity = entity;
+			instance.mesh = mc.mesh.get();
+			instance.meshBounds = meshBounds;
+			instance.transform = transform;
+			instance.inverseTransform = glm::inverse(transform);
+			bounds = Math::TransformAABB(meshBounds, transform);
+		}
+
+		if (count != m_RaycastInstances.size())
+		{
+			m_RaycastInstances.resize(count);
+			m_RaycastBounds.resize(count);
+			rebuild = true;
+		}
+
+		if (rebuild)
+			m_RaycastBVH.Build(m_RaycastBounds);
+		else if (refit)
+			m_RaycastBVH.Refit(m_RaycastBounds);
+	}
+
+	bool Scene::Raycast(const Ray &ray, RaycastHit &hit)
+	{
+		UpdateRaycastBVH();
+
+		const auto &order = m_RaycastBVH.GetPrimitiveIndices();
+		float closestDistance = std::numeric_limits<float>::max();
+
+		return m_RaycastBVH.Traverse(ray, closestDistance, [&](u32 slot, float &distance)
+			{
+				const RaycastInstance &instance = m_RaycastInstances[order[slot]];
+
+				// The direction is not renormalized, so distances stay comparable between instances
+				Ray meshRay = {
+					instance.inverseTransform * glm::vec4(ray.origin, 1.0f),
+					glm::mat3(instance.inverseTransform) * ray.direction
+				};
+
+				u32 subMeshIndex, triangleIndex;
+				if (!instance.mesh->Raycast(meshRay, distance, subMeshIndex, triangleIndex))
+					return false;
+
+				hit.entity = instance.entity;
+				hit.subMeshIndex = subMeshIndex;
+				hit.triangleIndex = triangleIndex;
+				hit.distance = distance;
+				return true;
+			});
+	}
+
 	void Scene::SetupPhysicsSimulation()
 	{
 		m_PhysicsWorld = new b2World({ 0.0f, -9.81f });
@@ -1,6 +1,7 @@
 #pragma once
 #include "Core/EngineBase.h"
 #include "Core/Event.h"
+#include "Util/BVH.h"
 
 #include <glm/glm.hpp>
 #include <entt/entt.hpp>
@@ -14,6 +15,7 @@ namespace Engine
 {
 	class TextureCube;
 	class Texture;
+	class Mesh;
 
 	struct DirectionalLight
 	{
@@ -34,6 +36,15 @@ namespace Engine
 	};
 
 
+	struct RaycastHit
+	{
+		entt::entity entity { entt::null };
+		u32 subMeshIndex = 0;
+		u32 triangleIndex = 0;		// Within the sub mesh
+		float distance = 0.0f;		// In units of the ray direction
+	};
+
+
 	class Entity;
 
 	class Scene
@@ -54,17 +65,39 @@ namespace Engine
 		const entt::registry& GetRegistry() const { return m_Registry; }
 		entt::registry &GetRegistry() { return m_Registry; }
 
+		// Closest mesh triangle hit by a world space ray
+		bool Raycast(const Ray &ray, RaycastHit &hit);
+
 		void SetupPhysicsSimulation();
 		void OnUpdate(float delta);
 
 	private:
 		void CopyRegistry(entt::registry& from, entt::registry& to);
 
+		// Brings the raycast BVH up to date with the mesh instances
+		void UpdateRaycastBVH();
+
 	public:
 		Environment environment;
 
 	private:
 		entt::registry m_Registry;
 		b2World* m_PhysicsWorld { nullptr };
+
+		// What the raycast BVH was last built or refit from
+		struct RaycastInstance
+		{
+			entt::entity entity { entt::null };
+			const Mesh *mesh = nullptr;
+			AABB meshBounds;					// Changes when the mesh is reloaded
+			glm::mat4 transform { 1.0f };
+			glm::mat4 inverseTransform { 1.0f };
+		};
+
+		// Over the world bounds of every loaded mesh instance, refit when instances move
+		// and rebuilt when they are added, removed or reordered
+		BVH m_RaycastBVH;
+		std::vector<AABB> m_RaycastBounds;			// Indexed like m_RaycastInstances
+		std::vector<RaycastInstance> m_RaycastInstances;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "Precompiled.h"
+#include "BVH.h"
+
+#include <limits>
+
+
+namespace Engine
+{
+	static constexpr u32 BinCount = 12;
+
+	static float SurfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+	{
+		glm::vec3 extent = boundsMax - boundsMin;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	void BVH::Build(const std::vector<AABB> &primitiveBounds)
+	{
+		Clear();
+
+		const u32 primitiveCount = static_cast<u32>(primitiveBounds.size());
+		if (primitiveCount == 0)
+			return;
+
+		std::vector<glm::vec3> centroids(primitiveCount);
+		m_PrimitiveIndices.resize(primitiveCount);
+		for (u32 i = 0; i < primitiveCount; i++)
+		{
+			centroids[i] = primitiveBounds[i].GetCenter();
+			m_PrimitiveIndices[i] = i;
+		}
+
+		// A binary tree with single primitive leaves has at most 2n - 1 nodes
+		m_Nodes.reserve(static_cast<std::size_t>(primitiveCount) * 2);
+
+		BVHNode root;
+		root.leftFirst = 0;
+		root.primitiveCount = primitiveCount;
+		m_Nodes.push_back(root);
+
+		UpdateBounds(0, primitiveBounds);
+		Subdivide(primitiveBounds, centroids);
+
+		m_Nodes.shrink_to_fit();
+	}
+
+	void BVH::Refit(const std::vector<AABB> &primitiveBounds)
+	{
+		ME_ASSERT(primitiveBounds.size() == m_PrimitiveIndices.size());
+
+		// Children are always stored after their parent, so walking backwards visits them first
+		for (u32 nodeIndex = static_cast<u32>(m_Nodes.size()); nodeIndex-- > 0;)
+		{
+			BVHNode &node = m_Nodes[nodeIndex];
+			if (node.IsLeaf())
+			{
+				UpdateBounds(nodeIndex, primitiveBounds);
+				continue;
+			}
+
+			const BVHNode &left = m_Nodes[node.leftFirst];
+			const BVHNode &right = m_Nodes[node.leftFirst + 1];
+			node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		}
+	}
+
+	void BVH::Clear()
+	{
+		m_Nodes.clear();
+		m_PrimitiveIndices.clear();
+	}
+
+	float BVH::IntersectBounds(const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+		const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float closestDistance)
+	{
+		glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+		glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+
+		glm::vec3 tMin = glm::min(t0, t1);
+		glm::vec3 tMax = glm::max(t0, t1);
+
+		float entry = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+		float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, closestDistance));
+
+		return entry <= exit ? entry : -1.0f;
+	}
+
+	void BVH::UpdateBounds(u32 nodeIndex, const std::vector<AABB> &primitiveBounds)
+	{
+		BVHNode &node = m_Nodes[nodeIndex];
+		node.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		node.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+		for (u32 i = 0; i < node.primitiveCount; i++)
+		{
+			const AABB &bounds = primitiveBounds[m_PrimitiveIndices[node.leftFirst + i]];
+			node.boundsMin = glm::min(node.boundsMin, bounds.min);
+			node.boundsMax = glm::max(node.boundsMax, bounds.max);
+		}
+	}
+
+	void BVH::Subdivide(const std::vector<AABB> &primitiveBounds, const std::vector<glm::vec3> &centroids)
+	{
+		// Iterative, so skewed inputs can't overflow the call stack either
+		struct PendingNode
+		{
+			u32 nodeIndex;
+			u32 depth;
+		};
+		std::vector<PendingNode> pending = { { 0, 0 } };
+
+		while (!pending.empty())
+		{
+			PendingNode node = pending.back();
+			pending.pop_back();
+
+			if (node.depth >= MaxDepth || !Split(node.nodeIndex, primitiveBounds, centroids))
+				continue;
+
+			const u32 leftIndex = m_Nodes[node.nodeIndex].leftFirst;
+			pending.push_back({ leftIndex + 1, node.depth + 1 });
+			pending.push_back({ leftIndex, node.depth + 1 });
+		}
+	}
+
+	bool BVH::Split(u32 nodeIndex, const std::vector<AABB> &primitiveBounds, const std::vector<glm::vec3> &centroids)
+	{
+		const u32 first = m_Nodes[nodeIndex].leftFirst;
+		const u32 count = m_Nodes[nodeIndex].primitiveCount;
+
+		if (count <= 2)
+			return false;
+
+		// Bin the centroids along each axis and evaluate the surface area heuristic at every bin boundary
+		glm::vec3 centroidMin = centroids[m_PrimitiveIndices[first]];
+		glm::vec3 centroidMax = centroidMin;
+		for (u32 i = 1; i < count; i++)
+		{
+			centroidMin = glm::min(centroidMin, centroids[m_PrimitiveIndices[first + i]]);
+			centroidMax = glm::max(centroidMax, centroids[m_PrimitiveIndices[first + i]]);
+		}
+
+		int bestAxis = -1;
+		u32 bestSplit = 0;
+		float bestCost = std::numeric_limits<float>::max();
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.0f)
+				continue;
+
+			struct Bin
+			{
+				glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+				glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+				u32 count = 0;
+			} bins[BinCount];
+
+			const float scale = BinCount / extent;
+			for (u32 i = 0; i < count; i++)
+			{
+				const u32 primitive = m_PrimitiveIndices[first + i];
+				u32 bin = glm::min(BinCount - 1, static_cast<u32>((centroids[primitive][axis] - centroidMin[axis]) * scale));
+
+				bins[bin].count++;
+				bins[bin].boundsMin = glm::min(bins[bin].boundsMin, primitiveBounds[primitive].min);
+				bins[bin].boundsMax = glm::max(bins[bin].boundsMax, primitiveBounds[primitive].max);
+			}
+
+			// Sweep from both sides to get the area and count left/right of every plane
+			float leftArea[BinCount - 1], rightArea[BinCount - 1];
+			u32 leftCount[BinCount - 1], rightCount[BinCount - 1];
+
+			glm::vec3 leftMin = bins[0].boundsMin, leftMax = bins[0].boundsMax;
+			glm::vec3 rightMin = bins[BinCount - 1].boundsMin, rightMax = bins[BinCount - 1].boundsMax;
+			u32 leftSum = 0, rightSum = 0;
+
+			for (u32 i = 0; i < BinCount - 1; i++)
+			{
+				leftSum += bins[i].count;
+				leftMin = glm::min(leftMin, bins[i].boundsMin);
+				leftMax = glm::max(leftMax, bins[i].boundsMax);
+				leftCount[i] = leftSum;
+				leftArea[i] = leftSum ? SurfaceArea(leftMin, leftMax) : 0.0f;
+
+				const u32 j = BinCount - 1 - i;
+				rightSum += bins[j].count;
+				rightMin = glm::min(rightMin, bins[j].boundsMin);
+				rightMax = glm::max(rightMax, bins[j].boundsMax);
+				rightCount[j - 1] = rightSum;
+				rightArea[j - 1] = rightSum ? SurfaceArea(rightMin, rightMax) : 0.0f;
+			}
+
+			for (u32 i = 0; i < BinCount - 1; i++)
+			{
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		// Splitting has to beat intersecting everything in one leaf
+		const BVHNode &node = m_Nodes[nodeIndex];
+		const float leafCost = count * SurfaceArea(node.boundsMin, node.boundsMax);
+		if (bestAxis < 0 || (bestCost >= leafCost && count <= MaxLeafPrimitives))
+			return false;
+
+		const float scale = BinCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		auto middle = std::partition(m_PrimitiveIndices.begin() + first, m_PrimitiveIndices.begin() + first + count,
+			[&](u32 primitive)
+			{
+				u32 bin = glm::min(BinCount - 1, static_cast<u32>((centroids[primitive][bestAxis] - centroidMin[bestAxis]) * scale));
+				return bin <= bestSplit;
+			});
+
+		const u32 leftCount = static_cast<u32>(middle - (m_PrimitiveIndices.begin() + first));
+		if (leftCount == 0 || leftCount == count)
+			return false;
+
+		const u32 leftIndex = static_cast<u32>(m_Nodes.size());
+
+		BVHNode left;
+		left.leftFirst = first;
+		left.primitiveCount = leftCount;
+		m_Nodes.push_back(left);
+
+		BVHNode right;
+		right.leftFirst = first + leftCount;
+		right.primitiveCount = count - leftCount;
+		m_Nodes.push_back(right);
+
+		m_Nodes[nodeIndex].leftFirst = leftIndex;
+		m_Nodes[nodeIndex].primitiveCount = 0;
+
+		UpdateBounds(leftIndex, primitiveBounds);
+		UpdateBounds(leftIndex + 1, primitiveBounds);
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include "Math.h"
+
+#include <vector>
+
+
+namespace Engine
+{
+	// 32 bytes, two nodes per cache line. Interior nodes store the index of their
+	// left child (the right one follows it), leaves the first primitive and a count.
+	struct BVHNode
+	{
+		glm::vec3 boundsMin;
+		u32 leftFirst;
+		glm::vec3 boundsMax;
+		u32 primitiveCount;
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	// Bounding volume hierarchy over arbitrary primitives, built with binned SAH.
+	// Primitives are referenced by their position in GetPrimitiveIndices(), so callers
+	// can store their own data in that order and keep leaves contiguous in memory.
+	class BVH
+	{
+	public:
+		static constexpr u32 MaxLeafPrimitives = 4;
+		// Nodes this deep become leaves however many primitives they hold, which bounds
+		// the traversal stack no matter how skewed the primitives are distributed
+		static constexpr u32 MaxDepth = 64;
+
+	public:
+		void Build(const std::vector<AABB> &primitiveBounds);
+		// Recomputes the node bounds for moved primitives and keeps the tree as it is,
+		// primitiveBounds has to hold the same primitives in the same order as in Build()
+		void Refit(const std::vector<AABB> &primitiveBounds);
+		void Clear();
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+
+		const std::vector<BVHNode> &GetNodes() const { return m_Nodes; }
+		// Maps a sorted primitive slot back to its index in the Build input
+		const std::vector<u32> &GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+		// Visits leaves front to back and skips nodes further away than closestDistance.
+		// intersect(u32 slot, float &closestDistance) tests one primitive, shrinks
+		// closestDistance on a hit and returns true.
+		template<typename IntersectFunction>
+		bool Traverse(const Ray &ray, float &closestDistance, IntersectFunction &&intersect) const;
+
+		// Same, but intersectLeaf(u32 firstSlot, u32 count, float &closestDistance) gets a whole leaf
+		// at once so it can hand the primitives to a batched kernel
+		template<typename IntersectFunction>
+		bool TraverseLeaves(const Ray &ray, float &closestDistance, IntersectFunction &&intersectLeaf) const;
+
+		// Slab test, returns the entry distance or a negative value on a miss
+		static float IntersectBounds(const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+			const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float closestDistance);
+
+	private:
+		void Subdivide(const std::vector<AABB> &primitiveBounds, const std::vector<glm::vec3> &centroids);
+		// Returns false if the node stays a leaf
+		bool Split(u32 nodeIndex, const std::vector<AABB> &primitiveBounds, const std::vector<glm::vec3> &centroids);
+		void UpdateBounds(u32 nodeIndex, const std::vector<AABB> &primitiveBounds);
+
+	private:
+		std::vector<BVHNode> m_Nodes;
+		std::vector<u32> m_PrimitiveIndices;
+	};
+
+	template<typename IntersectFunction>
+	bool BVH::Traverse(const Ray &ray, float &closestDistance, IntersectFunction &&intersect) const
+	{
+		return TraverseLeaves(ray, closestDistance, [&](u32 firstSlot, u32 count, float &distance)
+			{
+				bool hit = false;
+				for (u32 i = 0; i < count; i++)
+					hit |= intersect(firstSlot + i, distance);
+				return hit;
+			});
+	}
+
+	template<typename IntersectFunction>
+	bool BVH::TraverseLeaves(const Ray &ray, float &closestDistance, IntersectFunction &&intersectLeaf) const
+	{
+		if (m_Nodes.empty())
+			return false;
+
+		const glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+		if (IntersectBounds(ray.origin, inverseDirection, m_Nodes[0].boundsMin, m_Nodes[0].boundsMax, closestDistance) < 0.0f)
+			return false;
+
+		// Holds at most one node per level, see MaxDepth
+		u32 stack[MaxDepth];
+		u32 stackSize = 0;
+		u32 nodeIndex = 0;
+		bool hit = false;
+
+		while (true)
+		{
+			const BVHNode &node = m_Nodes[nodeIndex];
+
+			if (node.IsLeaf())
+			{
+				hit |= intersectLeaf(node.leftFirst, node.primitiveCount, closestDistance);
+
+				if (stackSize == 0)
+					break;
+				nodeIndex = stack[--stackSize];
+				continue;
+			}
+
+			u32 nearIndex = node.leftFirst;
+			u32 farIndex = node.leftFirst + 1;
+
+			float nearDistance = IntersectBounds(ray.origin, inverseDirection, m_Nodes[nearIndex].boundsMin, m_Nodes[nearIndex].boundsMax, closestDistance);
+			float farDistance = IntersectBounds(ray.origin, inverseDirection, m_Nodes[farIndex].boundsMin, m_Nodes[farIndex].boundsMax, closestDistance);
+
+			if (farDistance >= 0.0f && (nearDistance < 0.0f || farDistance < nearDistance))
+			{
+				std::swap(nearIndex, farIndex);
+				std::swap(nearDistance, farDistance);
+			}
+
+			if (nearDistance < 0.0f)
+			{
+				// Neither child is hit
+				if (stackSize == 0)
+					break;
+				nodeIndex = stack[--stackSize];
+				continue;
+			}
+
+			if (farDistance >= 0.0f)
+			{
+				ME_ASSERT(stackSize < MaxDepth);
+				stack[stackSize++] = farIndex;
+			}
+
+			nodeIndex = nearIndex;
+		}
+
+		return hit;
+	}
+}
\ No newline at end of file
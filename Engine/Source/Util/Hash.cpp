@@ -0,0 +1,52 @@
+#include "Precompiled.h"
+#include "Hash.h"
+
+#include <fstream>
+#include <cstdio>
+
+
+namespace Engine
+{
+	u64 Hash::FNV1a(const void *data, std::size_t size, u64 seed)
+	{
+		const u8 *bytes = static_cast<const u8 *>(data);
+		u64 hash = seed;
+
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV1aPrime;
+		}
+
+		return hash;
+	}
+	u64 Hash::FNV1a(const std::string &string, u64 seed)
+	{
+		return FNV1a(string.data(), string.size(), seed);
+	}
+
+	u64 Hash::File(const std::string &filepath, u64 seed)
+	{
+		std::ifstream stream(filepath, std::ios::binary);
+		if (!stream)
+			return 0;
+
+		u64 hash = seed;
+		std::vector<char> buffer(64 * 1024);
+
+		while (stream)
+		{
+			stream.read(buffer.data(), buffer.size());
+			hash = FNV1a(buffer.data(), static_cast<std::size_t>(stream.gcount()), hash);
+		}
+
+		return hash;
+	}
+
+	std::string Hash::ToString(u64 hash)
+	{
+		char buffer[17];
+		std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+		return std::string(buffer);
+	}
+}
\ No newline at end of file
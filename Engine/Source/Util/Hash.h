@@ -0,0 +1,30 @@
+#pragma once
+#include "Core/EngineBase.h"
+
+#include <string>
+
+
+namespace Engine
+{
+	class Hash
+	{
+	public:
+		static constexpr u64 FNV1aOffsetBasis = 0xcbf29ce484222325ull;
+		static constexpr u64 FNV1aPrime = 0x100000001b3ull;
+
+		// 64 bit FNV-1a, pass a previous result as seed to combine several inputs
+		static u64 FNV1a(const void *data, std::size_t size, u64 seed = FNV1aOffsetBasis);
+		static u64 FNV1a(const std::string &string, u64 seed = FNV1aOffsetBasis);
+
+		template<typename Type>
+		static u64 FNV1aValue(const Type &value, u64 seed = FNV1aOffsetBasis)
+		{
+			return FNV1a(&value, sizeof(Type), seed);
+		}
+
+		// Hashes the contents of a file, returns 0 if the file can't be read
+		static u64 File(const std::string &filepath, u64 seed = FNV1aOffsetBasis);
+
+		static std::string ToString(u64 hash);
+	};
+}
\ No newline at end of file
@@ -1,7 +1,26 @@
 #include "Precompiled.h"
 #include "Math.h"
 
-#include "Graphics/Mesh.h"
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__)
+	#include <xmmintrin.h>
+	#define ME_MATH_SSE
+#endif
+
+// AVX2 and AVX-512 kernels are compiled on x64 regardless of the target flags and only run when the CPU has them
+#if defined(_M_X64) || defined(__x86_64__)
+	#include <immintrin.h>
+	#define ME_MATH_AVX2
+	#define ME_MATH_AVX512
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define ME_TARGET_AVX2
+		#define ME_TARGET_AVX512
+	#else
+		#define ME_TARGET_AVX2 __attribute__((target("avx2")))
+		#define ME_TARGET_AVX512 __attribute__((target("avx512f")))
+	#endif
+#endif
 
 
 namespace Engine
@@ -9,13 +28,9 @@ namespace Engine
 	// Checks if ray intersects with triangle by using the MllerTrumbore intersection algorithm
 	// Wikipedia: https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm 
 
-	bool Math::RayIntersectsTriangle(Ray ray, Triangle triangle, float &distance)
+	bool Math::RayIntersectsTriangle(const Ray &ray, const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2, float &t)
 	{
-		constexpr float EPSILON = 0.0000001;
-
-		glm::vec3 vertex0 = triangle.v1.position;
-		glm::vec3 vertex1 = triangle.v2.position;
-		glm::vec3 vertex2 = triangle.v3.position;
+		constexpr float EPSILON = 0.0000001f;
 
 		glm::vec3 edge1, edge2, h, s, q;
 		float a, f, u, v;
@@ -30,29 +45,822 @@ namespace Engine
 		if (a > -EPSILON && a < EPSILON)
 			return false;
 
-		f = 1.0 / a;
+		f = 1.0f / a;
 		s = ray.origin - vertex0;
 		u = f * glm::dot(s, h);
 
-		if (u < 0.0 || u > 1.0)
+		if (u < 0.0f || u > 1.0f)
 			return false;
 
 		q = glm::cross(s, edge1);
 		v = f * glm::dot(ray.direction, q);
 
-		if (v < 0.0 || u + v > 1.0)
+		if (v < 0.0f || u + v > 1.0f)
 			return false;
 
 		// at this stage we can compute t to find out where the intersection point is on the line.
-		float t = f * glm::dot(edge2, q);
+		t = f * glm::dot(edge2, q);
 
-		// ray intersection
-		if (t > EPSILON) {
-			distance = glm::length(ray.origin + ray.direction * t);
-			return true;
-		}
 		// This means that there is a line intersection but not a ray intersection.
-		else
+		return t > EPSILON;
+	}
+
+	void AABBBatch::Clear()
+	{
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+	}
+	void AABBBatch::Add(const AABB &box)
+	{
+		glm::vec3 center = box.GetCenter();
+		glm::vec3 extents = box.GetExtents();
+
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		extentX.push_back(extents.x); extentY.push_back(extents.y); extentZ.push_back(extents.z);
+	}
+
+	Frustum Math::ExtractFrustum(const glm::mat4 &projectionView)
+	{
+		// Rows of the matrix (glm is column major)
+		glm::vec4 row0 = { projectionView[0][0], projectionView[1][0], projectionView[2][0], projectionView[3][0] };
+		glm::vec4 row1 = { projectionView[0][1], projectionView[1][1], projectionView[2][1], projectionView[3][1] };
+		glm::vec4 row2 = { projectionView[0][2], projectionView[1][2], projectionView[2][2], projectionView[3][2] };
+		glm::vec4 row3 = { projectionView[0][3], projectionView[1][3], projectionView[2][3], projectionView[3][3] };
+
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0;	// Left
+		frustum.planes[1] = row3 - row0;	// Right
+		frustum.planes[2] = row3 + row1;	// Bottom
+		frustum.planes[3] = row3 - row1;	// Top
+		frustum.planes[4] = row3 + row2;	// Near
+		frustum.planes[5] = row3 - row2;	// Far
+
+		for (auto &plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return frustum;
+	}
+
+	AABB Math::TransformAABB(const AABB &box, const glm::mat4 &transform)
+	{
+		// Arvo: the new extents are the old ones projected onto the absolute basis vectors
+		glm::vec3 center = glm::vec3(transform * glm::vec4(box.GetCenter(), 1.0f));
+		glm::vec3 extents = box.GetExtents();
+
+		glm::mat3 absolute = glm::mat3(transform);
+		for (int i = 0; i < 3; i++)
+			absolute[i] = glm::abs(absolute[i]);
+
+		glm::vec3 newExtents = absolute * extents;
+		return { center - newExtents, center + newExtents };
+	}
+
+	BoundingSphere Math::TransformSphere(const BoundingSphere &sphere, const glm::mat4 &transform)
+	{
+		float maxScale = glm::max(glm::length(glm::vec3(transform[0])),
+			glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		return { glm::vec3(transform * glm::vec4(sphere.center, 1.0f)), sphere.radius * maxScale };
+	}
+
+	bool Math::IsSphereVisible(const Frustum &frustum, const BoundingSphere &sphere)
+	{
+		for (const auto &plane : frustum.planes)
+		{
+			if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool Math::IsAABBVisible(const Frustum &frustum, const AABB &box)
+	{
+		glm::vec3 center = box.GetCenter();
+		glm::vec3 extents = box.GetExtents();
+
+		for (const auto &plane : frustum.planes)
+		{
+			float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+			float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+
+			if (distance + radius < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	void Math::CullAABBs(const Frustum &frustum, const AABBBatch &batch, std::vector<u8> &visibility)
+	{
+		visibility.resize(batch.GetCount());
+		CullAABBs(frustum, batch, 0, batch.GetCount(), visibility.data());
+	}
+
+	void Math::CullAABBs(const Frustum &frustum, const AABBBatch &batch, u32 begin, u32 end, u8 *visibility)
+	{
+		const u32 count = end;
+		u32 i = begin;
+
+#ifdef ME_MATH_SSE
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		__m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+		for (int p = 0; p < 6; p++)
+		{
+			const auto &plane = frustum.planes[p];
+			planeX[p] = _mm_set1_ps(plane.x);
+			planeY[p] = _mm_set1_ps(plane.y);
+			planeZ[p] = _mm_set1_ps(plane.z);
+			planeW[p] = _mm_set1_ps(plane.w);
+			absPlaneX[p] = _mm_set1_ps(glm::abs(plane.x));
+			absPlaneY[p] = _mm_set1_ps(glm::abs(plane.y));
+			absPlaneZ[p] = _mm_set1_ps(glm::abs(plane.z));
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 centerX = _mm_loadu_ps(&batch.centerX[i]);
+			__m128 centerY = _mm_loadu_ps(&batch.centerY[i]);
+			__m128 centerZ = _mm_loadu_ps(&batch.centerZ[i]);
+			__m128 extentX = _mm_loadu_ps(&batch.extentX[i]);
+			__m128 extentY = _mm_loadu_ps(&batch.extentY[i]);
+			__m128 extentZ = _mm_loadu_ps(&batch.extentZ[i]);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);	// All bits set
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absPlaneX[p], extentX), _mm_mul_ps(absPlaneY[p], extentY)),
+					_mm_mul_ps(absPlaneZ[p], extentZ));
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			visibility[i + 0] = (mask >> 0) & 1;
+			visibility[i + 1] = (mask >> 1) & 1;
+			visibility[i + 2] = (mask >> 2) & 1;
+			visibility[i + 3] = (mask >> 3) & 1;
+		}
+#endif
+
+		// Remainder (or everything without SSE)
+		for (; i < count; i++)
+		{
+			glm::vec3 center = { batch.centerX[i], batch.centerY[i], batch.centerZ[i] };
+			glm::vec3 extents = { batch.extentX[i], batch.extentY[i], batch.extentZ[i] };
+
+			visibility[i] = IsAABBVisible(frustum, { center - extents, center + extents }) ? 1 : 0;
+		}
+	}
+
+	void TriangleBatch::Clear()
+	{
+		vertexX.clear(); vertexY.clear(); vertexZ.clear();
+		edge1X.clear(); edge1Y.clear(); edge1Z.clear();
+		edge2X.clear(); edge2Y.clear(); edge2Z.clear();
+	}
+	void TriangleBatch::Add(const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2)
+	{
+		glm::vec3 edge1 = vertex1 - vertex0;
+		glm::vec3 edge2 = vertex2 - vertex0;
+
+		vertexX.push_back(vertex0.x); vertexY.push_back(vertex0.y); vertexZ.push_back(vertex0.z);
+		edge1X.push_back(edge1.x); edge1Y.push_back(edge1.y); edge1Z.push_back(edge1.z);
+		edge2X.push_back(edge2.x); edge2Y.push_back(edge2.y); edge2Z.push_back(edge2.z);
+	}
+
+	static constexpr float TriangleEpsilon = 0.0000001f;
+
+	static bool CPUSupportsAVX2()
+	{
+#if defined(ME_MATH_AVX2) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The OS has to save the ymm registers as well
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif defined(ME_MATH_AVX2)
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	static bool CPUSupportsAVX512()
+	{
+#if defined(ME_MATH_AVX512) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The OS has to save the opmask and full zmm registers as well
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 0xE6) != 0xE6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 16)) != 0;
+#elif defined(ME_MATH_AVX512)
+		return __builtin_cpu_supports("avx512f");
+#else
+		return false;
+#endif
+	}
+
+	static SIMDLevel DetectSIMDLevel()
+	{
+		if (CPUSupportsAVX512())
+			return SIMDLevel::AVX512;
+		if (CPUSupportsAVX2())
+			return SIMDLevel::AVX2;
+#ifdef ME_MATH_SSE
+		return SIMDLevel::SSE;
+#else
+		return SIMDLevel::Scalar;
+#endif
+	}
+
+	static const SIMDLevel s_SupportedSIMDLevel = DetectSIMDLevel();
+	static SIMDLevel s_SIMDLevel = s_SupportedSIMDLevel;
+
+	SIMDLevel Math::GetSIMDLevel()
+	{
+		return s_SIMDLevel;
+	}
+	SIMDLevel Math::GetSupportedSIMDLevel()
+	{
+		return s_SupportedSIMDLevel;
+	}
+	void Math::SetSIMDLevel(SIMDLevel level)
+	{
+		s_SIMDLevel = level < s_SupportedSIMDLevel ? level : s_SupportedSIMDLevel;
+	}
+	const char *Math::GetSIMDLevelName(SIMDLevel level)
+	{
+		switch (level)
+		{
+		case SIMDLevel::Scalar: return "Scalar";
+		case SIMDLevel::SSE:    return "SSE";
+		case SIMDLevel::AVX2:   return "AVX2";
+		case SIMDLevel::AVX512: return "AVX-512";
+		}
+		return "Unknown";
+	}
+
+	// Tests triangles [first, count) one at a time
+	static bool IntersectTrianglesScalar(const Ray &ray, const TriangleBatch &batch, u32 first, TriangleHit &hit)
+	{
+		bool found = false;
+
+		for (u32 i = first; i < batch.GetCount(); i++)
+		{
+			glm::vec3 vertex0 = { batch.vertexX[i], batch.vertexY[i], batch.vertexZ[i] };
+			glm::vec3 edge1 = { batch.edge1X[i], batch.edge1Y[i], batch.edge1Z[i] };
+			glm::vec3 edge2 = { batch.edge2X[i], batch.edge2Y[i], batch.edge2Z[i] };
+
+			glm::vec3 h = glm::cross(ray.direction, edge2);
+			float a = glm::dot(edge1, h);
+			if (a > -TriangleEpsilon && a < TriangleEpsilon)
+				continue;
+
+			float f = 1.0f / a;
+			glm::vec3 s = ray.origin - vertex0;
+			float u = f * glm::dot(s, h);
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = f * glm::dot(ray.direction, q);
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float t = f * glm::dot(edge2, q);
+			if (t <= TriangleEpsilon || t >= hit.t)
+				continue;
+
+			hit = { t, u, v, i };
+			found = true;
+		}
+
+		return found;
+	}
+
+#ifdef ME_MATH_SSE
+	static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Moller-Trumbore on 4 lanes, any mix of broadcast and per lane inputs.
+	// Returns the mask of lanes that hit in front of the ray and nearer than maxT
+	static inline __m128 IntersectLanes(
+		__m128 originX, __m128 originY, __m128 originZ, __m128 directionX, __m128 directionY, __m128 directionZ,
+		__m128 vertexX, __m128 vertexY, __m128 vertexZ, __m128 edge1X, __m128 edge1Y, __m128 edge1Z,
+		__m128 edge2X, __m128 edge2Y, __m128 edge2Z, __m128 maxT, __m128 &t, __m128 &u, __m128 &v)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 epsilon = _mm_set1_ps(TriangleEpsilon);
+		const __m128 negativeEpsilon = _mm_set1_ps(-TriangleEpsilon);
+
+		__m128 hX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+		__m128 hY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+		__m128 hZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+
+		__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, hX), _mm_mul_ps(edge1Y, hY)), _mm_mul_ps(edge1Z, hZ));
+		__m128 f = _mm_div_ps(one, a);
+
+		__m128 sX = _mm_sub_ps(originX, vertexX);
+		__m128 sY = _mm_sub_ps(originY, vertexY);
+		__m128 sZ = _mm_sub_ps(originZ, vertexZ);
+		u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, hX), _mm_mul_ps(sY, hY)), _mm_mul_ps(sZ, hZ)));
+
+		__m128 qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+		__m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+		__m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+		v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)));
+		t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)));
+
+		// NaNs from parallel triangles fail every ordered compare
+		__m128 mask = _mm_or_ps(_mm_cmpgt_ps(a, epsilon), _mm_cmplt_ps(a, negativeEpsilon));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, maxT)));
+		return mask;
+	}
+
+	// One ray against 4 triangles per iteration, advances first past the processed triangles
+	static bool IntersectTrianglesSSE(const Ray &ray, const TriangleBatch &batch, u32 &first, TriangleHit &hit)
+	{
+		const u32 count = batch.GetCount();
+		if (first + 4 > count)
 			return false;
+
+		const __m128 originX = _mm_set1_ps(ray.origin.x), originY = _mm_set1_ps(ray.origin.y), originZ = _mm_set1_ps(ray.origin.z);
+		const __m128 directionX = _mm_set1_ps(ray.direction.x), directionY = _mm_set1_ps(ray.direction.y), directionZ = _mm_set1_ps(ray.direction.z);
+
+		__m128 bestT = _mm_set1_ps(hit.t);
+		__m128 bestU = _mm_setzero_ps(), bestV = _mm_setzero_ps();
+		__m128 bestIndex = _mm_set1_ps(-1.0f);
+
+		// Indices are tracked as floats, exact for any batch below 2^24 triangles
+		__m128 index = _mm_setr_ps(float(first), float(first + 1), float(first + 2), float(first + 3));
+		const __m128 step = _mm_set1_ps(4.0f);
+
+		u32 i = first;
+		for (; i + 4 <= count; i += 4, index = _mm_add_ps(index, step))
+		{
+			__m128 t, u, v;
+			__m128 mask = IntersectLanes(originX, originY, originZ, directionX, directionY, directionZ,
+				_mm_loadu_ps(&batch.vertexX[i]), _mm_loadu_ps(&batch.vertexY[i]), _mm_loadu_ps(&batch.vertexZ[i]),
+				_mm_loadu_ps(&batch.edge1X[i]), _mm_loadu_ps(&batch.edge1Y[i]), _mm_loadu_ps(&batch.edge1Z[i]),
+				_mm_loadu_ps(&batch.edge2X[i]), _mm_loadu_ps(&batch.edge2Y[i]), _mm_loadu_ps(&batch.edge2Z[i]),
+				bestT, t, u, v);
+
+			bestT = Select(mask, t, bestT);
+			bestU = Select(mask, u, bestU);
+			bestV = Select(mask, v, bestV);
+			bestIndex = Select(mask, index, bestIndex);
+		}
+		first = i;
+
+		alignas(16) float laneT[4], laneU[4], laneV[4], laneIndex[4];
+		_mm_store_ps(laneT, bestT);
+		_mm_store_ps(laneU, bestU);
+		_mm_store_ps(laneV, bestV);
+		_mm_store_ps(laneIndex, bestIndex);
+
+		bool found = false;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (laneIndex[lane] >= 0.0f && laneT[lane] < hit.t)
+			{
+				hit = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// 4 rays against one triangle per iteration, advances first past the processed rays
+	static u32 IntersectPacketSSE(const Ray *rays, u32 &first, u32 rayCount, const TriangleBatch &batch, TriangleHit *hits)
+	{
+		const u32 count = batch.GetCount();
+		u32 updated = 0;
+
+		u32 r = first;
+		for (; r + 4 <= rayCount; r += 4)
+		{
+			const Ray *packet = &rays[r];
+			__m128 originX = _mm_setr_ps(packet[0].origin.x, packet[1].origin.x, packet[2].origin.x, packet[3].origin.x);
+			__m128 originY = _mm_setr_ps(packet[0].origin.y, packet[1].origin.y, packet[2].origin.y, packet[3].origin.y);
+			__m128 originZ = _mm_setr_ps(packet[0].origin.z, packet[1].origin.z, packet[2].origin.z, packet[3].origin.z);
+			__m128 directionX = _mm_setr_ps(packet[0].direction.x, packet[1].direction.x, packet[2].direction.x, packet[3].direction.x);
+			__m128 directionY = _mm_setr_ps(packet[0].direction.y, packet[1].direction.y, packet[2].direction.y, packet[3].direction.y);
+			__m128 directionZ = _mm_setr_ps(packet[0].direction.z, packet[1].direction.z, packet[2].direction.z, packet[3].direction.z);
+
+			__m128 bestT = _mm_setr_ps(hits[r].t, hits[r + 1].t, hits[r + 2].t, hits[r + 3].t);
+			__m128 bestU = _mm_setzero_ps(), bestV = _mm_setzero_ps();
+			__m128 bestIndex = _mm_set1_ps(-1.0f);
+
+			for (u32 i = 0; i < count; i++)
+			{
+				__m128 t, u, v;
+				__m128 mask = IntersectLanes(originX, originY, originZ, directionX, directionY, directionZ,
+					_mm_set1_ps(batch.vertexX[i]), _mm_set1_ps(batch.vertexY[i]), _mm_set1_ps(batch.vertexZ[i]),
+					_mm_set1_ps(batch.edge1X[i]), _mm_set1_ps(batch.edge1Y[i]), _mm_set1_ps(batch.edge1Z[i]),
+					_mm_set1_ps(batch.edge2X[i]), _mm_set1_ps(batch.edge2Y[i]), _mm_set1_ps(batch.edge2Z[i]),
+					bestT, t, u, v);
+
+				bestT = Select(mask, t, bestT);
+				bestU = Select(mask, u, bestU);
+				bestV = Select(mask, v, bestV);
+				bestIndex = Select(mask, _mm_set1_ps(float(i)), bestIndex);
+			}
+
+			alignas(16) float laneT[4], laneU[4], laneV[4], laneIndex[4];
+			_mm_store_ps(laneT, bestT);
+			_mm_store_ps(laneU, bestU);
+			_mm_store_ps(laneV, bestV);
+			_mm_store_ps(laneIndex, bestIndex);
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (laneIndex[lane] < 0.0f)
+					continue;
+
+				hits[r + lane] = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				updated++;
+			}
+		}
+
+		first = r;
+		return updated;
+	}
+#endif
+
+#ifdef ME_MATH_AVX2
+	// Same as IntersectLanes on 8 lanes
+	ME_TARGET_AVX2 static inline __m256 IntersectLanes8(
+		__m256 originX, __m256 originY, __m256 originZ, __m256 directionX, __m256 directionY, __m256 directionZ,
+		__m256 vertexX, __m256 vertexY, __m256 vertexZ, __m256 edge1X, __m256 edge1Y, __m256 edge1Z,
+		__m256 edge2X, __m256 edge2Y, __m256 edge2Z, __m256 maxT, __m256 &t, __m256 &u, __m256 &v)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 epsilon = _mm256_set1_ps(TriangleEpsilon);
+		const __m256 negativeEpsilon = _mm256_set1_ps(-TriangleEpsilon);
+
+		__m256 hX = _mm256_sub_ps(_mm256_mul_ps(directionY, edge2Z), _mm256_mul_ps(directionZ, edge2Y));
+		__m256 hY = _mm256_sub_ps(_mm256_mul_ps(directionZ, edge2X), _mm256_mul_ps(directionX, edge2Z));
+		__m256 hZ = _mm256_sub_ps(_mm256_mul_ps(directionX, edge2Y), _mm256_mul_ps(directionY, edge2X));
+
+		__m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge1X, hX), _mm256_mul_ps(edge1Y, hY)), _mm256_mul_ps(edge1Z, hZ));
+		__m256 f = _mm256_div_ps(one, a);
+
+		__m256 sX = _mm256_sub_ps(originX, vertexX);
+		__m256 sY = _mm256_sub_ps(originY, vertexY);
+		__m256 sZ = _mm256_sub_ps(originZ, vertexZ);
+		u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, hX), _mm256_mul_ps(sY, hY)), _mm256_mul_ps(sZ, hZ)));
+
+		__m256 qX = _mm256_sub_ps(_mm256_mul_ps(sY, edge1Z), _mm256_mul_ps(sZ, edge1Y));
+		__m256 qY = _mm256_sub_ps(_mm256_mul_ps(sZ, edge1X), _mm256_mul_ps(sX, edge1Z));
+		__m256 qZ = _mm256_sub_ps(_mm256_mul_ps(sX, edge1Y), _mm256_mul_ps(sY, edge1X));
+		v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, qX), _mm256_mul_ps(directionY, qY)), _mm256_mul_ps(directionZ, qZ)));
+		t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge2X, qX), _mm256_mul_ps(edge2Y, qY)), _mm256_mul_ps(edge2Z, qZ)));
+
+		__m256 mask = _mm256_or_ps(_mm256_cmp_ps(a, epsilon, _CMP_GT_OQ), _mm256_cmp_ps(a, negativeEpsilon, _CMP_LT_OQ));
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(t, epsilon, _CMP_GT_OQ), _mm256_cmp_ps(t, maxT, _CMP_LT_OQ)));
+		return mask;
+	}
+
+	// One ray against 8 triangles per iteration
+	ME_TARGET_AVX2 static bool IntersectTrianglesAVX2(const Ray &ray, const TriangleBatch &batch, u32 &first, TriangleHit &hit)
+	{
+		const u32 count = batch.GetCount();
+		if (first + 8 > count)
+			return false;
+
+		const __m256 originX = _mm256_set1_ps(ray.origin.x), originY = _mm256_set1_ps(ray.origin.y), originZ = _mm256_set1_ps(ray.origin.z);
+		const __m256 directionX = _mm256_set1_ps(ray.direction.x), directionY = _mm256_set1_ps(ray.direction.y), directionZ = _mm256_set1_ps(ray.direction.z);
+
+		__m256 bestT = _mm256_set1_ps(hit.t);
+		__m256 bestU = _mm256_setzero_ps(), bestV = _mm256_setzero_ps();
+		__m256 bestIndex = _mm256_set1_ps(-1.0f);
+
+		__m256 index = _mm256_add_ps(_mm256_set1_ps(float(first)), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+		const __m256 step = _mm256_set1_ps(8.0f);
+
+		u32 i = first;
+		for (; i + 8 <= count; i += 8, index = _mm256_add_ps(index, step))
+		{
+			__m256 t, u, v;
+			__m256 mask = IntersectLanes8(originX, originY, originZ, directionX, directionY, directionZ,
+				_mm256_loadu_ps(&batch.vertexX[i]), _mm256_loadu_ps(&batch.vertexY[i]), _mm256_loadu_ps(&batch.vertexZ[i]),
+				_mm256_loadu_ps(&batch.edge1X[i]), _mm256_loadu_ps(&batch.edge1Y[i]), _mm256_loadu_ps(&batch.edge1Z[i]),
+				_mm256_loadu_ps(&batch.edge2X[i]), _mm256_loadu_ps(&batch.edge2Y[i]), _mm256_loadu_ps(&batch.edge2Z[i]),
+				bestT, t, u, v);
+
+			bestT = _mm256_blendv_ps(bestT, t, mask);
+			bestU = _mm256_blendv_ps(bestU, u, mask);
+			bestV = _mm256_blendv_ps(bestV, v, mask);
+			bestIndex = _mm256_blendv_ps(bestIndex, index, mask);
+		}
+		first = i;
+
+		alignas(32) float laneT[8], laneU[8], laneV[8], laneIndex[8];
+		_mm256_store_ps(laneT, bestT);
+		_mm256_store_ps(laneU, bestU);
+		_mm256_store_ps(laneV, bestV);
+		_mm256_store_ps(laneIndex, bestIndex);
+
+		bool found = false;
+		for (int lane = 0; lane < 8; lane++)
+		{
+			if (laneIndex[lane] >= 0.0f && laneT[lane] < hit.t)
+			{
+				hit = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// 8 rays against one triangle per iteration
+	ME_TARGET_AVX2 static u32 IntersectPacketAVX2(const Ray *rays, u32 &first, u32 rayCount, const TriangleBatch &batch, TriangleHit *hits)
+	{
+		const u32 count = batch.GetCount();
+		u32 updated = 0;
+
+		u32 r = first;
+		for (; r + 8 <= rayCount; r += 8)
+		{
+			alignas(32) float lanes[7][8];
+			for (int lane = 0; lane < 8; lane++)
+			{
+				lanes[0][lane] = rays[r + lane].origin.x;
+				lanes[1][lane] = rays[r + lane].origin.y;
+				lanes[2][lane] = rays[r + lane].origin.z;
+				lanes[3][lane] = rays[r + lane].direction.x;
+				lanes[4][lane] = rays[r + lane].direction.y;
+				lanes[5][lane] = rays[r + lane].direction.z;
+				lanes[6][lane] = hits[r + lane].t;
+			}
+
+			__m256 originX = _mm256_load_ps(lanes[0]), originY = _mm256_load_ps(lanes[1]), originZ = _mm256_load_ps(lanes[2]);
+			__m256 directionX = _mm256_load_ps(lanes[3]), directionY = _mm256_load_ps(lanes[4]), directionZ = _mm256_load_ps(lanes[5]);
+
+			__m256 bestT = _mm256_load_ps(lanes[6]);
+			__m256 bestU = _mm256_setzero_ps(), bestV = _mm256_setzero_ps();
+			__m256 bestIndex = _mm256_set1_ps(-1.0f);
+
+			for (u32 i = 0; i < count; i++)
+			{
+				__m256 t, u, v;
+				__m256 mask = IntersectLanes8(originX, originY, originZ, directionX, directionY, directionZ,
+					_mm256_set1_ps(batch.vertexX[i]), _mm256_set1_ps(batch.vertexY[i]), _mm256_set1_ps(batch.vertexZ[i]),
+					_mm256_set1_ps(batch.edge1X[i]), _mm256_set1_ps(batch.edge1Y[i]), _mm256_set1_ps(batch.edge1Z[i]),
+					_mm256_set1_ps(batch.edge2X[i]), _mm256_set1_ps(batch.edge2Y[i]), _mm256_set1_ps(batch.edge2Z[i]),
+					bestT, t, u, v);
+
+				bestT = _mm256_blendv_ps(bestT, t, mask);
+				bestU = _mm256_blendv_ps(bestU, u, mask);
+				bestV = _mm256_blendv_ps(bestV, v, mask);
+				bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(float(i)), mask);
+			}
+
+			alignas(32) float laneT[8], laneU[8], laneV[8], laneIndex[8];
+			_mm256_store_ps(laneT, bestT);
+			_mm256_store_ps(laneU, bestU);
+			_mm256_store_ps(laneV, bestV);
+			_mm256_store_ps(laneIndex, bestIndex);
+
+			for (int lane = 0; lane < 8; lane++)
+			{
+				if (laneIndex[lane] < 0.0f)
+					continue;
+
+				hits[r + lane] = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				updated++;
+			}
+		}
+
+		first = r;
+		return updated;
+	}
+#endif
+
+#ifdef ME_MATH_AVX512
+	// Same as IntersectLanes on 16 lanes, the comparisons go straight into a mask register
+	ME_TARGET_AVX512 static inline __mmask16 IntersectLanes16(
+		__m512 originX, __m512 originY, __m512 originZ, __m512 directionX, __m512 directionY, __m512 directionZ,
+		__m512 vertexX, __m512 vertexY, __m512 vertexZ, __m512 edge1X, __m512 edge1Y, __m512 edge1Z,
+		__m512 edge2X, __m512 edge2Y, __m512 edge2Z, __m512 maxT, __m512 &t, __m512 &u, __m512 &v)
+	{
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512 epsilon = _mm512_set1_ps(TriangleEpsilon);
+		const __m512 negativeEpsilon = _mm512_set1_ps(-TriangleEpsilon);
+
+		__m512 hX = _mm512_sub_ps(_mm512_mul_ps(directionY, edge2Z), _mm512_mul_ps(directionZ, edge2Y));
+		__m512 hY = _mm512_sub_ps(_mm512_mul_ps(directionZ, edge2X), _mm512_mul_ps(directionX, edge2Z));
+		__m512 hZ = _mm512_sub_ps(_mm512_mul_ps(directionX, edge2Y), _mm512_mul_ps(directionY, edge2X));
+
+		__m512 a = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(edge1X, hX), _mm512_mul_ps(edge1Y, hY)), _mm512_mul_ps(edge1Z, hZ));
+		__m512 f = _mm512_div_ps(one, a);
+
+		__m512 sX = _mm512_sub_ps(originX, vertexX);
+		__m512 sY = _mm512_sub_ps(originY, vertexY);
+		__m512 sZ = _mm512_sub_ps(originZ, vertexZ);
+		u = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(sX, hX), _mm512_mul_ps(sY, hY)), _mm512_mul_ps(sZ, hZ)));
+
+		__m512 qX = _mm512_sub_ps(_mm512_mul_ps(sY, edge1Z), _mm512_mul_ps(sZ, edge1Y));
+		__m512 qY = _mm512_sub_ps(_mm512_mul_ps(sZ, edge1X), _mm512_mul_ps(sX, edge1Z));
+		__m512 qZ = _mm512_sub_ps(_mm512_mul_ps(sX, edge1Y), _mm512_mul_ps(sY, edge1X));
+		v = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(directionX, qX), _mm512_mul_ps(directionY, qY)), _mm512_mul_ps(directionZ, qZ)));
+		t = _mm512_mul_ps(f, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(edge2X, qX), _mm512_mul_ps(edge2Y, qY)), _mm512_mul_ps(edge2Z, qZ)));
+
+		__mmask16 mask = _mm512_cmp_ps_mask(a, epsilon, _CMP_GT_OQ) | _mm512_cmp_ps_mask(a, negativeEpsilon, _CMP_LT_OQ);
+		mask &= _mm512_cmp_ps_mask(u, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(u, one, _CMP_LE_OQ);
+		mask &= _mm512_cmp_ps_mask(v, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(_mm512_add_ps(u, v), one, _CMP_LE_OQ);
+		mask &= _mm512_cmp_ps_mask(t, epsilon, _CMP_GT_OQ) & _mm512_cmp_ps_mask(t, maxT, _CMP_LT_OQ);
+		return mask;
+	}
+
+	// One ray against 16 triangles per iteration
+	ME_TARGET_AVX512 static bool IntersectTrianglesAVX512(const Ray &ray, const TriangleBatch &batch, u32 &first, TriangleHit &hit)
+	{
+		const u32 count = batch.GetCount();
+		if (first + 16 > count)
+			return false;
+
+		const __m512 originX = _mm512_set1_ps(ray.origin.x), originY = _mm512_set1_ps(ray.origin.y), originZ = _mm512_set1_ps(ray.origin.z);
+		const __m512 directionX = _mm512_set1_ps(ray.direction.x), directionY = _mm512_set1_ps(ray.direction.y), directionZ = _mm512_set1_ps(ray.direction.z);
+
+		__m512 bestT = _mm512_set1_ps(hit.t);
+		__m512 bestU = _mm512_setzero_ps(), bestV = _mm512_setzero_ps();
+		__m512 bestIndex = _mm512_set1_ps(-1.0f);
+
+		__m512 index = _mm512_add_ps(_mm512_set1_ps(float(first)),
+			_mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f));
+		const __m512 step = _mm512_set1_ps(16.0f);
+
+		u32 i = first;
+		for (; i + 16 <= count; i += 16, index = _mm512_add_ps(index, step))
+		{
+			__m512 t, u, v;
+			__mmask16 mask = IntersectLanes16(originX, originY, originZ, directionX, directionY, directionZ,
+				_mm512_loadu_ps(&batch.vertexX[i]), _mm512_loadu_ps(&batch.vertexY[i]), _mm512_loadu_ps(&batch.vertexZ[i]),
+				_mm512_loadu_ps(&batch.edge1X[i]), _mm512_loadu_ps(&batch.edge1Y[i]), _mm512_loadu_ps(&batch.edge1Z[i]),
+				_mm512_loadu_ps(&batch.edge2X[i]), _mm512_loadu_ps(&batch.edge2Y[i]), _mm512_loadu_ps(&batch.edge2Z[i]),
+				bestT, t, u, v);
+
+			bestT = _mm512_mask_blend_ps(mask, bestT, t);
+			bestU = _mm512_mask_blend_ps(mask, bestU, u);
+			bestV = _mm512_mask_blend_ps(mask, bestV, v);
+			bestIndex = _mm512_mask_blend_ps(mask, bestIndex, index);
+		}
+		first = i;
+
+		alignas(64) float laneT[16], laneU[16], laneV[16], laneIndex[16];
+		_mm512_store_ps(laneT, bestT);
+		_mm512_store_ps(laneU, bestU);
+		_mm512_store_ps(laneV, bestV);
+		_mm512_store_ps(laneIndex, bestIndex);
+
+		bool found = false;
+		for (int lane = 0; lane < 16; lane++)
+		{
+			if (laneIndex[lane] >= 0.0f && laneT[lane] < hit.t)
+			{
+				hit = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// 16 rays against one triangle per iteration
+	ME_TARGET_AVX512 static u32 IntersectPacketAVX512(const Ray *rays, u32 &first, u32 rayCount, const TriangleBatch &batch, TriangleHit *hits)
+	{
+		const u32 count = batch.GetCount();
+		u32 updated = 0;
+
+		u32 r = first;
+		for (; r + 16 <= rayCount; r += 16)
+		{
+			alignas(64) float lanes[7][16];
+			for (int lane = 0; lane < 16; lane++)
+			{
+				lanes[0][lane] = rays[r + lane].origin.x;
+				lanes[1][lane] = rays[r + lane].origin.y;
+				lanes[2][lane] = rays[r + lane].origin.z;
+				lanes[3][lane] = rays[r + lane].direction.x;
+				lanes[4][lane] = rays[r + lane].direction.y;
+				lanes[5][lane] = rays[r + lane].direction.z;
+				lanes[6][lane] = hits[r + lane].t;
+			}
+
+			__m512 originX = _mm512_load_ps(lanes[0]), originY = _mm512_load_ps(lanes[1]), originZ = _mm512_load_ps(lanes[2]);
+			__m512 directionX = _mm512_load_ps(lanes[3]), directionY = _mm512_load_ps(lanes[4]), directionZ = _mm512_load_ps(lanes[5]);
+
+			__m512 bestT = _mm512_load_ps(lanes[6]);
+			__m512 bestU = _mm512_setzero_ps(), bestV = _mm512_setzero_ps();
+			__m512 bestIndex = _mm512_set1_ps(-1.0f);
+
+			for (u32 i = 0; i < count; i++)
+			{
+				__m512 t, u, v;
+				__mmask16 mask = IntersectLanes16(originX, originY, originZ, directionX, directionY, directionZ,
+					_mm512_set1_ps(batch.vertexX[i]), _mm512_set1_ps(batch.vertexY[i]), _mm512_set1_ps(batch.vertexZ[i]),
+					_mm512_set1_ps(batch.edge1X[i]), _mm512_set1_ps(batch.edge1Y[i]), _mm512_set1_ps(batch.edge1Z[i]),
+					_mm512_set1_ps(batch.edge2X[i]), _mm512_set1_ps(batch.edge2Y[i]), _mm512_set1_ps(batch.edge2Z[i]),
+					bestT, t, u, v);
+
+				bestT = _mm512_mask_blend_ps(mask, bestT, t);
+				bestU = _mm512_mask_blend_ps(mask, bestU, u);
+				bestV = _mm512_mask_blend_ps(mask, bestV, v);
+				bestIndex = _mm512_mask_blend_ps(mask, bestIndex, _mm512_set1_ps(float(i)));
+			}
+
+			alignas(64) float laneT[16], laneU[16], laneV[16], laneIndex[16];
+			_mm512_store_ps(laneT, bestT);
+			_mm512_store_ps(laneU, bestU);
+			_mm512_store_ps(laneV, bestV);
+			_mm512_store_ps(laneIndex, bestIndex);
+
+			for (int lane = 0; lane < 16; lane++)
+			{
+				if (laneIndex[lane] < 0.0f)
+					continue;
+
+				hits[r + lane] = { laneT[lane], laneU[lane], laneV[lane], static_cast<u32>(laneIndex[lane]) };
+				updated++;
+			}
+		}
+
+		first = r;
+		return updated;
+	}
+#endif
+
+	bool Math::IntersectTriangles(const Ray &ray, const TriangleBatch &batch, TriangleHit &hit)
+	{
+		u32 first = 0;
+		bool found = false;
+
+		// Each wider kernel leaves its remainder to the next narrower one
+#ifdef ME_MATH_AVX512
+		if (s_SIMDLevel >= SIMDLevel::AVX512)
+			found |= IntersectTrianglesAVX512(ray, batch, first, hit);
+#endif
+#ifdef ME_MATH_AVX2
+		if (s_SIMDLevel >= SIMDLevel::AVX2)
+			found |= IntersectTrianglesAVX2(ray, batch, first, hit);
+#endif
+#ifdef ME_MATH_SSE
+		if (s_SIMDLevel >= SIMDLevel::SSE)
+			found |= IntersectTrianglesSSE(ray, batch, first, hit);
+#endif
+		found |= IntersectTrianglesScalar(ray, batch, first, hit);
+
+		return found;
+	}
+
+	u32 Math::IntersectTriangles(const Ray *rays, u32 rayCount, const TriangleBatch &batch, TriangleHit *hits)
+	{
+		u32 first = 0;
+		u32 updated = 0;
+
+#ifdef ME_MATH_AVX512
+		if (s_SIMDLevel >= SIMDLevel::AVX512)
+			updated += IntersectPacketAVX512(rays, first, rayCount, batch, hits);
+#endif
+#ifdef ME_MATH_AVX2
+		if (s_SIMDLevel >= SIMDLevel::AVX2)
+			updated += IntersectPacketAVX2(rays, first, rayCount, batch, hits);
+#endif
+#ifdef ME_MATH_SSE
+		if (s_SIMDLevel >= SIMDLevel::SSE)
+			updated += IntersectPacketSSE(rays, first, rayCount, batch, hits);
+#endif
+		for (; first < rayCount; first++)
+			updated += IntersectTriangles(rays[first], batch, hits[first]) ? 1 : 0;
+
+		return updated;
 	}
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+#include <limits>
+
 #include <glm/gtc/epsilon.hpp>
 #include <glm/gtc/constants.hpp>
 
@@ -40,12 +43,95 @@ namespace Engine
 		glm::vec3 origin;
 		glm::vec3 direction;
 	};
-	struct Triangle;
+
+	struct AABB
+	{
+		glm::vec3 min { 0.0f };
+		glm::vec3 max { 0.0f };
+
+		glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+		glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+	};
+	struct BoundingSphere
+	{
+		glm::vec3 center { 0.0f };
+		float radius = 0.0f;
+	};
+
+	// Plane equations (xyz normal, w distance) pointing into the frustum
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
+	// Boxes as center/extent component arrays so they can be tested 4 at a time
+	struct AABBBatch
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+
+		void Clear();
+		void Add(const AABB &box);
+		u32 GetCount() const { return static_cast<u32>(centerX.size()); }
+	};
+
+	// Triangles as first vertex and edge component arrays so a ray can be tested against 4 or 8 at a time
+	struct TriangleBatch
+	{
+		std::vector<float> vertexX, vertexY, vertexZ;
+		std::vector<float> edge1X, edge1Y, edge1Z;
+		std::vector<float> edge2X, edge2Y, edge2Z;
+
+		void Clear();
+		void Add(const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2);
+		u32 GetCount() const { return static_cast<u32>(vertexX.size()); }
+	};
+
+	struct TriangleHit
+	{
+		float t = std::numeric_limits<float>::max();
+		float u = 0.0f, v = 0.0f;	// Barycentric weights of vertex1 and vertex2
+		u32 index = 0;				// Triangle within the batch
+	};
+
+	enum class SIMDLevel
+	{
+		Scalar = 0,
+		SSE,
+		AVX2,
+		AVX512
+	};
 
 	class Math
 	{
 	public:
-		static bool RayIntersectsTriangle(Ray ray, Triangle triangle, float &distance);
+		// Moller-Trumbore, t is the hit distance in units of ray.direction
+		static bool RayIntersectsTriangle(const Ray &ray, const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2, float &t);
+
+		// Closest triangle of the batch hit by the ray, only accepted when nearer than hit.t
+		static bool IntersectTriangles(const Ray &ray, const TriangleBatch &batch, TriangleHit &hit);
+		// Packet version, hits[i] belongs to rays[i]. Returns how many hits were updated
+		static u32 IntersectTriangles(const Ray *rays, u32 rayCount, const TriangleBatch &batch, TriangleHit *hits);
+
+		// Kernels are picked at runtime, the level can be lowered for comparisons
+		static SIMDLevel GetSIMDLevel();
+		static SIMDLevel GetSupportedSIMDLevel();
+		static void SetSIMDLevel(SIMDLevel level);
+		static const char *GetSIMDLevelName(SIMDLevel level);
+
+		// Gribb/Hartmann plane extraction, works for any projection * view matrix
+		static Frustum ExtractFrustum(const glm::mat4 &projectionView);
+
+		static AABB TransformAABB(const AABB &box, const glm::mat4 &transform);
+		static BoundingSphere TransformSphere(const BoundingSphere &sphere, const glm::mat4 &transform);
+
+		static bool IsSphereVisible(const Frustum &frustum, const BoundingSphere &sphere);
+		static bool IsAABBVisible(const Frustum &frustum, const AABB &box);
+
+		// Writes 1 for every box of the batch that intersects the frustum, 0 otherwise (SSE when available)
+		static void CullAABBs(const Frustum &frustum, const AABBBatch &batch, std::vector<u8> &visibility);
+		// Only boxes [begin, end), visibility has to hold the whole batch already. Ranges can be culled concurrently
+		static void CullAABBs(const Frustum &frustum, const AABBBatch &batch, u32 begin, u32 end, u8 *visibility);
 
 		static inline std::tuple<glm::vec3, glm::vec3, glm::vec3> Decompose(const glm::mat4 &transform)
 		{
@@ -3,12 +3,11 @@
 // Pre-filters environment cube map using GGX NDF importance sampling.
 // Part of specular IBL split-sum approximation.
 
-const float PI = 3.141592;
-const float TwoPI = 2 * PI;
-const float Epsilon = 0.00001;
+#include "Include/BRDF.glsl"
+#include "Include/Sampling.glsl"
+#include "Include/Cubemap.glsl"
 
 const uint NumSamples = 1024;
-const float InvNumSamples = 1.0 / float(NumSamples);
 
 const int NumMipLevels = 1;
 layout(binding = 0, rgba32f) restrict writeonly uniform imageCube outputTexture[NumMipLevels];
@@ -19,82 +18,6 @@ uniform float u_Roughness;
 #define PARAM_LEVEL     0
 #define PARAM_ROUGHNESS u_Roughness
 
-// Compute Van der Corput radical inverse
-// See: http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
-float radicalInverse_VdC(uint bits)
-{
-	bits = (bits << 16u) | (bits >> 16u);
-	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-	return float(bits) * 2.3283064365386963e-10; // / 0x100000000
-}
-
-// Sample i-th point from Hammersley point set of NumSamples points total.
-vec2 sampleHammersley(uint i)
-{
-	return vec2(i * InvNumSamples, radicalInverse_VdC(i));
-}
-
-// Importance sample GGX normal distribution function for a fixed roughness value.
-// This returns normalized half-vector between Li & Lo.
-// For derivation see: http://blog.tobias-franke.eu/2014/03/30/notes_on_importance_sampling.html
-vec3 sampleGGX(float u1, float u2, float roughness)
-{
-	float alpha = roughness * roughness;
-
-	float cosTheta = sqrt((1.0 - u2) / (1.0 + (alpha*alpha - 1.0) * u2));
-	float sinTheta = sqrt(1.0 - cosTheta*cosTheta); // Trig. identity
-	float phi = TwoPI * u1;
-
-	// Convert to Cartesian upon return.
-	return vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
-}
-
-// GGX/Towbridge-Reitz normal distribution function.
-// Uses Disney's reparametrization of alpha = roughness^2.
-float ndfGGX(float cosLh, float roughness)
-{
-	float alpha   = roughness * roughness;
-	float alphaSq = alpha * alpha;
-
-	float denom = (cosLh * cosLh) * (alphaSq - 1.0) + 1.0;
-	return alphaSq / (PI * denom * denom);
-}
-
-vec3 GetCubeMapTexCoord()
-{
-    vec2 st = gl_GlobalInvocationID.xy / vec2(imageSize(outputTexture[PARAM_LEVEL]));
-    vec2 uv = 2.0 * vec2(st.x, 1.0 - st.y) - vec2(1.0);
-
-    vec3 ret;
-    if (gl_GlobalInvocationID.z == 0)      ret = vec3(  1.0, uv.y, -uv.x);
-    else if (gl_GlobalInvocationID.z == 1) ret = vec3( -1.0, uv.y,  uv.x);
-    else if (gl_GlobalInvocationID.z == 2) ret = vec3( uv.x,  1.0, -uv.y);
-    else if (gl_GlobalInvocationID.z == 3) ret = vec3( uv.x, -1.0,  uv.y);
-    else if (gl_GlobalInvocationID.z == 4) ret = vec3( uv.x, uv.y,   1.0);
-    else if (gl_GlobalInvocationID.z == 5) ret = vec3(-uv.x, uv.y,  -1.0);
-    return normalize(ret);
-}
-
-// Compute orthonormal basis for converting from tanget/shading space to world space.
-void computeBasisVectors(const vec3 N, out vec3 S, out vec3 T)
-{
-	// Branchless select non-degenerate T.
-	T = cross(N, vec3(0.0, 1.0, 0.0));
-	T = mix(cross(N, vec3(1.0, 0.0, 0.0)), T, step(Epsilon, dot(T, T)));
-
-	T = normalize(T);
-	S = normalize(cross(N, T));
-}
-
-// Convert point from tangent/shading space to world space.
-vec3 tangentToWorld(const vec3 v, const vec3 N, const vec3 S, const vec3 T)
-{
-	return S * v.x + T * v.y + N * v.z;
-}
-
 layout(local_size_x=32, local_size_y=32, local_size_z=1) in;
 void main(void)
 {
@@ -110,7 +33,7 @@ void main(void)
 	float wt = 4.0 * PI / (6 * inputSize.x * inputSize.y);
 	
 	// Approximation: Assume zero viewing angle (isotropic reflections).
-	vec3 N = GetCubeMapTexCoord();
+	vec3 N = GetCubeMapTexCoord(vec2(outputSize));
 	vec3 Lo = N;
 	
 	vec3 S, T;
@@ -123,7 +46,7 @@ void main(void)
 	// Weight by cosine term since Epic claims it generally improves quality.
 	for(uint i = 0; i < NumSamples; i++)
 	{
-		vec2 u = sampleHammersley(i);
+		vec2 u = sampleHammersley(i, NumSamples);
 		vec3 Lh = tangentToWorld(sampleGGX(u.x, u.y, PARAM_ROUGHNESS), N, S, T);
 
 		// Compute incident direction (Li) by reflecting viewing direction (Lo) around half-vector (Lh).
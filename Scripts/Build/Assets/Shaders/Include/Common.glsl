@@ -0,0 +1,5 @@
+#pragma once
+
+const float PI = 3.141592;
+const float TwoPI = 2 * PI;
+const float Epsilon = 0.00001;
\ No newline at end of file
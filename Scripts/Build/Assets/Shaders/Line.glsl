@@ -0,0 +1,31 @@
+#shader vertex
+#version 450
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec4 a_Color;
+
+layout(std140, binding = 0) uniform Camera
+{
+	mat4 u_ProjectionView;
+	vec3 u_CameraPosition;
+};
+
+layout(location = 0) out vec4 v_Color;
+
+void main()
+{
+	v_Color = a_Color;
+	gl_Position = u_ProjectionView * vec4(a_Position, 1.0);
+}
+
+#shader fragment
+#version 450
+
+layout(location = 0) in vec4 v_Color;
+
+layout(location = 0) out vec4 o_Color;
+
+void main()
+{
+	o_Color = v_Color;
+}
\ No newline at end of file
@@ -1,14 +1,23 @@
 #shader vertex
 #version 450
 
-layout(location = 0) in vec3 a_Position;
+layout(location = 0) in vec4 a_Position;
+
+layout(std140, binding = 0) uniform Camera
+{
+	mat4 u_ProjectionView;
+	vec3 u_CameraPosition;
+};
 
-uniform mat4 u_ProjectionView;
 uniform mat4 u_Transform;
 
+uniform vec3 u_DequantizationScale;
+uniform vec3 u_DequantizationOffset;
+
 void main()
 {
-	gl_Position = u_ProjectionView * u_Transform * vec4(a_Position, 1.0);
+	vec3 position = a_Position.xyz * u_DequantizationScale + u_DequantizationOffset;
+	gl_Position = u_ProjectionView * u_Transform * vec4(position, 1.0);
 }
 
 #shader fragment
@@ -6,15 +6,46 @@
 //  - joey de vries (learnopengl):  https://learnopengl.com/PBR
 //  - TheCherno     (Hazel Engine): https://github.com/TheCherno/Hazel
 //  - Michal Siejak (PBR):          https://github.com/Nadrin/PBR
-
-layout(location = 0) in vec3 a_Position;
+//
+// Variants are compiled by Engine::Renderer with these defines:
+//  COMPACT_VERTICES           mesh uses Engine::CompactVertex
+//  ENABLE_ALBEDO_TEXTURE, ENABLE_NORMAL_MAP_TEXTURE, ENABLE_METALNESS_TEXTURE, ENABLE_ROUGHNESS_TEXTURE
+//                             material samples the texture instead of the constant parameter
+
+// Compact vertices (see Engine::CompactVertex) only provide locations 0, 1, 2 and 4:
+//  a_Position  16 bit snorm, dequantized with the sub mesh bounds
+//  a_Normal    octahedral encoded in xy
+//  a_Tangent   w holds the bitangent sign
+layout(location = 0) in vec4 a_Position;
 layout(location = 1) in vec3 a_Normal;
-layout(location = 2) in vec3 a_Tangent;
+layout(location = 2) in vec4 a_Tangent;
 layout(location = 3) in vec3 a_Bitangent;
 layout(location = 4) in vec2 a_TexCoords;
 
-uniform mat4 u_ProjectionView;
-uniform mat4 u_Transform;
+// baseInstance + gl_InstanceID, also valid inside multi draw indirect
+layout(location = 5) in uint a_InstanceIndex;
+
+// Uniform blocks are filled by Engine::Renderer (std140)
+layout(std140, binding = 0) uniform Camera
+{
+	mat4 u_ProjectionView;
+	vec3 u_CameraPosition;
+};
+
+// Written by Engine::Renderer in draw order
+struct InstanceData
+{
+	mat4 Transform;
+	vec3 DequantizationScale;
+	uint MaterialIndex;
+	vec3 DequantizationOffset;
+	uint Padding;
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+	InstanceData u_Instances[];
+};
 
 out VertexShaderData
 {
@@ -24,26 +55,48 @@ out VertexShaderData
 	mat3 WorldNormals;
 	mat3 WorldTransform;
 	vec3 Bitangent;
+	flat uint MaterialIndex;
 } vs_Output;
 
+vec3 DecodeOctahedral(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0)
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(normal);
+}
+
 void main()
 {
-	vs_Output.WorldPosition = vec3(u_Transform * vec4(a_Position, 1.0));
-	vs_Output.Normal = mat3(u_Transform) * a_Normal;
+	InstanceData instance = u_Instances[a_InstanceIndex];
+	mat4 transform = instance.Transform;
+
+	vec3 position = a_Position.xyz * instance.DequantizationScale + instance.DequantizationOffset;
+	vec3 normal = a_Normal;
+	vec3 tangent = a_Tangent.xyz;
+	vec3 bitangent = a_Bitangent;
+
+#ifdef COMPACT_VERTICES
+	normal = DecodeOctahedral(a_Normal.xy);
+	tangent = normalize(a_Tangent.xyz);
+	bitangent = cross(normal, tangent) * a_Tangent.w;
+#endif
+
+	vs_Output.WorldPosition = vec3(transform * vec4(position, 1.0));
+	vs_Output.Normal = mat3(transform) * normal;
 	vs_Output.TexCoord = vec2(a_TexCoords.x, a_TexCoords.y);
-	vs_Output.WorldNormals = mat3(u_Transform) * mat3(a_Tangent, a_Bitangent, a_Normal);
-	vs_Output.WorldTransform = mat3(u_Transform);
-	vs_Output.Bitangent = a_Bitangent;
+	vs_Output.WorldNormals = mat3(transform) * mat3(tangent, bitangent, normal);
+	vs_Output.WorldTransform = mat3(transform);
+	vs_Output.Bitangent = bitangent;
+	vs_Output.MaterialIndex = instance.MaterialIndex;
 
-	gl_Position = u_ProjectionView * u_Transform * vec4(a_Position, 1.0f);
+	gl_Position = u_ProjectionView * transform * vec4(position, 1.0f);
 }
 
 #shader fragment
 #version 430 core
 
-const float PI = 3.141592;
-const float Epsilon = 0.00001;
-
+#include "Include/BRDF.glsl"
 
 // Constant normal incidence Fresnel factor for all dielectrics.
 const vec3 Fdielectric = vec3(0.04);
@@ -51,12 +104,13 @@ const vec3 Fdielectric = vec3(0.04);
 // Max directional lights (4 for now)
 const int DirectionalLightCount = 4;
 
+// Ordered to pack into 32 bytes under std140
 struct DirectionalLight
 {
-	bool Active;
 	vec3 Direction;
-	vec3 Radiance;
 	float Multiplier;
+	vec3 Radiance;
+	bool Active;
 };
 
 in VertexShaderData
@@ -67,33 +121,52 @@ in VertexShaderData
 	mat3 WorldNormals;
 	mat3 WorldTransform;
 	vec3 Bitangent;
+	flat uint MaterialIndex;
 } vs_Input;
 
 layout(location = 0) out vec4 o_Color;
 
-uniform DirectionalLight u_DirectionalLights[4];
-uniform vec3 u_CameraPosition;
-
-uniform vec3 u_AlbedoColor;
-uniform float u_Metalness;
-uniform float u_Roughness;
-
-uniform bool u_EnableAlbedoTexture;
-uniform sampler2D u_AlbedoTexture;
-
-uniform bool u_EnableNormalMapTexture;
-uniform sampler2D u_NormalMapTexture;
+layout(std140, binding = 0) uniform Camera
+{
+	mat4 u_ProjectionView;
+	vec3 u_CameraPosition;
+};
 
-uniform bool u_EnableMetalnessTexture;
-uniform sampler2D u_MetalnessTexture;
+layout(std140, binding = 1) uniform Lights
+{
+	DirectionalLight u_DirectionalLights[DirectionalLightCount];
+};
 
-uniform bool u_EnableRoughnessTexture;
-uniform sampler2D u_RoughnessTexture;
+// Indexed by the instance's material slot (see Engine::MaterialUniformData)
+struct MaterialData
+{
+	vec3 AlbedoColor;
+	float Metalness;
+	float Roughness;
+	float Opacity;
+};
 
-uniform sampler2D u_BRDFLUTTexture;
+layout(std430, binding = 1) readonly buffer Materials
+{
+	MaterialData u_Materials[];
+};
 
-uniform samplerCube u_EnvIrradianceTex;
-uniform samplerCube u_EnvRadianceTex;
+#ifdef ENABLE_ALBEDO_TEXTURE
+layout(binding = 0) uniform sampler2D u_AlbedoTexture;
+#endif
+#ifdef ENABLE_NORMAL_MAP_TEXTURE
+layout(binding = 1) uniform sampler2D u_NormalMapTexture;
+#endif
+#ifdef ENABLE_METALNESS_TEXTURE
+layout(binding = 2) uniform sampler2D u_MetalnessTexture;
+#endif
+#ifdef ENABLE_ROUGHNESS_TEXTURE
+layout(binding = 3) uniform sampler2D u_RoughnessTexture;
+#endif
+
+layout(binding = 5) uniform sampler2D u_BRDFLUTTexture;
+layout(binding = 6) uniform samplerCube u_EnvRadianceTex;
+layout(binding = 7) uniform samplerCube u_EnvIrradianceTex;
 
 struct PBRParameters
 {
@@ -107,35 +180,6 @@ struct PBRParameters
 };
 PBRParameters m_Params;
 
-float ndfGGX(float cosLh, float roughness)
-{
-	float alpha = roughness * roughness;
-	float alphaSq = alpha * alpha;
-
-	float denom = (cosLh * cosLh) * (alphaSq - 1.0) + 1.0;
-	return alphaSq / (PI * denom * denom);
-}
-
-float gaSchlickG1(float cosTheta, float k)
-{
-	return cosTheta / (cosTheta * (1.0 - k) + k);
-}
-float gaSchlickGGX(float cosLi, float NdotV, float roughness)
-{
-	float r = roughness + 1.0;
-	float k = (r * r) / 8.0; // Epic suggests using this roughness remapping for analytic lights.
-	return gaSchlickG1(cosLi, k) * gaSchlickG1(NdotV, k);
-}
-
-vec3 fresnelSchlick(vec3 F0, float cosTheta)
-{
-	return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
-}
-vec3 fresnelSchlickRoughness(vec3 F0, float cosTheta, float roughness)
-{
-	return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
-}
-
 vec3 ApplyLighting(vec3 F0)
 {
 	vec3 result = vec3(0.0);
@@ -184,7 +228,7 @@ vec3 ApplyIBL(vec3 F0, vec3 Lr)
 	vec3 specularIrradiance = textureLod(u_EnvRadianceTex, Lr, (m_Params.Roughness) * envRadianceTexLevels).rgb;
 
 	// Sample BRDF Lut, 1.0 - roughness for y-coord because texture was generated (in Sparky) for gloss model
-	vec2 specularBRDF = texture(u_BRDFLUTTexture, vec2(m_Params.NdotV, 1.0 - m_Params.Roughness)).rg;
+	vec2 specularBRDF = texture(u_BRDFLUTTexture, vec2(m_Params.NdotV, m_Params.Roughness)).rg;
 	vec3 specularIBL = (F0 * specularBRDF.x + specularBRDF.y) * specularIrradiance;
 
 	return diffuseIBL + specularIBL;
@@ -192,17 +236,33 @@ vec3 ApplyIBL(vec3 F0, vec3 Lr)
 
 void main()
 {
-	m_Params.Albedo = u_EnableAlbedoTexture ? texture(u_AlbedoTexture, vs_Input.TexCoord).xyz : u_AlbedoColor;
-	m_Params.Metalness = u_EnableMetalnessTexture ? texture(u_MetalnessTexture, vs_Input.TexCoord).x : u_Metalness;
-	m_Params.Roughness = u_EnableRoughnessTexture ? texture(u_RoughnessTexture, vs_Input.TexCoord).x : u_Roughness;
+	MaterialData material = u_Materials[vs_Input.MaterialIndex];
+
+#ifdef ENABLE_ALBEDO_TEXTURE
+	m_Params.Albedo = texture(u_AlbedoTexture, vs_Input.TexCoord).xyz;
+#else
+	m_Params.Albedo = material.AlbedoColor;
+#endif
+#ifdef ENABLE_METALNESS_TEXTURE
+	m_Params.Metalness = texture(u_MetalnessTexture, vs_Input.TexCoord).x;
+#else
+	m_Params.Metalness = material.Metalness;
+#endif
+#ifdef ENABLE_ROUGHNESS_TEXTURE
+	m_Params.Roughness = texture(u_RoughnessTexture, vs_Input.TexCoord).x;
+#else
+	m_Params.Roughness = material.Roughness;
+#endif
 	m_Params.Roughness = max(m_Params.Roughness, 0.05);
 
+#ifdef ENABLE_NORMAL_MAP_TEXTURE
+	// BC5 normal maps only store x and y
+	vec2 normalXY = 2.0 * texture(u_NormalMapTexture, vs_Input.TexCoord).rg - 1.0;
+	m_Params.Normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+	m_Params.Normal = normalize(vs_Input.WorldNormals * m_Params.Normal);
+#else
 	m_Params.Normal = normalize(vs_Input.Normal);
-	if (u_EnableNormalMapTexture)
-	{
-		m_Params.Normal = normalize(2.0 * texture(u_NormalMapTexture, vs_Input.TexCoord).rgb - 1.0);
-		m_Params.Normal = normalize(vs_Input.WorldNormals * m_Params.Normal);
-	}
+#endif
 
 	m_Params.View = normalize(u_CameraPosition - vs_Input.WorldPosition);
 	m_Params.NdotV = max(dot(m_Params.Normal, m_Params.View), 0.0);
@@ -218,5 +278,5 @@ void main()
 
 	vec3 color = lightContribution + iblContribution;
 
-	o_Color = vec4(color, 1.0);
+	o_Color = vec4(color, material.Opacity);
 }
\ No newline at end of file